@@ -1,7 +1,9 @@
 #pragma once
 #include "Utils.hpp"
 
+#include <bitset>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <cassert>
 
@@ -10,14 +12,25 @@ class Bitmap {
 public:
 	Bitmap (size_t numBits);
 	Bitmap (char * buf, size_t numBits); //deserialize from buf
+	Bitmap (const Bitmap & other);
 	~Bitmap ( );
 
+	Bitmap & operator= (const Bitmap & other);
+
 	void set (unsigned int bitNumber);
 	void set ( ); // set all bits to 1
 	void reset (unsigned int bitNumber);
 	void reset ( ); // set all bits to 0
 	bool test (unsigned int bitNumber) const;
 
+	// with a bitmap of the same size, 8 bytes at a time
+	void and_with (const Bitmap & other);
+	void or_with (const Bitmap & other);
+	void and_not (const Bitmap & other); // reset the bits set in other
+
+	unsigned int count ( ) const; // number of bits set
+	unsigned int next (unsigned int bitNumber) const; // first bit set from bitNumber on, getSize() if none
+
 	int numChars ( ) const; // return size of char buffer to hold bitmap
 	int to_char_buf (char *, size_t len) const; //serialize content to char buffer
 	int getSize ( ) const { return size; }
@@ -41,6 +54,23 @@ Bitmap::Bitmap (char * buf, size_t numBits) : size (numBits) {
 	memcpy (buffer, buf, this->numChars ( ));
 }
 
+Bitmap::Bitmap (const Bitmap & other) : size (other.size) {
+	buffer = new char[this->numChars ( )];
+	memcpy (buffer, other.buffer, this->numChars ( ));
+}
+
+Bitmap & Bitmap::operator= (const Bitmap & other) {
+	if ( this != &other ) {
+		char * copy = new char[other.numChars ( )];
+
+		memcpy (copy, other.buffer, other.numChars ( ));
+		delete[] buffer;
+		buffer = copy;
+		size = other.size;
+	}
+	return *this;
+}
+
 int Bitmap::to_char_buf (char * b, size_t len) const //copy content to char buffer -
 {
 	assert (b != NULL && len == this->numChars ( ));
@@ -60,9 +90,7 @@ int Bitmap::numChars ( ) const {
 }
 
 void Bitmap::reset ( ) {
-	for ( unsigned int i = 0; i < size; i++ ) {
-		Bitmap::reset (i);
-	}
+	memset (( void* ) buffer, 0, this->numChars ( ));
 }
 
 void Bitmap::reset (unsigned int bitNumber) {
@@ -95,6 +123,79 @@ bool Bitmap::test (unsigned int bitNumber) const {
 	return (buffer[byte] & ( 1 << offset )) != 0;
 }
 
+void Bitmap::and_with (const Bitmap & other) {
+	assert (size == other.size);
+	int n = this->numChars ( ), i = 0;
+
+	for ( uint64_t a, b; i + 8 <= n; i += 8 ) {
+		memcpy (&a, buffer + i, 8);
+		memcpy (&b, other.buffer + i, 8);
+		a &= b;
+		memcpy (buffer + i, &a, 8);
+	}
+	for ( ; i < n; i++ )
+		buffer[i] &= other.buffer[i];
+}
+
+void Bitmap::or_with (const Bitmap & other) {
+	assert (size == other.size);
+	int n = this->numChars ( ), i = 0;
+
+	for ( uint64_t a, b; i + 8 <= n; i += 8 ) {
+		memcpy (&a, buffer + i, 8);
+		memcpy (&b, other.buffer + i, 8);
+		a |= b;
+		memcpy (buffer + i, &a, 8);
+	}
+	for ( ; i < n; i++ )
+		buffer[i] |= other.buffer[i];
+}
+
+void Bitmap::and_not (const Bitmap & other) {
+	assert (size == other.size);
+	int n = this->numChars ( ), i = 0;
+
+	for ( uint64_t a, b; i + 8 <= n; i += 8 ) {
+		memcpy (&a, buffer + i, 8);
+		memcpy (&b, other.buffer + i, 8);
+		a &= ~b;
+		memcpy (buffer + i, &a, 8);
+	}
+	for ( ; i < n; i++ )
+		buffer[i] &= ~other.buffer[i];
+}
+
+unsigned int Bitmap::count ( ) const {
+	int n = this->numChars ( ), i = 0;
+	unsigned int bits = 0;
+
+	for ( uint64_t a; i + 8 <= n; i += 8 ) {
+		memcpy (&a, buffer + i, 8);
+		bits += static_cast< unsigned int >( std::bitset<64> (a).count ( ) );
+	}
+	for ( ; i < n; i++ )
+		bits += static_cast< unsigned int >( std::bitset<8> (static_cast< unsigned char >( buffer[i] )).count ( ) );
+	return bits;
+}
+
+unsigned int Bitmap::next (unsigned int bitNumber) const {
+	int n = this->numChars ( );
+
+	for ( int byte = bitNumber / 8; bitNumber < size && byte < n; byte++ ) {
+		unsigned char bits = static_cast< unsigned char >( buffer[byte] ) >> ( bitNumber % 8 );
+
+		if ( bits != 0 ) {
+			while ( ( bits & 1 ) == 0 ) {
+				bits >>= 1;
+				bitNumber++;
+			}
+			return bitNumber < size ? bitNumber : size;
+		}
+		bitNumber = ( byte + 1 ) * 8;
+	}
+	return size;
+}
+
 
 std::ostream& operator <<(std::ostream & os, const Bitmap& b) {
 	os << "[";
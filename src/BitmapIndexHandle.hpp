@@ -0,0 +1,464 @@
+#pragma once
+
+/*
+	1. BitmapIndexHandle keeps a RoaringBitmap of the rows of every distinct value of a low cardinality attribute,
+	   the row of rid (page, slot) is page * slotsPerPage + slot of the table
+	2. Page 1 is BitmapIndexHeader, the values and their bitmaps are stored one after another from page 2 on.
+	   They are read into memory when the index is opened and written back by ForcePages when they changed
+	3. Lookup gives the rows of a CompOp as one bitmap, the bitmaps of several conditions combine with And, Or and AndNot
+	   before any row is read and GetRids turns the result into rids in the order of the table
+*/
+
+#include "Utils.hpp"
+#include "BufferManager.hpp"
+#include "RecordIdentifier.hpp"
+#include "RoaringBitmap.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct BitmapIndexHeader {				// page 1 of every bitmap index
+
+	char identifyString[Utils::IDENTIFYSTRINGLEN];		// "MicroSQL BitmapIndex"
+
+	AttrType attrType;
+
+	size_t attrLength;
+
+	size_t slotsPerPage;		// of the table, the rows of a page are numbered one after another
+
+	size_t numPages;
+
+	size_t numEntries;
+
+	size_t numValues;
+
+	size_t dataLength;			// the bytes of the values and bitmaps from page 2 on
+
+	BitmapIndexHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::BITMAPINDEXIDENTIFYSTRING);
+		attrLength = slotsPerPage = numPages = numEntries = numValues = dataLength = 0;
+	}
+
+};
+
+class BitmapIndexHandle {
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	BitmapIndexHandle ( );
+	~BitmapIndexHandle ( );
+
+	RETCODE Open (BufferManagerPtr buf);
+
+	RETCODE InsertEntry (void * pData, const RecordIdentifier & rid);		// ENTRYEXISTS if the index has the key with rid
+
+	RETCODE DeleteEntry (void * pData, const RecordIdentifier & rid);		// KEYNOTFOUND if it has not
+
+	RETCODE Lookup (CompOp compOp, void * value, RoaringBitmap & rows) const;		// the rows whose value satisfies compOp, every row for NO_OP
+
+	RETCODE GetRids (const RoaringBitmap & rows, std::vector<RecordIdentifier> & rids) const;
+
+	RETCODE ForcePages ( );
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	AttrType attrType ( ) const;
+
+	size_t attrLen ( ) const;
+
+	size_t numEntries ( ) const;
+
+	size_t numValues ( ) const;
+
+	bool IsValid ( ) const;
+
+private:
+
+	RETCODE readHeader ( );
+
+	RETCODE saveHeader ( ) const;
+
+	RETCODE readValues ( );
+
+	RETCODE saveValues ( );
+
+	RETCODE pageData (PageNum page, char *& pData) const;
+
+	RETCODE rowOf (const RecordIdentifier & rid, uint32_t & row) const;		// OUTOFRANGE if the row does not fit 32 bits
+
+	std::string keyOf (const void * value) const;		// attrLen bytes, a STRING ends with '\0' and -0.0f is 0.0f
+
+	std::map<std::string, RoaringBitmap> _values;
+
+	bool _valuesModified;
+
+	BitmapIndexHeader header;
+
+	BufferManagerPtr bufMgr;
+
+	mutable bool headerModified;
+
+};
+
+using BitmapIndexHandlePtr = shared_ptr<BitmapIndexHandle>;
+
+BitmapIndexHandle::BitmapIndexHandle ( ) {
+	bufMgr = nullptr;
+	headerModified = false;
+	_valuesModified = false;
+}
+
+BitmapIndexHandle::~BitmapIndexHandle ( ) {
+	RETCODE result;
+
+	if ( _valuesModified && bufMgr != nullptr && ( result = saveValues ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+	}
+
+	if ( headerModified && bufMgr != nullptr && ( result = saveHeader ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+	}
+}
+
+inline RETCODE BitmapIndexHandle::Open (BufferManagerPtr buf) {
+	RETCODE result;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( buf == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = buf;
+
+	if ( ( result = readHeader ( ) ) || ( result = readValues ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::InsertEntry (void * pData, const RecordIdentifier & rid) {
+	RETCODE result;
+	uint32_t row;
+
+	if ( pData == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( result = rowOf (rid, row) )
+		return result;
+
+	RoaringBitmap & rows = _values[keyOf (pData)];
+
+	if ( rows.Contains (row) )
+		return RETCODE::ENTRYEXISTS;
+
+	rows.Add (row);
+	header.numEntries++;
+	header.numValues = _values.size ( );
+	headerModified = _valuesModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	A value without rows is dropped
+*/
+inline RETCODE BitmapIndexHandle::DeleteEntry (void * pData, const RecordIdentifier & rid) {
+	RETCODE result;
+	uint32_t row;
+
+	if ( pData == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( result = rowOf (rid, row) )
+		return result;
+
+	auto it = _values.find (keyOf (pData));
+
+	if ( it == _values.end ( ) || !it->second.Contains (row) )
+		return RETCODE::KEYNOTFOUND;
+
+	it->second.Remove (row);
+
+	if ( it->second.IsEmpty ( ) )
+		_values.erase (it);
+
+	header.numEntries--;
+	header.numValues = _values.size ( );
+	headerModified = _valuesModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Every value is compared once, so the cost grows with the number of distinct values and not with the rows
+*/
+inline RETCODE BitmapIndexHandle::Lookup (CompOp compOp, void * value, RoaringBitmap & rows) const {
+	rows = RoaringBitmap ( );
+
+	if ( compOp != NO_OP && value == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( compOp == EQ_OP ) {
+		auto it = _values.find (keyOf (value));
+
+		if ( it != _values.end ( ) )
+			rows = it->second;
+
+		return RETCODE::COMPLETE;
+	}
+
+	std::string key = compOp == NO_OP ? std::string ( ) : keyOf (value);
+
+	for ( const auto & entry : _values ) {
+		void * stored = const_cast< char* >( entry.first.data ( ) );
+		void * probe = const_cast< char* >( key.data ( ) );
+		bool match;
+
+		switch ( compOp ) {
+		case LT_OP: match = CompMethod::less_than (stored, probe, attrType ( ), attrLen ( )); break;
+		case GT_OP: match = CompMethod::greater_than (stored, probe, attrType ( ), attrLen ( )); break;
+		case LE_OP: match = CompMethod::less_than_or_eq_to (stored, probe, attrType ( ), attrLen ( )); break;
+		case GE_OP: match = CompMethod::greater_than_or_eq_to (stored, probe, attrType ( ), attrLen ( )); break;
+		case NE_OP: match = CompMethod::not_equal (stored, probe, attrType ( ), attrLen ( )); break;
+		case NO_OP: match = true; break;
+		default:
+			return RETCODE::BADOP;
+		}
+
+		if ( match )
+			rows = rows.Or (entry.second);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::GetRids (const RoaringBitmap & rows, std::vector<RecordIdentifier> & rids) const {
+	std::vector<uint32_t> values;
+
+	rows.ToArray (values);
+	rids.clear ( );
+	rids.reserve (values.size ( ));
+
+	for ( uint32_t row : values )
+		rids.push_back (RecordIdentifier { static_cast< PageNum >( row / header.slotsPerPage ), static_cast< SlotNum >( row % header.slotsPerPage ) });
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::ForcePages ( ) {
+	RETCODE result;
+
+	if ( _valuesModified && ( result = saveValues ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = saveHeader ( ) ) || ( result = bufMgr->FlushPages ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline AttrType BitmapIndexHandle::attrType ( ) const {
+	return header.attrType;
+}
+
+inline size_t BitmapIndexHandle::attrLen ( ) const {
+	return header.attrLength;
+}
+
+inline size_t BitmapIndexHandle::numEntries ( ) const {
+	return header.numEntries;
+}
+
+inline size_t BitmapIndexHandle::numValues ( ) const {
+	return _values.size ( );
+}
+
+inline bool BitmapIndexHandle::IsValid ( ) const {
+	return strcmp (header.identifyString, Utils::BITMAPINDEXIDENTIFYSTRING) == 0;
+}
+
+inline RETCODE BitmapIndexHandle::readHeader ( ) {
+	RETCODE result;
+	char * pData;
+
+	if ( result = pageData (HEADERPAGE, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (BitmapIndexHeader), pData, sizeof (BitmapIndexHeader));
+
+	if ( !IsValid ( ) || header.slotsPerPage == 0 ) {
+		Utils::PrintRetcode (RETCODE::INVALIDINDEX, __FUNCTION__, __LINE__);
+		return RETCODE::INVALIDINDEX;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::saveHeader ( ) const {
+	RETCODE result;
+	char * pData;
+
+	if ( result = pageData (HEADERPAGE, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (BitmapIndexHeader), reinterpret_cast< const void* >( &header ), sizeof (BitmapIndexHeader));
+
+	if ( result = bufMgr->ForcePage (HEADERPAGE) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Every value is its attrLen bytes, the length of its bitmap and the bitmap
+*/
+inline RETCODE BitmapIndexHandle::readValues ( ) {
+	RETCODE result;
+	std::vector<char> data (header.dataLength);
+	char * pData;
+
+	for ( size_t done = 0; done < data.size ( ); done += Utils::PAGESIZE ) {
+		if ( result = pageData (static_cast< PageNum >( HEADERPAGE + 1 + done / Utils::PAGESIZE ), pData) )
+			return result;
+
+		memcpy (data.data ( ) + done, pData, std::min (Utils::PAGESIZE, data.size ( ) - done));
+	}
+
+	const char * pos = data.data ( ), * end = data.data ( ) + data.size ( );
+
+	for ( size_t i = 0; i < header.numValues; i++ ) {
+		uint32_t length;
+
+		if ( static_cast< size_t >( end - pos ) < attrLen ( ) + sizeof (length) )
+			return RETCODE::INVALIDINDEX;
+
+		std::string key (pos, attrLen ( ));
+
+		memcpy (&length, pos + attrLen ( ), sizeof (length));
+		pos += attrLen ( ) + sizeof (length);
+
+		if ( static_cast< size_t >( end - pos ) < length || _values[key].Deserialize (pos, length) )
+			return RETCODE::INVALIDINDEX;
+
+		pos += length;
+	}
+
+	_valuesModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The pages from page 2 on are overwritten, the file gets the pages it lacks
+*/
+inline RETCODE BitmapIndexHandle::saveValues ( ) {
+	RETCODE result;
+	std::vector<char> data;
+
+	for ( const auto & entry : _values ) {
+		uint32_t length = static_cast< uint32_t >( entry.second.SerializedSize ( ) );
+		size_t pos = data.size ( );
+
+		data.resize (pos + attrLen ( ) + sizeof (length) + length);
+		memcpy (data.data ( ) + pos, entry.first.data ( ), attrLen ( ));
+		memcpy (data.data ( ) + pos + attrLen ( ), &length, sizeof (length));
+		entry.second.Serialize (data.data ( ) + pos + attrLen ( ) + sizeof (length));
+	}
+
+	for ( size_t done = 0; done < data.size ( ); done += Utils::PAGESIZE ) {
+		PageNum page = static_cast< PageNum >( HEADERPAGE + 1 + done / Utils::PAGESIZE );
+		PagePtr pagePtr;
+		char * pData;
+
+		if ( page > header.numPages ) {
+			PageNum allocated;
+
+			if ( ( result = bufMgr->AllocatePage (pagePtr) ) || ( result = pagePtr->GetPageNum (allocated) ) || ( result = bufMgr->UnlockPage (allocated) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			if ( allocated != page )
+				return RETCODE::UNEXPECTED;
+
+			header.numPages++;
+		}
+
+		if ( ( result = pageData (page, pData) ) || ( result = bufMgr->MarkDirty (page) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		memcpy (pData, data.data ( ) + done, std::min (Utils::PAGESIZE, data.size ( ) - done));
+	}
+
+	header.dataLength = data.size ( );
+	header.numValues = _values.size ( );
+	headerModified = true;
+	_valuesModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::pageData (PageNum page, char *& pData) const {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) ) || ( result = pagePtr->GetData (pData) ) )
+		return result;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BitmapIndexHandle::rowOf (const RecordIdentifier & rid, uint32_t & row) const {
+	PageNum page;
+	SlotNum slot;
+
+	if ( rid.GetPageNum (page) || rid.GetSlotNum (slot) || slot >= header.slotsPerPage )
+		return RETCODE::OUTOFRANGE;
+
+	unsigned long long number = static_cast< unsigned long long >( page ) * header.slotsPerPage + slot;
+
+	if ( number > UINT32_MAX )
+		return RETCODE::OUTOFRANGE;
+
+	row = static_cast< uint32_t >( number );
+
+	return RETCODE::COMPLETE;
+}
+
+inline std::string BitmapIndexHandle::keyOf (const void * value) const {
+	std::string key (attrLen ( ), '\0');
+
+	if ( attrType ( ) == STRING )
+		memcpy (&key[0], value, strnlen (reinterpret_cast< const char* >( value ), attrLen ( )));
+	else if ( attrType ( ) == FLOAT && *reinterpret_cast< const float* >( value ) == 0.0f )
+		memset (&key[0], 0, attrLen ( ));
+	else
+		memcpy (&key[0], value, attrLen ( ));
+
+	return key;
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+/*
+	1. BloomFilter keeps a Bloom filter of some attributes for every group of GROUPPAGES data pages of a RecordFile
+	2. The filters are stored in their own page file "<file>.bf", page 1 is BloomFilterHeader, the groups start from page 2
+	3. Every attribute has its own false positive rate, the filter of a group is sized for a full group
+	4. Inserts add to the filter, deletes and updates only mark the group stale, the RecordFile rebuilds a stale group
+	   when a scan consults it
+	5. Only equality can be answered, a group whose filter does not contain the value has no such record
+*/
+
+#include "Utils.hpp"
+#include "BufferManager.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+struct BloomAttr {
+	int      offset;
+	AttrType attrType;
+	int      attrLength;
+	int      numBits;
+	int      numHashes;
+};
+
+struct BloomFilterHeader {					// stored in page 1 of every Bloom filter file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL BloomFilter"
+	size_t attrCount;
+	size_t groupSize;						// bytes of the filters of one group
+	PageNum numMapPages;
+	BloomAttr attrs[1];						// attrCount attributes follow the header
+
+	BloomFilterHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::BLOOMFILTERIDENTIFYSTRING);
+		attrCount = groupSize = 0;
+		numMapPages = 0;
+	}
+};
+
+class BloomFilter {
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static PageNum FIRSTMAPPAGE = 2;
+
+	const static PageNum FIRSTDATAPAGE = 2;		// the first data page of a RecordFile
+
+	const static PageNum GROUPPAGES = 4;
+
+	const static int MAXHASHES = 16;
+
+	/*
+		The first byte of a group
+	*/
+	const static char GROUPUSED = 1;			// a record has been added to the group
+
+	const static char GROUPSTALE = 2;			// a record of the group has been deleted or updated since the filters were built
+
+	BloomFilter ( );
+	~BloomFilter ( );
+
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE Create (const BufferManagerPtr & ptr, int attrCount, const DataAttrInfo * attributes, size_t recordsPerPage);	// write the header page of a new filter file
+
+	RETCODE Add (PageNum page, const char * pData);			// add the values of the record to the group of page
+
+	RETCODE MarkStale (PageNum page);
+
+	RETCODE Clear (PageNum page);							// empty the group of page before it is rebuilt
+
+	bool IsStale (PageNum page) const;
+
+	size_t FindAttr (size_t attrOffset, AttrType attrType, size_t attrLength) const;	// UNKNOWNPOS if not tracked
+
+	bool MayContain (PageNum page, size_t attr, void * value) const;	// false if no record of the group of page has the value
+
+	RETCODE Flush ( );
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	/*
+		Static Functions
+	*/
+	static std::string FileName (const char * fileName);
+
+	static bool IsTracked (const DataAttrInfo & attr);
+
+	static PageNum FirstPageOfGroup (PageNum page);			// the first data page of the group of page
+
+private:
+
+	RETCODE writeGroup (size_t group);
+
+	RETCODE saveHeader ( );
+
+	static unsigned long long hash (const void * value, AttrType attrType, size_t attrLength);
+
+	static size_t groupOf (PageNum page);
+
+	char * groupData (size_t group);
+
+	const char * groupData (size_t group) const;
+
+	size_t groupsPerPage ( ) const;
+
+	BloomFilterHeader header;
+
+	std::vector<BloomAttr> _attrs;
+
+	std::vector<size_t> _attrPos;			// position of the bits of every attribute in a group
+
+	std::vector<char> _groups;				// copy of the filters, one group after another
+
+	mutable std::mutex _mutex;
+
+	BufferManagerPtr bufMgr;
+
+};
+
+using BloomFilterPtr = shared_ptr<BloomFilter>;
+
+BloomFilter::BloomFilter ( ) {
+	bufMgr = nullptr;
+}
+
+BloomFilter::~BloomFilter ( ) {
+	if ( bufMgr != nullptr )
+		Flush ( );
+}
+
+inline RETCODE BloomFilter::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+	PagePtr page;
+	char * pData;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (BloomFilterHeader), pData, sizeof (BloomFilterHeader));
+
+	if ( strcmp (header.identifyString, Utils::BLOOMFILTERIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDPAGEFILE;
+
+	const BloomAttr * attrs = reinterpret_cast< const BloomAttr* >( pData + offsetof (BloomFilterHeader, attrs) );
+	size_t pos = 1;			// the first byte of a group keeps GROUPUSED and GROUPSTALE
+
+	for ( size_t i = 0; i < header.attrCount; i++ ) {
+		_attrs.push_back (attrs[i]);
+		_attrPos.push_back (pos);
+		pos += attrs[i].numBits / 8;
+	}
+
+	for ( PageNum mapPage = FIRSTMAPPAGE; mapPage < FIRSTMAPPAGE + header.numMapPages; mapPage++ ) {
+		if ( ( result = bufMgr->GetPage (mapPage, page) ) || ( result = bufMgr->UnlockPage (mapPage) )
+			 || ( result = page->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_groups.insert (_groups.end ( ), pData, pData + groupsPerPage ( ) * header.groupSize);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	numBits = -n * ln(p) / ln(2)^2 and numHashes = numBits / n * ln(2) for n values and false positive rate p
+*/
+inline RETCODE BloomFilter::Create (const BufferManagerPtr & ptr, int attrCount, const DataAttrInfo * attributes, size_t recordsPerPage) {
+	RETCODE result;
+	PagePtr page;
+	PageNum pageNum;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+	header.groupSize = 1;
+
+	double n = static_cast< double >( recordsPerPage * GROUPPAGES );
+	double ln2 = std::log (2.0);
+
+	for ( int i = 0; i < attrCount && n > 0; i++ ) {
+		if ( !IsTracked (attributes[i]) )
+			continue;
+
+		double bits = std::ceil (-n * std::log (attributes[i].bloomFilter) / ( ln2 * ln2 ));
+		BloomAttr attr = { attributes[i].offset, attributes[i].attrType, attributes[i].attrLength, 0, 0 };
+
+		if ( attributes[i].dictionary ) {		// the record keeps the int code
+			attr.attrType = INT;
+			attr.attrLength = sizeof (int);
+		}
+
+		attr.numBits = static_cast< int >( ( static_cast< size_t >( bits ) + 7 ) / 8 * 8 );
+		attr.numHashes = static_cast< int >( std::lround (attr.numBits / n * ln2) );
+		attr.numHashes = attr.numHashes < 1 ? 1 : attr.numHashes > MAXHASHES ? MAXHASHES : attr.numHashes;
+
+		if ( offsetof (BloomFilterHeader, attrs) + ( _attrs.size ( ) + 1 ) * sizeof (BloomAttr) > Utils::PAGESIZE
+			 || header.groupSize + attr.numBits / 8 > Utils::PAGESIZE )
+			break;			// the other attributes are not tracked
+
+		_attrs.push_back (attr);
+		_attrPos.push_back (header.groupSize);
+		header.groupSize += attr.numBits / 8;
+	}
+
+	header.attrCount = _attrs.size ( );
+
+	if ( ( result = bufMgr->AllocatePage (page) ) || ( result = page->GetPageNum (pageNum) )
+		 || ( result = bufMgr->UnlockPage (pageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return saveHeader ( );
+}
+
+inline RETCODE BloomFilter::Add (PageNum page, const char * pData) {
+	std::lock_guard<std::mutex> guard (_mutex);
+	RETCODE result;
+
+	if ( _attrs.empty ( ) || page < FIRSTDATAPAGE )
+		return RETCODE::COMPLETE;
+
+	size_t group = groupOf (page);
+
+	while ( group >= _groups.size ( ) / header.groupSize ) {		// the filters grow with the data file
+		PagePtr mapPage;
+		PageNum mapPageNum;
+
+		if ( ( result = bufMgr->AllocatePage (mapPage) ) || ( result = mapPage->GetPageNum (mapPageNum) )
+			 || ( result = bufMgr->UnlockPage (mapPageNum) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_groups.resize (_groups.size ( ) + groupsPerPage ( ) * header.groupSize, 0);
+		header.numMapPages++;
+
+		if ( result = saveHeader ( ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	char * g = groupData (group);
+	bool modified = !( g[0] & GROUPUSED );
+
+	for ( size_t i = 0; i < _attrs.size ( ); i++ ) {
+		unsigned long long h = hash (pData + _attrs[i].offset, _attrs[i].attrType, _attrs[i].attrLength);
+		unsigned int h1 = static_cast< unsigned int >( h ), h2 = static_cast< unsigned int >( h >> 32 ) | 1;
+		unsigned char * bits = reinterpret_cast< unsigned char* >( g + _attrPos[i] );
+
+		for ( int k = 0; k < _attrs[i].numHashes; k++ ) {
+			size_t bit = ( h1 + static_cast< unsigned long long >( k ) * h2 ) % _attrs[i].numBits;
+
+			if ( !( bits[bit / 8] & ( 1 << ( bit % 8 ) ) ) ) {
+				bits[bit / 8] |= 1 << ( bit % 8 );
+				modified = true;
+			}
+		}
+	}
+
+	g[0] |= GROUPUSED;
+
+	return modified ? writeGroup (group) : RETCODE::COMPLETE;
+}
+
+inline RETCODE BloomFilter::MarkStale (PageNum page) {
+	std::lock_guard<std::mutex> guard (_mutex);
+	size_t group = groupOf (page);
+
+	if ( _attrs.empty ( ) || page < FIRSTDATAPAGE || group >= _groups.size ( ) / header.groupSize
+		 || ( groupData (group)[0] & GROUPSTALE ) )
+		return RETCODE::COMPLETE;
+
+	groupData (group)[0] |= GROUPSTALE;
+
+	return writeGroup (group);
+}
+
+inline RETCODE BloomFilter::Clear (PageNum page) {
+	std::lock_guard<std::mutex> guard (_mutex);
+	size_t group = groupOf (page);
+
+	if ( _attrs.empty ( ) || page < FIRSTDATAPAGE || group >= _groups.size ( ) / header.groupSize )
+		return RETCODE::COMPLETE;
+
+	memset (groupData (group), 0, header.groupSize);
+
+	return writeGroup (group);
+}
+
+inline bool BloomFilter::IsStale (PageNum page) const {
+	std::lock_guard<std::mutex> guard (_mutex);
+	size_t group = groupOf (page);
+
+	return page >= FIRSTDATAPAGE && group < _groups.size ( ) / header.groupSize
+		&& ( groupData (group)[0] & GROUPSTALE );
+}
+
+inline size_t BloomFilter::FindAttr (size_t attrOffset, AttrType attrType, size_t attrLength) const {
+	for ( size_t i = 0; i < _attrs.size ( ); i++ ) {
+		if ( static_cast< size_t >( _attrs[i].offset ) == attrOffset && _attrs[i].attrType == attrType
+			 && static_cast< size_t >( _attrs[i].attrLength ) == attrLength )
+			return i;
+	}
+
+	return Utils::UNKNOWNPOS;
+}
+
+inline bool BloomFilter::MayContain (PageNum page, size_t attr, void * value) const {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	if ( attr >= _attrs.size ( ) || page < FIRSTDATAPAGE )
+		return true;
+
+	size_t group = groupOf (page);
+
+	if ( group >= _groups.size ( ) / header.groupSize || !( groupData (group)[0] & GROUPUSED ) )	// no record has been added to the group
+		return false;
+
+	unsigned long long h = hash (value, _attrs[attr].attrType, _attrs[attr].attrLength);
+	unsigned int h1 = static_cast< unsigned int >( h ), h2 = static_cast< unsigned int >( h >> 32 ) | 1;
+	const unsigned char * bits = reinterpret_cast< const unsigned char* >( groupData (group) + _attrPos[attr] );
+
+	for ( int k = 0; k < _attrs[attr].numHashes; k++ ) {
+		size_t bit = ( h1 + static_cast< unsigned long long >( k ) * h2 ) % _attrs[attr].numBits;
+
+		if ( !( bits[bit / 8] & ( 1 << ( bit % 8 ) ) ) )
+			return false;
+	}
+
+	return true;
+}
+
+inline RETCODE BloomFilter::Flush ( ) {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	return bufMgr->FlushPages ( );
+}
+
+inline RETCODE BloomFilter::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline std::string BloomFilter::FileName (const char * fileName) {
+	return std::string (fileName) + ".bf";
+}
+
+inline bool BloomFilter::IsTracked (const DataAttrInfo & attr) {
+	if ( !( attr.bloomFilter > 0 && attr.bloomFilter < 1 ) )
+		return false;
+
+	switch ( attr.attrType ) {
+	case INT:
+	case FLOAT:
+	case STRING:
+		return attr.attrLength > 0;
+	default:
+		return false;
+	}
+}
+
+inline PageNum BloomFilter::FirstPageOfGroup (PageNum page) {
+	return FIRSTDATAPAGE + groupOf (page) * GROUPPAGES;
+}
+
+/*
+	Values that CompMethod::equal takes as equal must have the same hash:
+	a STRING ends at its first '\0' and 0.0f and -0.0f are the same FLOAT
+*/
+inline unsigned long long BloomFilter::hash (const void * value, AttrType attrType, size_t attrLength) {
+	const unsigned char * bytes = reinterpret_cast< const unsigned char* >( value );
+	size_t length = attrLength;
+	float zero = 0.0f;
+
+	if ( attrType == STRING )
+		length = strnlen (reinterpret_cast< const char* >( value ), attrLength);
+	else if ( attrType == FLOAT && *reinterpret_cast< const float* >( value ) == 0.0f )
+		bytes = reinterpret_cast< const unsigned char* >( &zero );
+
+	unsigned long long h = 14695981039346656037ULL;			// FNV-1a
+
+	for ( size_t i = 0; i < length; i++ ) {
+		h ^= bytes[i];
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
+
+inline size_t BloomFilter::groupOf (PageNum page) {
+	return ( page - FIRSTDATAPAGE ) / GROUPPAGES;
+}
+
+/*
+	The map page stays in the buffer and is written when the filters are flushed
+*/
+inline RETCODE BloomFilter::writeGroup (size_t group) {
+	RETCODE result;
+	PagePtr mapPage;
+	PageNum mapPageNum = FIRSTMAPPAGE + group / groupsPerPage ( );
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (mapPageNum, mapPage) ) || ( result = bufMgr->UnlockPage (mapPageNum) )
+		 || ( result = mapPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy (pData + ( group % groupsPerPage ( ) ) * header.groupSize, groupData (group), header.groupSize);
+
+	return bufMgr->MarkDirty (mapPageNum);
+}
+
+inline RETCODE BloomFilter::saveHeader ( ) {
+	RETCODE result;
+	PagePtr page;
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, Utils::PAGESIZE, reinterpret_cast< const void* >( &header ), offsetof (BloomFilterHeader, attrs));
+	memcpy (pData + offsetof (BloomFilterHeader, attrs), _attrs.data ( ), _attrs.size ( ) * sizeof (BloomAttr));
+
+	return bufMgr->ForcePage (HEADERPAGE);
+}
+
+inline char * BloomFilter::groupData (size_t group) {
+	return _groups.data ( ) + group * header.groupSize;
+}
+
+inline const char * BloomFilter::groupData (size_t group) const {
+	return _groups.data ( ) + group * header.groupSize;
+}
+
+inline size_t BloomFilter::groupsPerPage ( ) const {
+	return Utils::PAGESIZE / header.groupSize;
+}
@@ -7,13 +7,22 @@
 	2. B+, ˸֮ÿ(ڲ/Ҷ)[floor(m/2), m-1]key
 	ÿmchildָ(Ǳkey1)
 	3. ʱҪݸƵpagePtrpData
+	4. A node stores the common prefix of its STRING keys once, and every key only up to the length of the longest one,
+	   separators in internal nodes are cut to the bytes that tell the two children apart
+	5. The header is written back only if it changed since it was read or written, a node only read never writes the page
+	6. A leaf may keep payloadLen bytes for every key after the rids, the INCLUDE values of a COMPOSITE index.
+	   An entry is the attrLen bytes of the key followed by its payload, only the key is compared and internal nodes have no payload
 
 */
 
 #include "Utils.hpp"
 #include "RecordIdentifier.hpp"
+#include "KeyPolicy.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <list>
+#include <vector>
 
 class BpTreeNode;
 
@@ -23,49 +32,62 @@ struct BpTreeNodeHeader {
 
 	char identifyChar;				// 'I' for internal node, 'L' for leaf node
 
-	size_t maxKeys;					// the order of bptree
+	size_t maxKeys;					// the keys the page holds with the prefixLen and keyWidth of the node
 	size_t numKeys;
 
 	PageNum parentNode;
 
 	PageNum page;
 
-	PageNum prevNode;		// only for leaf nodes
+	PageNum prevNode;		// the neighbors on the same level
 	PageNum nextNode;
 
 	AttrType type;
 
 	size_t attrLen;
 
+	size_t prefixLen;				// bytes shared by every key, stored once before the keys
+	size_t keyWidth;				// bytes stored for every key after the prefix, the key is '\0' after them
+
+	size_t payloadLen;				// bytes stored for every key after the rids, leaves only
+
 	BpTreeNodeHeader() {
 		identifyChar = 'B';
-		attrLen = maxKeys = numKeys = 0 ;
+		attrLen = maxKeys = numKeys = prefixLen = keyWidth = payloadLen = 0 ;
 		parentNode = page = prevNode = nextNode = Utils::UNKNOWNPAGENUM;
 	}
 
 };
 
 class BpTreeNode {
-	
+
 	friend class IndexHandle;
 
 public:
 
+	const static char LEAFNODE = 'L';
+
+	const static char INTERNALNODE = 'I';
 
 	using Comparator = int (*) ( void *, void *, size_t );
 
-	BpTreeNode (AttrType , size_t , PagePtr, bool );
+	BpTreeNode (AttrType , size_t , PagePtr, bool, size_t payloadLen = 0 );		// payloadLen of a new node
 
 	~BpTreeNode ( );
 
-	RETCODE Insert (void* newKey, const RecordIdentifier & rid);
+	RETCODE Insert (void* newKey, const RecordIdentifier & rid);			// newKey is an entry, the payload follows the key
+	RETCODE Insert (size_t pos, void* newKey, const RecordIdentifier & rid);		// insert before the key at pos
 
 	RETCODE Delete (void * newKey);
 	RETCODE Delete (size_t pos);
 
-	//RETCODE Delete (size_t slot);
+	/*
+		Replace the keys of the node by n sorted entries of attrLen + payloadLen bytes and their rids
+		return NODEKEYSFULL and keep the node if the page cannot hold them
+	*/
+	RETCODE Load (const char * newKeys, const RecordIdentifier * newRids, size_t n);
 
-	/* 
+	/*
 		return COMPLETE if the key is in the node
 		if the key is duplicated, return the right most keyPos
 		if the rid is specified, only return COMPLETE when key and rid both matched
@@ -81,14 +103,16 @@ public:
 	RETCODE FindKey (void * key, const RecordIdentifier & rid, size_t & keyPos) const;
 	size_t FindKey (void * key, const RecordIdentifier & rid = UNKNOWNRID) const;
 	size_t FindKeyPosFit (void * key) const;
-		
-	void * LargestKey ( ) const;
-	void * SmallestKey ( ) const;
-
-	RETCODE SetKey (size_t keyPos, void * key);
-	RETCODE GetKey (size_t keyPos, void* & key) const;
-	void * GetKey (size_t keyPos) const;
-	
+
+	size_t LowerBound (void * key) const;			// the first position whose key is not less than key
+	size_t UpperBound (void * key) const;			// the first position whose key is greater than key
+
+	RETCODE CopyKeyTo (size_t pos, void * dst) const;		// the key is decoded to attrLen bytes
+
+	RETCODE CopyEntryTo (size_t pos, void * dst) const;		// the key and then its payload, attrLen + payloadLen bytes
+
+	RETCODE CopyKeysTo (char * dst, RecordIdentifier * dstRids) const;		// every entry and rid of the node
+
 	RecordIdentifier GetRid (size_t keyPos) const;
 	RecordIdentifier GetRid (void * key) const;
 	RETCODE SetRid (size_t keyPos, const RecordIdentifier &) const;
@@ -99,7 +123,8 @@ public:
 	RETCODE Print ( ) const;
 
 	size_t GetMaxKeys ( ) const;
-	void SetMaxKeys (size_t val );
+
+	size_t GetPayloadLen ( ) const;
 
 	size_t GetNumKeys ( ) const;
 	void SetNumKeys (size_t val );
@@ -120,33 +145,75 @@ public:
 
 	bool IsLeaf ( ) const;
 
-	RETCODE CopyKeyTo (size_t pos, void * dst) const;
+	void SetLeaf (bool leaf);
 
 	int comp (void *, void *) const;
 
+	/*
+		Static Functions
+	*/
+	static size_t MaxKeys (size_t attrLen, size_t payloadLen = 0);			// the number of uncompressed keys a page can hold
+
+	static size_t Capacity (size_t prefixLen, size_t keyWidth, size_t payloadLen = 0);		// the number of keys a page can hold with the layout
+
+	// with the layout of the n sorted entries of attrLen + payloadLen bytes
+	static size_t Capacity (AttrType type, size_t attrLen, size_t payloadLen, const char * keys, size_t n);
+
+	static size_t RidsOffset (size_t keyBytes);		// offset of rids from the end of the header, keyBytes holds the prefix and the keys
+
+	static void Separator (AttrType type, size_t attrLen, const void * left, const void * right, void * sep);
+
+	static void MinKey (AttrType type, size_t attrLen, void * key);		// not greater than any key of the type
+
 private:
 
 	size_t attrLen ( )const;
 
+	size_t entryLen ( ) const;			// the key and the payload
+
+	bool isCompressed ( ) const;
+
+	size_t keyBytes (const void * key) const;		// the bytes of the key before its trailing '\0'
+
+	bool fits (const void * key) const;			// the key can be stored with the current layout
+
+	RETCODE makeRoom (const void * key);
+
+	void setLayout (size_t prefixLen, size_t keyWidth);
+
+	void encode (const void * key, char * slot) const;
+
+	void insertAt (size_t pos, void * key, const RecordIdentifier & rid);
+
+	void storeEntries (const char * entries, const RecordIdentifier * newRids, size_t n);		// into the current layout
+
+	template <bool Upper>
+	size_t stringBound (void * key) const;
+
+	char * slotAt (size_t) const;
+
 	void * keyAt (size_t) const;
 
 	RecordIdentifier ridAt (size_t) const;
 
 	RETCODE writePage ( ) const;
 
-	Comparator _comp;
+	static void layoutOf (size_t attrLen, size_t entryLen, const char * keys, size_t n, size_t & prefixLen, size_t & keyWidth);
 
-	/*
-		Contains only 4 members
-	*/
+	Comparator _comp;
 
 	BpTreeNodeHeader header;
 
-	void * keys;							// the array of record identifiers (value); 
-												// for internal nodes, rids[i].page is a pointer to the i-th children, rids[i].slot = 0
-												// for leave nodes, rid[i].page and rid[i].slot indicates the record whose target attribute is to keys[i]
+	mutable BpTreeNodeHeader written;		// the header as it is in the page
+
+	char * prefix;							// the common prefix of STRING keys
+
+	char * keys;							// the array of keys, keyWidth bytes each
+
+	RecordIdentifier * rids;				// for internal nodes, rids[i].page is a pointer to the i-th children, rids[i].slot = 0
+											// for leave nodes, rid[i].page and rid[i].slot indicates the record whose target attribute is to keys[i]
 
-	RecordIdentifier * rids;
+	char * payloads;						// the payload of every key, payloadLen bytes each
 
 	PagePtr pagePtr;			// should not write into page
 
@@ -155,18 +222,25 @@ private:
 /*
 	if newNode is true, write the data to the page
 	if newNode is false, read header from the page
+	the prefix, keyWidth bytes for each of maxKeys keys, maxKeys rids and maxKeys payloads follow the header
 */
-BpTreeNode::BpTreeNode (AttrType _type, size_t _attrLen, PagePtr  _page, bool newNode) {
+BpTreeNode::BpTreeNode (AttrType _type, size_t _attrLen, PagePtr  _page, bool newNode, size_t payloadLen) {
 	char* pData;
 	RETCODE result;
 
+	prefix = nullptr;
+	keys = nullptr;
+	rids = nullptr;
+	payloads = nullptr;
+	_comp = nullptr;
+
 	if ( result = _page->GetData (pData) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return;
 	}
 
 	pagePtr = _page;
-	
+
 	pagePtr->GetPageNum (header.page);
 
 	if ( newNode ) {
@@ -175,20 +249,13 @@ BpTreeNode::BpTreeNode (AttrType _type, size_t _attrLen, PagePtr  _page, bool ne
 
 		header.attrLen = _attrLen;
 
-		switch ( header.type ) {
-		case INT:
-			_comp = CompMethod::compare_int;
-			break;
-		case FLOAT:
-			_comp = CompMethod::compare_float;
-			break;
-		case STRING:
-			_comp = CompMethod::compare_string;
-			break;
-		default:
-			_comp = nullptr;
-			break;
-		}
+		header.prefixLen = 0;
+
+		header.keyWidth = _attrLen;
+
+		header.payloadLen = payloadLen;
+
+		header.maxKeys = MaxKeys (_attrLen, payloadLen);
 
 		memcpy_s (pData, sizeof (BpTreeNodeHeader), reinterpret_cast< const void* >( &header ), sizeof (BpTreeNodeHeader));
 
@@ -198,45 +265,65 @@ BpTreeNode::BpTreeNode (AttrType _type, size_t _attrLen, PagePtr  _page, bool ne
 
 	}
 
-	keys = pData+sizeof(header);
+	switch ( header.type ) {
+	case INT:
+		_comp = CompMethod::compare_int;
+		break;
+	case FLOAT:
+		_comp = CompMethod::compare_float;
+		break;
+	case STRING:
+		_comp = CompMethod::compare_string;
+		break;
+	case COMPOSITE:
+		_comp = CompMethod::compare_bytes;
+		break;
+	default:
+		_comp = nullptr;
+		break;
+	}
 
-	pData += sizeof (header);
+	setLayout (header.prefixLen, header.keyWidth);
 
-	rids = reinterpret_cast< RecordIdentifier *>( pData + attrLen ( ) * header.numKeys );
+	memcpy (&written, &header, sizeof (BpTreeNodeHeader));
 
 	return;
 }
 
 inline BpTreeNode::~BpTreeNode ( ) {
 	if ( this->pagePtr != nullptr ) {
-		this->writePage ( );
+		if ( memcmp (&header, &written, sizeof (BpTreeNodeHeader)) != 0 )
+			this->writePage ( );
 	} else {
 		Utils::PrintRetcode (RETCODE::INCOMPLETEWRITE, __FUNCTION__, __LINE__);
 	}
 }
 
+/*
+	The new key goes after the keys equal to it, the following keys, rids and payloads are moved by one memmove each
+*/
 inline RETCODE BpTreeNode::Insert (void * newKey, const RecordIdentifier & rid) {
+	RETCODE result;
 
-	if ( GetNumKeys ( ) + 1 >= GetMaxKeys ( ) ) {
-		return RETCODE::NODEKEYSFULL;
-	}
+	if ( result = makeRoom (newKey) )
+		return result;
 
-	size_t i;
+	insertAt (UpperBound (newKey), newKey, rid);
 
-	for ( i = this->GetNumKeys()-1; i >=0 ; --i ) {
-		if ( comp (newKey, keyAt(i) ) >= 0 ) {
-			break;
-		}
-		SetKey (i + 1, GetKey (i));
-		rids[i + 1] = rids[i];
-	}
+	return RETCODE::COMPLETE;
+}
 
-	SetKey (i, newKey);
-	rids[i] = rid;
+inline RETCODE BpTreeNode::Insert (size_t pos, void * newKey, const RecordIdentifier & rid) {
+	RETCODE result;
 
-	SetNumKeys (GetNumKeys ( ) + 1);
+	if ( pos > GetNumKeys ( ) )
+		return RETCODE::OUTOFRANGE;
+
+	if ( result = makeRoom (newKey) )
+		return result;
+
+	insertAt (pos, newKey, rid);
 
-	
 	return RETCODE::COMPLETE;
 }
 
@@ -245,31 +332,62 @@ inline RETCODE BpTreeNode::Delete ( void * key) {
 	if ( key == nullptr )
 		return RETCODE::BADKEY;
 
-	for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
-		if ( comp (keyAt (i), key) == 0 ) {
-			
-			for ( size_t j = i; j < this->GetNumKeys ( ) - 1; j++ ) {
-				SetKey (j, GetKey (j + 1));
-				rids[j] = rids[j + 1];
-			}
+	size_t pos = LowerBound (key);
 
-			SetNumKeys (GetNumKeys ( ) - 1);
-			return RETCODE::COMPLETE;
-		}
-	}
+	if ( pos == UpperBound (key) )
+		return RETCODE::KEYNOTFOUND;
 
-	return RETCODE::KEYNOTFOUND;
+	return this->Delete (pos);
 
 }
 
 inline RETCODE BpTreeNode::Delete (size_t pos) {
-	return this->Delete(keyAt(pos));
+
+	if ( pos >= GetNumKeys ( ) )
+		return RETCODE::KEYNOTFOUND;
+
+	size_t moved = GetNumKeys ( ) - pos - 1;
+
+	memmove (slotAt (pos), slotAt (pos + 1), moved * header.keyWidth);
+	memmove (static_cast< void* >( rids + pos ), rids + pos + 1, moved * sizeof (RecordIdentifier));
+	memmove (payloads + pos * header.payloadLen, payloads + ( pos + 1 ) * header.payloadLen, moved * header.payloadLen);
+
+	SetNumKeys (GetNumKeys ( ) - 1);
+
+	if ( GetNumKeys ( ) == 0 )			// an empty node takes any key again
+		setLayout (0, attrLen ( ));
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	STRING keys are stored after their longest common prefix and cut to the longest of them,
+	so a node of short or similar strings holds many more keys than attrLen allows
+*/
+inline RETCODE BpTreeNode::Load (const char * newKeys, const RecordIdentifier * newRids, size_t n) {
+	size_t prefixLen = 0, keyWidth = attrLen ( );
+
+	if ( isCompressed ( ) && n > 0 )
+		layoutOf (attrLen ( ), entryLen ( ), newKeys, n, prefixLen, keyWidth);
+
+	if ( n > Capacity (prefixLen, keyWidth, header.payloadLen) )
+		return RETCODE::NODEKEYSFULL;
+
+	setLayout (prefixLen, keyWidth);
+
+	memcpy (prefix, newKeys, prefixLen);
+
+	storeEntries (newKeys, newRids, n);
+
+	SetNumKeys (n);
+
+	return RETCODE::COMPLETE;
 }
 
 inline bool BpTreeNode::IsSorted ( ) const {
 
 	for ( size_t i = 1; i < this->GetNumKeys ( ); ++i ) {
-		if ( comp (keyAt(i-1) , keyAt(i)) > 0 ) {		// if is not increasing order
+		if ( _comp (slotAt (i - 1), slotAt (i), header.keyWidth) > 0 ) {		// if is not increasing order
 			return false;
 		}
 	}
@@ -278,7 +396,11 @@ inline bool BpTreeNode::IsSorted ( ) const {
 }
 
 bool BpTreeNode::IsLeaf ( ) const {
-	return header.identifyChar == 'L';
+	return header.identifyChar == LEAFNODE;
+}
+
+inline void BpTreeNode::SetLeaf (bool leaf) {
+	header.identifyChar = leaf ? LEAFNODE : INTERNALNODE;
 }
 
 inline RETCODE BpTreeNode::CopyKeyTo (size_t pos, void * dst) const {
@@ -290,7 +412,32 @@ inline RETCODE BpTreeNode::CopyKeyTo (size_t pos, void * dst) const {
 	if ( dst == nullptr )
 		return RETCODE::BADKEY;
 
-	memcpy_s (dst, attrLen ( ), keyAt (pos), attrLen ( ));
+	char * key = reinterpret_cast< char* >( dst );
+
+	memcpy (key, prefix, header.prefixLen);
+	memcpy (key + header.prefixLen, slotAt (pos), header.keyWidth);
+	memset (key + header.prefixLen + header.keyWidth, 0, attrLen ( ) - header.prefixLen - header.keyWidth);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BpTreeNode::CopyEntryTo (size_t pos, void * dst) const {
+	RETCODE result;
+
+	if ( result = CopyKeyTo (pos, dst) )
+		return result;
+
+	memcpy (reinterpret_cast< char* >( dst ) + attrLen ( ), payloads + pos * header.payloadLen, header.payloadLen);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE BpTreeNode::CopyKeysTo (char * dst, RecordIdentifier * dstRids) const {
+
+	for ( size_t i = 0; i < GetNumKeys ( ); i++ )
+		CopyEntryTo (i, dst + i * entryLen ( ));
+
+	memcpy (static_cast< void* >( dstRids ), rids, GetNumKeys ( ) * sizeof (RecordIdentifier));
 
 	return RETCODE::COMPLETE;
 }
@@ -302,25 +449,218 @@ inline int BpTreeNode::comp (void * p1, void * p2) const {
 	return _comp(p1, p2, attrLen());
 }
 
+inline size_t BpTreeNode::MaxKeys (size_t attrLen, size_t payloadLen) {
+	return Capacity (0, attrLen, payloadLen);
+}
+
+inline size_t BpTreeNode::Capacity (size_t prefixLen, size_t keyWidth, size_t payloadLen) {
+	size_t space = Utils::PAGESIZE - sizeof (BpTreeNodeHeader) - prefixLen - alignof (RecordIdentifier);
+
+	return space / ( keyWidth + sizeof (RecordIdentifier) + payloadLen );
+}
+
+inline size_t BpTreeNode::Capacity (AttrType type, size_t attrLen, size_t payloadLen, const char * keys, size_t n) {
+	size_t prefixLen = 0, keyWidth = attrLen;
+
+	if ( type == STRING && n > 0 )
+		layoutOf (attrLen, attrLen + payloadLen, keys, n, prefixLen, keyWidth);
+
+	return Capacity (prefixLen, keyWidth, payloadLen);
+}
+
+inline size_t BpTreeNode::RidsOffset (size_t keyBytes) {
+	size_t align = alignof (RecordIdentifier);
+
+	return ( sizeof (BpTreeNodeHeader) + keyBytes + align - 1 ) / align * align - sizeof (BpTreeNodeHeader);
+}
+
+/*
+	The shortest STRING sep with left < sep <= right, the bytes of right after the first one that differs
+	from left are not needed to route a search between the two nodes; other types use right
+*/
+inline void BpTreeNode::Separator (AttrType type, size_t attrLen, const void * left, const void * right, void * sep) {
+	const char * l = reinterpret_cast< const char* >( left );
+	const char * r = reinterpret_cast< const char* >( right );
+	size_t length = attrLen;
+
+	if ( type == STRING ) {
+		size_t same = 0;
+
+		while ( same < attrLen && l[same] == r[same] && r[same] != '\0' )
+			same++;
+
+		length = std::min (same + 1, attrLen);
+	}
+
+	memcpy (sep, r, length);
+	memset (reinterpret_cast< char* >( sep ) + length, 0, attrLen - length);
+}
+
+/*
+	key 0 of the first internal node of a level, so that the keys of every internal node stay sorted
+*/
+inline void BpTreeNode::MinKey (AttrType type, size_t attrLen, void * key) {
+	memset (key, 0, attrLen);
+
+	if ( type == INT )
+		*reinterpret_cast< int* >( key ) = std::numeric_limits<int>::min ( );
+	else if ( type == FLOAT )
+		*reinterpret_cast< float* >( key ) = -std::numeric_limits<float>::infinity ( );
+}
+
 inline size_t BpTreeNode::attrLen ( ) const {
 	return header.attrLen;
 }
 
+inline size_t BpTreeNode::entryLen ( ) const {
+	return header.attrLen + header.payloadLen;
+}
+
+inline bool BpTreeNode::isCompressed ( ) const {
+	return header.type == STRING;
+}
+
+inline size_t BpTreeNode::keyBytes (const void * key) const {
+	if ( isCompressed ( ) )
+		return strnlen (reinterpret_cast< const char* >( key ), attrLen ( ));
+
+	return attrLen ( );
+}
+
+inline bool BpTreeNode::fits (const void * key) const {
+	return keyBytes (key) <= header.prefixLen + header.keyWidth && memcmp (key, prefix, header.prefixLen) == 0;
+}
+
+/*
+	Make space for one more key, a key out of the prefix or longer than keyWidth
+	rewrites the node with a shorter prefix or a wider key
+*/
+inline RETCODE BpTreeNode::makeRoom (const void * key) {
+
+	if ( fits (key) )
+		return GetNumKeys ( ) < GetMaxKeys ( ) ? RETCODE::COMPLETE : RETCODE::NODEKEYSFULL;
+
+	const char * k = reinterpret_cast< const char* >( key );
+	size_t prefixLen = 0;
+
+	while ( prefixLen < header.prefixLen && k[prefixLen] == prefix[prefixLen] )		// the prefix has no '\0'
+		prefixLen++;
+
+	size_t keyWidth = std::max (header.prefixLen + header.keyWidth, keyBytes (key)) - prefixLen;
+
+	if ( GetNumKeys ( ) + 1 > Capacity (prefixLen, keyWidth, header.payloadLen) )
+		return RETCODE::NODEKEYSFULL;
+
+	std::vector<char> oldKeys (GetNumKeys ( ) * entryLen ( ));
+	std::vector<RecordIdentifier> oldRids (GetNumKeys ( ));
+
+	CopyKeysTo (oldKeys.data ( ), oldRids.data ( ));
+
+	setLayout (prefixLen, keyWidth);
+
+	storeEntries (oldKeys.data ( ), oldRids.data ( ), GetNumKeys ( ));
+
+	return RETCODE::COMPLETE;
+}
+
+inline void BpTreeNode::setLayout (size_t prefixLen, size_t keyWidth) {
+	char * pData;
+
+	pagePtr->GetData (pData);
+	pData += sizeof (BpTreeNodeHeader);
+
+	header.prefixLen = prefixLen;
+	header.keyWidth = keyWidth;
+	header.maxKeys = Capacity (prefixLen, keyWidth, header.payloadLen);
+
+	prefix = pData;
+	keys = pData + prefixLen;
+	rids = reinterpret_cast< RecordIdentifier* >( pData + RidsOffset (prefixLen + keyWidth * header.maxKeys) );
+	payloads = reinterpret_cast< char* >( rids + header.maxKeys );
+}
+
+/*
+	the bytes of a STRING key after the prefix, '\0' after the end of the string
+*/
+inline void BpTreeNode::encode (const void * key, char * slot) const {
+	const char * k = reinterpret_cast< const char* >( key );
+
+	if ( !isCompressed ( ) ) {
+		memcpy (slot, k, header.keyWidth);
+		return;
+	}
+
+	size_t length = strnlen (k + header.prefixLen, header.keyWidth);
+
+	memcpy (slot, k + header.prefixLen, length);
+	memset (slot + length, 0, header.keyWidth - length);
+}
+
+inline void BpTreeNode::insertAt (size_t pos, void * key, const RecordIdentifier & rid) {
+	size_t moved = GetNumKeys ( ) - pos;
+
+	memmove (slotAt (pos + 1), slotAt (pos), moved * header.keyWidth);
+	memmove (static_cast< void* >( rids + pos + 1 ), rids + pos, moved * sizeof (RecordIdentifier));
+	memmove (payloads + ( pos + 1 ) * header.payloadLen, payloads + pos * header.payloadLen, moved * header.payloadLen);
+
+	encode (key, slotAt (pos));
+	rids[pos] = rid;
+	memcpy (payloads + pos * header.payloadLen, reinterpret_cast< char* >( key ) + attrLen ( ), header.payloadLen);
+
+	SetNumKeys (GetNumKeys ( ) + 1);
+}
+
+inline void BpTreeNode::storeEntries (const char * entries, const RecordIdentifier * newRids, size_t n) {
+
+	for ( size_t i = 0; i < n; i++ ) {
+		encode (entries + i * entryLen ( ), slotAt (i));
+		memcpy (payloads + i * header.payloadLen, entries + i * entryLen ( ) + attrLen ( ), header.payloadLen);
+	}
+
+	memcpy (static_cast< void* >( rids ), newRids, n * sizeof (RecordIdentifier));
+}
+
+/*
+	A key out of the prefix is below or above every key of the node,
+	a key longer than keyWidth is above every stored key equal to its first bytes
+*/
+template <bool Upper>
+inline size_t BpTreeNode::stringBound (void * key) const {
+	const char * k = reinterpret_cast< const char* >( key );
+	int order = strncmp (k, prefix, header.prefixLen);
+
+	if ( order != 0 )
+		return order < 0 ? 0 : GetNumKeys ( );
+
+	k += header.prefixLen;
+
+	if ( Upper || strnlen (k, attrLen ( ) - header.prefixLen) > header.keyWidth )
+		return KeySearch::UpperBound<StringKeyPolicy> (keys, GetNumKeys ( ), header.keyWidth, k);
+
+	return KeySearch::LowerBound<StringKeyPolicy> (keys, GetNumKeys ( ), header.keyWidth, k);
+}
+
+inline char * BpTreeNode::slotAt (size_t i) const {
+	return keys + i * header.keyWidth;
+}
+
 inline void * BpTreeNode::keyAt (size_t i) const {
 	if ( i < this->GetNumKeys ( ) )
-		return reinterpret_cast< char* >( keys) + i*attrLen ( );
-		//return reinterpret_cast< char* >( keys.get() ) + i*attrLen ( );
+		return slotAt (i);
 	return nullptr;
 }
 
 inline RecordIdentifier BpTreeNode::ridAt (size_t i) const {
-	
+
 	if ( i < this->GetNumKeys ( ) )
 		return rids[i];
 
 	return UNKNOWNRID;
 }
 
+/*
+	keys and rids are kept in the page, only the header is copied back
+*/
 inline RETCODE BpTreeNode::writePage ( ) const {
 	RETCODE result = RETCODE::COMPLETE;
 	char * pData;
@@ -329,22 +669,31 @@ inline RETCODE BpTreeNode::writePage ( ) const {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
-	
+
 	memcpy_s (pData, sizeof (BpTreeNodeHeader), reinterpret_cast<const void* >( &header ), sizeof (BpTreeNodeHeader));
+	memcpy (&written, &header, sizeof (BpTreeNodeHeader));
 
-	pData += sizeof (BpTreeNodeHeader);
+	return result;
+}
 
-	size_t keySize = GetNumKeys ( ) * attrLen ( );
+/*
+	the prefix of sorted keys is the prefix of the first and the last one, it stops before a '\0',
+	the keys are entryLen bytes apart
+*/
+inline void BpTreeNode::layoutOf (size_t attrLen, size_t entryLen, const char * keys, size_t n, size_t & prefixLen, size_t & keyWidth) {
+	const char * first = keys;
+	const char * last = keys + ( n - 1 ) * entryLen;
+	size_t longest = 0;
 
-	memcpy_s (pData, keySize, keys, keySize);
+	prefixLen = 0;
 
-	pData += GetNumKeys ( ) * attrLen ( );
+	while ( prefixLen < attrLen && first[prefixLen] == last[prefixLen] && first[prefixLen] != '\0' )
+		prefixLen++;
 
-	size_t ridSize = sizeof (GetNumKeys ( ) * sizeof (RecordIdentifier));
+	for ( size_t i = 0; i < n; i++ )
+		longest = std::max (longest, strnlen (keys + i * entryLen, attrLen));
 
-	memcpy_s (pData, ridSize, rids, ridSize);
-	
-	return result;
+	keyWidth = longest - prefixLen;
 }
 
 inline PageNum BpTreeNode::GetRight ( ) const {
@@ -362,27 +711,32 @@ inline PageNum BpTreeNode::GetLeft ( ) const {
 
 inline RETCODE BpTreeNode::SetLeft (PageNum page) {
 	header.prevNode = page;
-	
+
 	return RETCODE::COMPLETE;
 }
 
 RETCODE BpTreeNode::FindKey (void * key, const RecordIdentifier & rid, size_t & keyPos) const {
-	
+
 	keyPos = Utils::UNKNOWNPOS;
-	
-	for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
-		if ( comp (key, keyAt(i) ) == 0 && (rid == UNKNOWNRID || rid == ridAt(i)) ) {	// if rid is INVALIDRID, only compare the rid
-			keyPos = i;
+
+	// the equal keys are in [LowerBound, UpperBound), search it from the right
+	size_t first = LowerBound (key);
+
+	for ( size_t i = UpperBound (key); i > first; --i ) {
+		if ( rid == UNKNOWNRID || rid == ridAt (i - 1) ) {	// if rid is INVALIDRID, only compare the rid
+			keyPos = i - 1;
+			break;
 		}
 	}
-	
+
 	return RETCODE::COMPLETE;
 }
 
 inline size_t BpTreeNode::FindKey (void * key, const RecordIdentifier & rid) const{
+	size_t last = UpperBound (key);
 
-	for ( size_t i = 0; i < GetNumKeys ( ); i++ ) {
-		if ( comp (keyAt (i), key) == 0 && ( rid == UNKNOWNRID || rid == ridAt (i) ) )
+	for ( size_t i = LowerBound (key); i < last; i++ ) {
+		if ( rid == UNKNOWNRID || rid == ridAt (i) )
 			return i;
 	}
 	return Utils::UNKNOWNPOS;
@@ -394,56 +748,46 @@ inline size_t BpTreeNode::FindKey (void * key, const RecordIdentifier & rid) con
 	if there are dups - this will return rightmost position
 */
 inline size_t BpTreeNode::FindKeyPosFit (void * key) const {
-	for ( size_t i = GetNumKeys()-1; i >= 0 ; --i ){ 
-		
-		if ( keyAt (i) == nullptr )
-			return Utils::UNKNOWNPOS;
+	if ( key == nullptr )
+		return Utils::UNKNOWNPOS;
 
-		if ( comp (keyAt (i), key) == 0 )
-			return i;
-		else if ( comp (keyAt (i), key) < 0 )
-			return i + 1;
-	}
-	return 0;
-}
+	size_t pos = UpperBound (key);
 
-inline void * BpTreeNode::LargestKey ( ) const {
-	if ( GetNumKeys ( ) == 0 )
-		return nullptr;
-	else
-		return keyAt (GetNumKeys ( ) - 1);
-}
+	if ( pos > LowerBound (key) )
+		return pos - 1;
 
-inline void * BpTreeNode::SmallestKey ( ) const {
-	if ( GetNumKeys ( ) == 0 )
-		return nullptr;
-	else
-		return keyAt (0);
+	return pos;
 }
 
-inline RETCODE BpTreeNode::GetKey (size_t keyPos, void * & key) const {
-
-	if ( keyPos < this->GetNumKeys() ) {
-		key = keyAt (keyPos);
-		return RETCODE::COMPLETE;
+/*
+	The comparison of the key policy of the node type is inlined into the search
+*/
+inline size_t BpTreeNode::LowerBound (void * key) const {
+
+	switch ( header.type ) {
+	case INT:
+		return KeySearch::LowerBound<IntKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
+	case FLOAT:
+		return KeySearch::LowerBound<FloatKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
+	case STRING:
+		return stringBound<false> (key);
+	default:
+		return KeySearch::LowerBound<BytesKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
 	}
-
-	return RETCODE::KEYNOTFOUND;
 }
 
-inline void * BpTreeNode::GetKey (size_t keyPos) const {
-	if ( keyPos < this->GetNumKeys ( ) ) 
-		return keyAt (keyPos);
-	return nullptr;
-}
+inline size_t BpTreeNode::UpperBound (void * key) const {
 
-inline RETCODE BpTreeNode::SetKey (size_t keyPos, void * key) {
-	if ( keyPos < GetMaxKeys ( ) ) {
-		memcpy_s (reinterpret_cast<char*>( keys ) + keyPos * header.attrLen, attrLen ( ), key, attrLen ( ));
-		//memcpy_s ( reinterpret_cast<char*>(keys.get()) + keyPos * header.attrLen, attrLen ( ), key, attrLen ( ));
-		return RETCODE::COMPLETE;
+	switch ( header.type ) {
+	case INT:
+		return KeySearch::UpperBound<IntKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
+	case FLOAT:
+		return KeySearch::UpperBound<FloatKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
+	case STRING:
+		return stringBound<true> (key);
+	default:
+		return KeySearch::UpperBound<BytesKeyPolicy> (keys, GetNumKeys ( ), attrLen ( ), key);
 	}
-	return RETCODE::NODEKEYSFULL;
 }
 
 inline RecordIdentifier BpTreeNode::GetRid (size_t pos) const {
@@ -463,7 +807,7 @@ inline RecordIdentifier BpTreeNode::GetRid (void * key) const {
 }
 
 inline RETCODE BpTreeNode::SetRid (size_t keyPos, const RecordIdentifier & rid) const {
-	if ( keyPos < GetMaxKeys ( ) ){ 
+	if ( keyPos < GetMaxKeys ( ) ){
 		rids[keyPos] = rid;
 		return RETCODE::COMPLETE;
 	}
@@ -472,37 +816,32 @@ inline RETCODE BpTreeNode::SetRid (size_t keyPos, const RecordIdentifier & rid)
 
 
 /*
-	Split this node and insert half backward buckets to rhs
-
+	Split this node and move the upper half of the keys to the empty rhs,
+	both halves are loaded again so that each gets the prefix of its own keys
 */
 
 inline RETCODE BpTreeNode::Split (BpTreeNode & rhs) {
 	RETCODE result;
 	size_t numKeys = this->GetNumKeys ( );
-	size_t rhsKeys = rhs.GetNumKeys ( );
 
 	size_t leftistMovePos = ( numKeys + 1 ) / 2;
 	size_t moveCount = numKeys - leftistMovePos;
 
-	if ( moveCount + rhsKeys > rhs.GetMaxKeys() )
+	if ( rhs.GetNumKeys ( ) != 0 || rhs.attrLen ( ) != attrLen ( ) || rhs.GetPayloadLen ( ) != GetPayloadLen ( ) )
 		return NODEKEYSFULL;
 
-	// move this[leftistMovePos:end] after the end of rhs
-	for ( size_t i = leftistMovePos; i < this->GetNumKeys ( ); ++i ) {
-		if ( result = rhs.Insert ( keyAt(i), ridAt(i) ) ) {				// node insert failed 
-			return result;
-		}
-		
-	}
+	std::vector<char> allKeys (numKeys * entryLen ( ));
+	std::vector<RecordIdentifier> allRids (numKeys);
 
-	//remove the remaining elements
-	for ( size_t i = leftistMovePos; i < this->GetNumKeys ( ); ++i ) {
-		if ( result = this->Delete( this->keyAt(i) ) ) {
-			return result;
-		}
+	CopyKeysTo (allKeys.data ( ), allRids.data ( ));
 
+	// a half always fits, its prefix is not shorter and its keys are not longer
+	if ( ( result = rhs.Load (allKeys.data ( ) + leftistMovePos * entryLen ( ), allRids.data ( ) + leftistMovePos, moveCount) )
+		 || ( result = this->Load (allKeys.data ( ), allRids.data ( ), leftistMovePos) ) ) {
+		return result;
 	}
 
+	rhs.header.identifyChar = header.identifyChar;
 	rhs.SetNext (this->GetNext ( ));
 	rhs.SetPrev (this->GetPageNum ( ));
 	this->SetNext (rhs.GetPageNum ( ));
@@ -519,18 +858,21 @@ inline RETCODE BpTreeNode::Merge (const BpTreeNode & rhs) {
 	RETCODE result;
 	size_t numKeys = this->GetNumKeys ( );
 	size_t rhsKeys = rhs.GetNumKeys ( );
+	bool isPrev = this->GetPageNum ( ) == rhs.GetPrev ( );		// if this is the previous node of rhs
+	const BpTreeNode & first = isPrev ? *this : rhs;
 
-	if ( numKeys + rhsKeys > this->GetMaxKeys()	)		// if this node is no enough space
-		return NODEKEYSFULL;
+	std::vector<char> allKeys (( numKeys + rhsKeys ) * entryLen ( ));
+	std::vector<RecordIdentifier> allRids (numKeys + rhsKeys);
 
-	// move the buckets in rhs to this node
-	for ( size_t i = 0; i < rhs.GetNumKeys ( ); i++ ) {
-		if ( result = this->Insert ( rhs.keyAt(i), rhs.ridAt(i) ) ) {
-			return result;
-		}
+	// the keys of the left node come first
+	first.CopyKeysTo (allKeys.data ( ), allRids.data ( ));
+	( isPrev ? rhs : *this ).CopyKeysTo (allKeys.data ( ) + first.GetNumKeys ( ) * entryLen ( ), allRids.data ( ) + first.GetNumKeys ( ));
+
+	if ( result = this->Load (allKeys.data ( ), allRids.data ( ), numKeys + rhsKeys) ) {		// if this node is no enough space
+		return result;
 	}
 
-	if ( this->GetPageNum ( ) == rhs.GetPrev ( ) ) {		// if this is the previous node of rhs
+	if ( isPrev ) {
 		this->SetNext (rhs.GetNext ( ));
 	} else {
 		this->SetPrev (rhs.GetPrev ( ));
@@ -540,30 +882,22 @@ inline RETCODE BpTreeNode::Merge (const BpTreeNode & rhs) {
 }
 
 inline RETCODE BpTreeNode::Print ( ) const {
+	std::vector<char> key (attrLen ( ));
 
-	if ( header.type == INT ) {
-		for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
-			std::cout << *reinterpret_cast< int* >( keyAt(i) );
-			std::cout << ":" << ridAt(i) << std::endl;
-		}
-
-	} else if ( header.type == FLOAT ) {
-		for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
-			std::cout << *reinterpret_cast< float* >( keyAt (i) );
-			std::cout << ":" << ridAt (i) << std::endl;
-		}
-
-
-	} else {
+	for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
+		CopyKeyTo (i, key.data ( ));
 
-		for ( size_t i = 0; i < this->GetNumKeys ( ); ++i ) {
-			char * strptr = reinterpret_cast<char*>( keyAt(i) );
+		if ( header.type == INT ) {
+			std::cout << *reinterpret_cast< int* >( key.data ( ) );
+		} else if ( header.type == FLOAT ) {
+			std::cout << *reinterpret_cast< float* >( key.data ( ) );
+		} else {
 			for ( size_t j = 0; j < header.attrLen; j++ ) {
-				std::cout << strptr[j];			// output one char
+				std::cout << key[j];			// output one char
 			}
-			std::cout << ":" << ridAt (i) << std::endl;
 		}
 
+		std::cout << ":" << ridAt (i) << std::endl;
 	}
 
 	return RETCODE::COMPLETE;
@@ -573,8 +907,8 @@ inline size_t BpTreeNode::GetMaxKeys ( ) const {
 	return header.maxKeys;
 }
 
-inline void BpTreeNode::SetMaxKeys (size_t val ) {
-	header.maxKeys = val;
+inline size_t BpTreeNode::GetPayloadLen ( ) const {
+	return header.payloadLen;
 }
 
 inline size_t BpTreeNode::GetNumKeys ( ) const {
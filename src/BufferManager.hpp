@@ -5,6 +5,9 @@
 #include "PageFile.hpp"
 
 #include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
 /*
 	Buffer Manager
 	1. ÿBufferManagerһļ(PageFilePtr)Buffer
@@ -27,6 +30,8 @@ public:
 
 	RETCODE ReadPage (PageNum page, char * dest) ;		// read a page from the disk file
 
+	RETCODE PrefetchPage (PageNum page);		// bring the page into the buffer without locking it
+
 	RETCODE WritePage (PageNum page, char * source) const;	// write a page to the disk file
 
 	RETCODE MarkDirty (PageNum page);
@@ -47,14 +52,22 @@ public:
 
 private:
 
+	RETCODE loadPage (std::unique_lock<std::recursive_mutex> & lock, PageNum page, PagePtr & ptr, bool wait);
+
 	PageFilePtr _pageFile;
 
 	HashTable _bufferTbl;
 
-	std::unordered_map<PageNum, size_t> _lockMap;
+	std::unordered_map<PageNum, size_t> _lockMap;		// pin count of every page
 
 	std::unordered_map<PageNum, bool> _dirtyMap;
 
+	mutable std::recursive_mutex _mutex;		// the buffer may be shared by the workers of a ParallelRecordFileScan
+
+	std::unordered_set<PageNum> _loading;		// pages being read from the disk file without _mutex held
+
+	std::condition_variable_any _loaded;		// signalled when a page leaves _loading
+
 };
 
 using BufferManagerPtr = std::shared_ptr<BufferManager> ;
@@ -85,6 +98,7 @@ BufferManager::~BufferManager ( ) {
 	create a new page and write to file
 */
 inline RETCODE BufferManager::AllocatePage ( PagePtr & page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 	RETCODE result;
 
 	if ( result = _pageFile->AllocatePage (page) ) {
@@ -108,6 +122,7 @@ inline RETCODE BufferManager::AllocatePage ( PagePtr & page) {
 }
 
 inline RETCODE BufferManager::DisposePage (PageNum page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 	RETCODE result;
 
 	if ( _bufferTbl.Delete (page) != RETCODE::HASHNOTFOUND ) {
@@ -127,23 +142,16 @@ inline RETCODE BufferManager::DisposePage (PageNum page) {
 	Main Function to get page
 */
 inline RETCODE BufferManager::GetPage ( PageNum page, PagePtr & ptr) {
+	std::unique_lock<std::recursive_mutex> lock (_mutex);
 
 	RETCODE result;
-/*
-	if ( page >= _pageFile->GetNumPage ( ) ) {
 
-		return RETCODE::PAGENUMNOTFOUND;
-	}
-*/
-	if ( _bufferTbl.Find ( page, ptr) == RETCODE::HASHNOTFOUND  ) {
-		if ( result = _pageFile->GetThisPage (page, ptr) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-			return result;
-		}
-		_bufferTbl.Insert (page, ptr);
+	if ( result = loadPage (lock, page, ptr, true) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
 	}
 
-	if ( (result = LockPage (page)) && result != RETCODE::PAGELOCKNED ) {
+	if ( result = LockPage (page) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
@@ -151,6 +159,48 @@ inline RETCODE BufferManager::GetPage ( PageNum page, PagePtr & ptr) {
 	return RETCODE::COMPLETE;
 }
 
+/*
+	Bring a page into the buffer, called with lock held
+	The disk read runs with the lock released so that readers of other pages are not serialised behind it,
+	a second reader of the same page waits for the first one if wait is set, otherwise returns at once
+*/
+inline RETCODE BufferManager::loadPage (std::unique_lock<std::recursive_mutex> & lock, PageNum page, PagePtr & ptr, bool wait) {
+	RETCODE result;
+
+	while ( _bufferTbl.Find (page, ptr) == RETCODE::HASHNOTFOUND ) {
+
+		if ( _loading.count (page) != 0 ) {		// another thread is reading this page
+			if ( !wait )
+				return RETCODE::COMPLETE;
+			_loaded.wait (lock);
+			continue;
+		}
+
+		if ( page >= _pageFile->GetNumPage ( ) )
+			return RETCODE::EOFFILE;
+
+		if ( page < 1 )
+			return RETCODE::INVALIDPAGE;
+
+		_loading.insert (page);
+		lock.unlock ( );
+
+		result = _pageFile->ReadThisPage (page, ptr);
+
+		lock.lock ( );
+		_loading.erase (page);
+		_loaded.notify_all ( );
+
+		if ( result )
+			return result;
+
+		if ( result = _bufferTbl.Insert (page, ptr) )
+			return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
 /*
 	Read but not lock the page
 */
@@ -160,7 +210,7 @@ inline RETCODE BufferManager::ReadPage ( PageNum page, char * dest) {
 	RETCODE result;
 
 
-	if ( ( result = GetPage(page, ptr) ) ) {
+	if ( ( result = GetPage(page, ptr) ) || ( result = UnlockPage (page) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
@@ -174,10 +224,27 @@ inline RETCODE BufferManager::ReadPage ( PageNum page, char * dest) {
 	return result;
 }
 
+/*
+	Read ahead for a reader that will GetPage the page soon
+*/
+inline RETCODE BufferManager::PrefetchPage (PageNum page) {
+	std::unique_lock<std::recursive_mutex> lock (_mutex);
+	PagePtr ptr;
+	RETCODE result;
+
+	if ( result = loadPage (lock, page, ptr, false) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
 /*
 	Unused
 */
 inline RETCODE BufferManager::WritePage ( PageNum page, char * source) const {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 
 	PagePtr ptr;
 	RETCODE result;
@@ -201,6 +268,7 @@ inline RETCODE BufferManager::WritePage ( PageNum page, char * source) const {
 }
 
 inline RETCODE BufferManager::MarkDirty ( PageNum page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 
 	PagePtr ptr;
 	RETCODE result;
@@ -216,17 +284,15 @@ inline RETCODE BufferManager::MarkDirty ( PageNum page) {
 }
 
 inline RETCODE BufferManager::LockPage (PageNum page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 
-	if ( _lockMap[page] == 0 ) {				// the requested page is not using by any thread
-		_lockMap[page] = 1;					// lock the page
-	} else {												// if the page is already locked
-		return RETCODE::PAGELOCKNED;
-	}
+	_lockMap[page] += 1;			// pins are counted, several readers may hold the same page
 
 	return RETCODE::COMPLETE;
 }
 
 inline RETCODE BufferManager::UnlockPage ( PageNum page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 	PagePtr ptr;
 	RETCODE result;
 
@@ -246,13 +312,13 @@ inline RETCODE BufferManager::UnlockPage ( PageNum page) {
 	}
 */
 
-	_lockMap[page] -= 1;
-	_dirtyMap[page] = false;
+	_lockMap[page] -= 1;			// a dirty page stays dirty until it is written
 
 	return result;
 }
 
 inline RETCODE BufferManager::ForcePage (PageNum page) {
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 	
 	PagePtr pagePtr;
 	RETCODE result;
@@ -261,12 +327,20 @@ inline RETCODE BufferManager::ForcePage (PageNum page) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
-	
-	return _pageFile->ForcePage (page, pagePtr);
+
+	if ( result = _pageFile->ForcePage (page, pagePtr) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	_dirtyMap[page] = false;
+
+	return RETCODE::COMPLETE;
 
 }
 
 inline RETCODE BufferManager::FlushPages () {			// TODO: How to write page to disk file
+	std::lock_guard<std::recursive_mutex> guard (_mutex);
 	RETCODE result = RETCODE::COMPLETE;
 	vector<PageNum> vec;
 	PagePtr page;
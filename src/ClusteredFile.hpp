@@ -0,0 +1,706 @@
+#pragma once
+
+/*
+	1. ClusteredFile is the file of CLUSTERED_ENGINE tables, the records are stored in the leaves of a B+ tree
+	   ordered by the primary key, so a lookup by key reads no separate heap page
+	2. Page 0 is PageFileHeader, page 1 is ClusteredFileHeader, the other pages are nodes of the tree
+	3. Layout of a leaf:     [ClusteredNodeHeader][record 0][record 1]...        records sorted by key
+	   Layout of an internal: [ClusteredNodeHeader][key 0]...[key n-1] ... [child 0]...[child n]
+	   child i holds the keys in [key i-1, key i)
+	4. The leaves are linked in key order by prev and next
+	5. The RecordIdentifier of a record is its leaf and position, it changes when the leaf splits,
+	   so records are found by their key
+	6. Deletes do not merge nodes, an empty leaf stays in the tree until a key falls into it again
+*/
+
+#include "Utils.hpp"
+#include "Record.hpp"
+#include "BufferManager.hpp"
+
+#include <vector>
+
+struct ClusteredFileHeader {				// stored in page 1 of every clustered file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL ClusteredFile"
+	size_t recordSize;
+	int keyOffset;
+	AttrType keyType;
+	int keyLength;
+	PageNum rootPage;
+	size_t height;				// 1 if the root is a leaf
+	size_t numRecords;
+
+	ClusteredFileHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::CLUSTEREDFILEIDENTIFYSTRING);
+		recordSize = numRecords = height = 0;
+		keyOffset = keyLength = 0;
+		keyType = INT;
+		rootPage = Utils::UNKNOWNPAGENUM;
+	}
+};
+
+struct ClusteredNodeHeader {
+	char nodeType;				// 'L' for leaf, 'I' for internal node
+	unsigned short numKeys;		// records of a leaf, keys of an internal node
+	PageNum prev;				// leaves only
+	PageNum next;
+};
+
+class ClusteredFile {
+
+	friend class ClusteredFileScan;
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static char LEAFNODE = 'L';
+
+	const static char INTERNALNODE = 'I';
+
+	ClusteredFile ( );
+	~ClusteredFile ( );
+
+	/*
+	The file must be opened before any other operation
+	*/
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE InsertRec (const char *pData, RecordIdentifier &rid);		// ENTRYEXISTS if the key is in the table
+	RETCODE DeleteRec (void *key);
+	RETCODE UpdateRec (const Record &rec);				// the record with the same key is replaced
+	RETCODE GetRec (void *key, Record &rec);			// RECORDNOTFOUND if the key is not in the table
+
+	RETCODE ForcePages ( );								// write the header and the dirty nodes to disk
+
+	RETCODE ReadHeader ( );
+	RETCODE SaveHeader ( ) const;
+
+	RETCODE GetHeader (ClusteredFileHeader & hdr) const;
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	bool isValidRecordFile ( ) const;
+
+	size_t recordSize ( ) const;
+
+	/*
+		Static Functions
+	*/
+	static RETCODE InitHeader (char * pData, size_t recordSize, int keyOffset, AttrType keyType, int keyLength);
+
+private:
+
+	RETCODE getNode (PageNum page, char * & pData);
+
+	RETCODE allocateNode (char nodeType, PageNum & page, char * & pData);
+
+	RETCODE findLeaf (void * key, PageNum & leaf, std::vector<PageNum> * path = nullptr, std::vector<size_t> * childPos = nullptr);	// UNKNOWNPAGENUM in an empty file
+
+	RETCODE createRoot ( );
+
+	RETCODE firstLeaf (PageNum & leaf);
+
+	RETCODE insertSeparator (std::vector<PageNum> & path, std::vector<size_t> & childPos, void * key, PageNum child);
+
+	int compare (void * key1, void * key2) const;
+
+	size_t lowerBound (char * pData, void * key) const;		// first record or key not less than key
+
+	size_t upperBound (char * pData, void * key) const;		// first record or key greater than key
+
+	void * keyAt (char * pData, size_t pos) const;
+
+	char * recordAt (char * pData, size_t pos) const;
+
+	PageNum * children (char * pData) const;
+
+	size_t leafCapacity ( ) const;
+
+	size_t innerCapacity ( ) const;
+
+	static ClusteredNodeHeader * nodeHeader (char * pData);
+
+	mutable bool headerModified;
+
+	bool isFileOpen;
+
+	ClusteredFileHeader header;
+
+	BufferManagerPtr bufMgr;
+
+};
+
+using ClusteredFilePtr = shared_ptr<ClusteredFile>;
+
+ClusteredFile::ClusteredFile ( ) {
+	bufMgr = nullptr;
+	headerModified = false;
+	isFileOpen = false;
+}
+
+ClusteredFile::~ClusteredFile ( ) {
+	if ( headerModified ) {
+		SaveHeader ( );
+	}
+}
+
+inline RETCODE ClusteredFile::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+
+	if ( isFileOpen || bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( result = ReadHeader ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	isFileOpen = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::InsertRec (const char * pData, RecordIdentifier & rid) {
+	RETCODE result;
+	std::vector<PageNum> path;
+	std::vector<size_t> childPos;
+	PageNum leaf;
+	char * pLeaf;
+
+	if ( pData == nullptr )
+		return RETCODE::BADRECORD;
+
+	void * key = const_cast< char* >( pData ) + header.keyOffset;
+
+	if ( header.rootPage == Utils::UNKNOWNPAGENUM && ( result = createRoot ( ) ) ) {		// the first insert creates the root leaf
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = findLeaf (key, leaf, &path, &childPos) ) || ( result = getNode (leaf, pLeaf) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	ClusteredNodeHeader * nHdr = nodeHeader (pLeaf);
+	size_t pos = lowerBound (pLeaf, key);
+
+	if ( pos < nHdr->numKeys && compare (keyAt (pLeaf, pos), key) == 0 )
+		return RETCODE::ENTRYEXISTS;
+
+	if ( nHdr->numKeys < leafCapacity ( ) ) {
+		memmove (recordAt (pLeaf, pos + 1), recordAt (pLeaf, pos), ( nHdr->numKeys - pos ) * header.recordSize);
+		memcpy (recordAt (pLeaf, pos), pData, header.recordSize);
+		nHdr->numKeys++;
+
+		rid = RecordIdentifier{ leaf, static_cast< SlotNum >( pos ) };
+		header.numRecords++;
+		headerModified = true;
+
+		return bufMgr->MarkDirty (leaf);
+	}
+
+	// split the full leaf, the upper half goes to a new right sibling
+	std::vector<char> records (( nHdr->numKeys + 1 ) * header.recordSize);
+	size_t total = nHdr->numKeys + 1;
+	size_t leftCount = total / 2;
+	PageNum right;
+	char * pRight;
+
+	memcpy (records.data ( ), recordAt (pLeaf, 0), pos * header.recordSize);
+	memcpy (records.data ( ) + pos * header.recordSize, pData, header.recordSize);
+	memcpy (records.data ( ) + ( pos + 1 ) * header.recordSize, recordAt (pLeaf, pos), ( nHdr->numKeys - pos ) * header.recordSize);
+
+	if ( ( result = allocateNode (LEAFNODE, right, pRight) ) || ( result = getNode (leaf, pLeaf) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	nHdr = nodeHeader (pLeaf);
+	ClusteredNodeHeader * rHdr = nodeHeader (pRight);
+
+	memcpy (recordAt (pLeaf, 0), records.data ( ), leftCount * header.recordSize);
+	memcpy (recordAt (pRight, 0), records.data ( ) + leftCount * header.recordSize, ( total - leftCount ) * header.recordSize);
+	nHdr->numKeys = static_cast< unsigned short >( leftCount );
+	rHdr->numKeys = static_cast< unsigned short >( total - leftCount );
+
+	rHdr->prev = leaf;
+	rHdr->next = nHdr->next;
+	nHdr->next = right;
+
+	if ( rHdr->next != Utils::UNKNOWNPAGENUM ) {
+		char * pNext;
+
+		if ( ( result = getNode (rHdr->next, pNext) ) || ( result = getNode (right, pRight) ) || ( result = getNode (leaf, pLeaf) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		nodeHeader (pNext)->prev = right;
+		if ( result = bufMgr->MarkDirty (nodeHeader (pRight)->next) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	rid = pos < leftCount ? RecordIdentifier{ leaf, static_cast< SlotNum >( pos ) } : RecordIdentifier{ right, static_cast< SlotNum >( pos - leftCount ) };
+	header.numRecords++;
+	headerModified = true;
+
+	std::vector<char> separator (header.keyLength);
+	memcpy (separator.data ( ), keyAt (pRight, 0), header.keyLength);
+
+	if ( ( result = bufMgr->MarkDirty (leaf) ) || ( result = bufMgr->MarkDirty (right) )
+		 || ( result = insertSeparator (path, childPos, separator.data ( ), right) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::DeleteRec (void * key) {
+	RETCODE result;
+	PageNum leaf;
+	char * pLeaf;
+
+	if ( key == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( result = findLeaf (key, leaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( leaf == Utils::UNKNOWNPAGENUM )		// empty file
+		return RETCODE::RECORDNOTFOUND;
+
+	if ( result = getNode (leaf, pLeaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	ClusteredNodeHeader * nHdr = nodeHeader (pLeaf);
+	size_t pos = lowerBound (pLeaf, key);
+
+	if ( pos == nHdr->numKeys || compare (keyAt (pLeaf, pos), key) != 0 )
+		return RETCODE::RECORDNOTFOUND;
+
+	memmove (recordAt (pLeaf, pos), recordAt (pLeaf, pos + 1), ( nHdr->numKeys - pos - 1 ) * header.recordSize);
+	nHdr->numKeys--;
+
+	header.numRecords--;
+	headerModified = true;
+
+	return bufMgr->MarkDirty (leaf);
+}
+
+inline RETCODE ClusteredFile::UpdateRec (const Record & rec) {
+	RETCODE result;
+	PageNum leaf;
+	char * pLeaf;
+	char * pData;
+	size_t size;
+
+	rec.GetData (pData);
+	rec.GetSize (size);
+
+	if ( pData == nullptr || size != header.recordSize )
+		return RETCODE::BADRECORD;
+
+	void * key = pData + header.keyOffset;
+
+	if ( result = findLeaf (key, leaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( leaf == Utils::UNKNOWNPAGENUM )		// empty file
+		return RETCODE::RECORDNOTFOUND;
+
+	if ( result = getNode (leaf, pLeaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	size_t pos = lowerBound (pLeaf, key);
+
+	if ( pos == nodeHeader (pLeaf)->numKeys || compare (keyAt (pLeaf, pos), key) != 0 )
+		return RETCODE::RECORDNOTFOUND;
+
+	memcpy (recordAt (pLeaf, pos), pData, header.recordSize);
+
+	return bufMgr->MarkDirty (leaf);
+}
+
+inline RETCODE ClusteredFile::GetRec (void * key, Record & rec) {
+	RETCODE result;
+	PageNum leaf;
+	char * pLeaf;
+
+	if ( key == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( result = findLeaf (key, leaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( leaf == Utils::UNKNOWNPAGENUM )		// empty file
+		return RETCODE::RECORDNOTFOUND;
+
+	if ( result = getNode (leaf, pLeaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	size_t pos = lowerBound (pLeaf, key);
+
+	if ( pos == nodeHeader (pLeaf)->numKeys || compare (keyAt (pLeaf, pos), key) != 0 )
+		return RETCODE::RECORDNOTFOUND;
+
+	rec = Record (RecordIdentifier{ leaf, static_cast< SlotNum >( pos ) }, recordAt (pLeaf, pos), header.recordSize);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::ForcePages ( ) {
+	RETCODE result;
+
+	if ( ( result = SaveHeader ( ) ) || ( result = bufMgr->FlushPages ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::ReadHeader ( ) {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (ClusteredFileHeader), pData, sizeof (ClusteredFileHeader));
+
+	if ( !isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::SaveHeader ( ) const {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( bufMgr == nullptr ) {
+		Utils::PrintRetcode (RETCODE::HDRWRITE, __FUNCTION__, __LINE__);
+		return RETCODE::HDRWRITE;
+	}
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (ClusteredFileHeader), reinterpret_cast< const void* >( &header ), sizeof (ClusteredFileHeader));
+
+	if ( result = bufMgr->ForcePage (HEADERPAGE) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::GetHeader (ClusteredFileHeader & hdr) const {
+	hdr = header;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline bool ClusteredFile::isValidRecordFile ( ) const {
+	return strcmp (header.identifyString, Utils::CLUSTEREDFILEIDENTIFYSTRING) == 0;
+}
+
+inline size_t ClusteredFile::recordSize ( ) const {
+	return header.recordSize;
+}
+
+/*
+	Write the header of a new file, the root leaf is allocated by the first insert
+*/
+inline RETCODE ClusteredFile::InitHeader (char * pData, size_t recordSize, int keyOffset, AttrType keyType, int keyLength) {
+	if ( pData == nullptr || keyOffset < 0 || keyLength <= 0 || keyOffset + static_cast< size_t >( keyLength ) > recordSize
+		 || sizeof (ClusteredNodeHeader) + 2 * recordSize > Utils::PAGESIZE
+		 || sizeof (ClusteredNodeHeader) + 3 * ( keyLength + sizeof (PageNum) ) > Utils::PAGESIZE )
+		return RETCODE::CREATEFAILED;
+
+	ClusteredFileHeader hdr;
+
+	hdr.recordSize = recordSize;
+	hdr.keyOffset = keyOffset;
+	hdr.keyType = keyType;
+	hdr.keyLength = keyLength;
+
+	memcpy_s (pData, sizeof (ClusteredFileHeader), reinterpret_cast< const void* >( &hdr ), sizeof (ClusteredFileHeader));
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::getNode (PageNum page, char * & pData) {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) )
+		 || ( result = pagePtr->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::allocateNode (char nodeType, PageNum & page, char * & pData) {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	if ( ( result = bufMgr->AllocatePage (pagePtr) ) || ( result = pagePtr->GetPageNum (page) )
+		 || ( result = bufMgr->UnlockPage (page) ) || ( result = pagePtr->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	ClusteredNodeHeader * nHdr = nodeHeader (pData);
+	nHdr->nodeType = nodeType;
+	nHdr->numKeys = 0;
+	nHdr->prev = nHdr->next = Utils::UNKNOWNPAGENUM;
+
+	return bufMgr->MarkDirty (page);
+}
+
+/*
+	path and childPos receive the internal nodes from the root down and the child taken in each of them
+*/
+inline RETCODE ClusteredFile::findLeaf (void * key, PageNum & leaf, std::vector<PageNum> * path, std::vector<size_t> * childPos) {
+	RETCODE result;
+	char * pData;
+
+	leaf = header.rootPage;
+
+	for ( size_t level = 1; level < header.height; level++ ) {
+		if ( result = getNode (leaf, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		size_t pos = key != nullptr ? upperBound (pData, key) : 0;
+
+		if ( path != nullptr ) {
+			path->push_back (leaf);
+			childPos->push_back (pos);
+		}
+
+		leaf = children (pData)[pos];
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFile::firstLeaf (PageNum & leaf) {
+	return findLeaf (nullptr, leaf);
+}
+
+inline RETCODE ClusteredFile::createRoot ( ) {
+	RETCODE result;
+	char * pData;
+
+	if ( result = allocateNode (LEAFNODE, header.rootPage, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.height = 1;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Insert key and the new right child after childPos into the parent at the end of path, split it when it is full
+*/
+inline RETCODE ClusteredFile::insertSeparator (std::vector<PageNum> & path, std::vector<size_t> & childPos, void * key, PageNum child) {
+	RETCODE result;
+	std::vector<char> sepKey (static_cast< char* >( key ), static_cast< char* >( key ) + header.keyLength);
+	PageNum sepChild = child;
+	char * pData;
+
+	while ( !path.empty ( ) ) {
+		PageNum node = path.back ( );
+		size_t pos = childPos.back ( );
+		path.pop_back ( );
+		childPos.pop_back ( );
+
+		if ( result = getNode (node, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		ClusteredNodeHeader * nHdr = nodeHeader (pData);
+		size_t n = nHdr->numKeys;
+
+		if ( n < innerCapacity ( ) ) {
+			memmove (keyAt (pData, pos + 1), keyAt (pData, pos), ( n - pos ) * header.keyLength);
+			memcpy (keyAt (pData, pos), sepKey.data ( ), header.keyLength);
+			memmove (children (pData) + pos + 2, children (pData) + pos + 1, ( n - pos ) * sizeof (PageNum));
+			children (pData)[pos + 1] = sepChild;
+			nHdr->numKeys++;
+
+			return bufMgr->MarkDirty (node);
+		}
+
+		// split the full internal node, the middle key moves up to the parent
+		std::vector<char> keys (( n + 1 ) * header.keyLength);
+		std::vector<PageNum> ptrs (n + 2);
+
+		memcpy (keys.data ( ), keyAt (pData, 0), pos * header.keyLength);
+		memcpy (keys.data ( ) + pos * header.keyLength, sepKey.data ( ), header.keyLength);
+		memcpy (keys.data ( ) + ( pos + 1 ) * header.keyLength, keyAt (pData, pos), ( n - pos ) * header.keyLength);
+		memcpy (ptrs.data ( ), children (pData), ( pos + 1 ) * sizeof (PageNum));
+		ptrs[pos + 1] = sepChild;
+		memcpy (ptrs.data ( ) + pos + 2, children (pData) + pos + 1, ( n - pos ) * sizeof (PageNum));
+
+		size_t mid = ( n + 1 ) / 2;
+		PageNum right;
+		char * pRight;
+
+		if ( ( result = allocateNode (INTERNALNODE, right, pRight) ) || ( result = getNode (node, pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		memcpy (keyAt (pData, 0), keys.data ( ), mid * header.keyLength);
+		memcpy (children (pData), ptrs.data ( ), ( mid + 1 ) * sizeof (PageNum));
+		nodeHeader (pData)->numKeys = static_cast< unsigned short >( mid );
+
+		memcpy (keyAt (pRight, 0), keys.data ( ) + ( mid + 1 ) * header.keyLength, ( n - mid ) * header.keyLength);
+		memcpy (children (pRight), ptrs.data ( ) + mid + 1, ( n - mid + 1 ) * sizeof (PageNum));
+		nodeHeader (pRight)->numKeys = static_cast< unsigned short >( n - mid );
+
+		if ( ( result = bufMgr->MarkDirty (node) ) || ( result = bufMgr->MarkDirty (right) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		memcpy (sepKey.data ( ), keys.data ( ) + mid * header.keyLength, header.keyLength);
+		sepChild = right;
+	}
+
+	// the root was split, the tree grows by one level
+	PageNum oldRoot = header.rootPage;
+	PageNum newRoot;
+
+	if ( result = allocateNode (INTERNALNODE, newRoot, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy (keyAt (pData, 0), sepKey.data ( ), header.keyLength);
+	children (pData)[0] = oldRoot;
+	children (pData)[1] = sepChild;
+	nodeHeader (pData)->numKeys = 1;
+
+	header.rootPage = newRoot;
+	header.height++;
+	headerModified = true;
+
+	return bufMgr->MarkDirty (newRoot);
+}
+
+inline int ClusteredFile::compare (void * key1, void * key2) const {
+	switch ( header.keyType ) {
+	case INT:
+		return CompMethod::compare_int (key1, key2, header.keyLength);
+	case FLOAT:
+		return CompMethod::compare_float (key1, key2, header.keyLength);
+	default:
+		return CompMethod::compare_string (key1, key2, header.keyLength);
+	}
+}
+
+inline size_t ClusteredFile::lowerBound (char * pData, void * key) const {
+	size_t low = 0, high = nodeHeader (pData)->numKeys;
+
+	while ( low < high ) {
+		size_t mid = ( low + high ) / 2;
+
+		if ( compare (keyAt (pData, mid), key) < 0 )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+inline size_t ClusteredFile::upperBound (char * pData, void * key) const {
+	size_t low = 0, high = nodeHeader (pData)->numKeys;
+
+	while ( low < high ) {
+		size_t mid = ( low + high ) / 2;
+
+		if ( compare (keyAt (pData, mid), key) <= 0 )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+inline void * ClusteredFile::keyAt (char * pData, size_t pos) const {
+	if ( nodeHeader (pData)->nodeType == LEAFNODE )
+		return recordAt (pData, pos) + header.keyOffset;
+
+	return pData + sizeof (ClusteredNodeHeader) + pos * header.keyLength;
+}
+
+inline char * ClusteredFile::recordAt (char * pData, size_t pos) const {
+	return pData + sizeof (ClusteredNodeHeader) + pos * header.recordSize;
+}
+
+inline PageNum * ClusteredFile::children (char * pData) const {
+	return reinterpret_cast< PageNum* >( pData + sizeof (ClusteredNodeHeader) + innerCapacity ( ) * header.keyLength );
+}
+
+inline size_t ClusteredFile::leafCapacity ( ) const {
+	return ( Utils::PAGESIZE - sizeof (ClusteredNodeHeader) ) / header.recordSize;
+}
+
+/*
+	one more child than keys
+*/
+inline size_t ClusteredFile::innerCapacity ( ) const {
+	return ( Utils::PAGESIZE - sizeof (ClusteredNodeHeader) - sizeof (PageNum) ) / ( header.keyLength + sizeof (PageNum) );
+}
+
+inline ClusteredNodeHeader * ClusteredFile::nodeHeader (char * pData) {
+	return reinterpret_cast< ClusteredNodeHeader* >( pData );
+}
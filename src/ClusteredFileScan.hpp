@@ -0,0 +1,217 @@
+#pragma once
+
+/*
+	1. ClusteredFileScan scans a ClusteredFile with the same interface as RecordFileScan, records are returned in key order
+	2. A condition on the primary key starts the scan at the first leaf that can hold a match and ends it
+	   at the first key past the range, other conditions read every leaf
+*/
+
+#include "Utils.hpp"
+#include "ClusteredFile.hpp"
+
+class ClusteredFileScan {
+public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	ClusteredFileScan ( );
+	~ClusteredFileScan ( );
+
+	RETCODE OpenScan (const ClusteredFilePtr &fileHandle,  // Initialize file scan
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value);
+
+	RETCODE GetNextRec (Record &rec);                  // Get next matching record
+
+	RETCODE CloseScan ( );                                // Terminate file scan
+
+private:
+
+	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	bool pastRange (void * key) const;				// true if no later key can satisfy the condition
+
+	Comparator _comp;
+
+	ClusteredFilePtr _file;
+
+	AttrType _attrType;
+
+	size_t _attrLength;
+
+	size_t _attrOffset;
+
+	std::vector<char> _attrValue;
+
+	CompOp _compOp;
+
+	bool _onKey;						// the condition is on the primary key
+
+	PageNum _currentLeaf;
+
+	size_t _currentPos;
+
+	ScanState _state;
+
+};
+
+ClusteredFileScan::ClusteredFileScan ( ) {
+	_state = ScanState::Close;
+	_comp = nullptr;
+	_file = nullptr;
+	_onKey = false;
+}
+
+ClusteredFileScan::~ClusteredFileScan ( ) {
+
+}
+
+inline RETCODE ClusteredFileScan::OpenScan (const ClusteredFilePtr & fileHandle, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value) {
+	RETCODE result;
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( fileHandle == nullptr || !fileHandle->isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	_file = fileHandle;
+	_comp = nullptr;
+	_onKey = false;
+	_compOp = NO_OP;
+
+	if ( value != nullptr && compOp != NO_OP ) {			// has condition
+
+		if ( attrType != AttrType::INT && attrType != AttrType::FLOAT && attrType != AttrType::STRING )
+			return RETCODE::INVALIDSCAN;
+
+		if ( attrOffset + attrLength > _file->recordSize ( ) )
+			return RETCODE::INVALIDSCAN;
+
+		switch ( compOp ) {
+		case EQ_OP:
+			_comp = CompMethod::equal;
+			break;
+		case LT_OP:
+			_comp = CompMethod::less_than;
+			break;
+		case GT_OP:
+			_comp = CompMethod::greater_than;
+			break;
+		case LE_OP:
+			_comp = CompMethod::less_than_or_eq_to;
+			break;
+		case GE_OP:
+			_comp = CompMethod::greater_than_or_eq_to;
+			break;
+		case NE_OP:
+			_comp = CompMethod::not_equal;
+			break;
+		default:
+			return RETCODE::INVALIDSCAN;
+		}
+
+		_attrType = attrType;
+		_attrLength = attrLength;
+		_attrOffset = attrOffset;
+		_attrValue.assign (reinterpret_cast< char* >( value ), reinterpret_cast< char* >( value ) + attrLength);
+		_compOp = compOp;
+
+		_onKey = static_cast< size_t >( _file->header.keyOffset ) == attrOffset && _file->header.keyType == attrType
+			&& static_cast< size_t >( _file->header.keyLength ) == attrLength;
+	}
+
+	// initialize the status, EQ_OP, GT_OP and GE_OP on the key start at the leaf of the value
+	bool seek = _onKey && ( compOp == EQ_OP || compOp == GT_OP || compOp == GE_OP );
+
+	if ( result = _file->findLeaf (seek ? _attrValue.data ( ) : nullptr, _currentLeaf) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	_currentPos = 0;
+
+	if ( seek && _currentLeaf != Utils::UNKNOWNPAGENUM ) {		// an empty file has no leaf
+		char * pData;
+
+		if ( result = _file->getNode (_currentLeaf, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_currentPos = compOp == GT_OP ? _file->upperBound (pData, _attrValue.data ( )) : _file->lowerBound (pData, _attrValue.data ( ));
+	}
+
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ClusteredFileScan::GetNextRec (Record & rec) {
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
+
+	RETCODE result;
+	char * pData;
+
+	while ( _currentLeaf != Utils::UNKNOWNPAGENUM ) {
+
+		if ( result = _file->getNode (_currentLeaf, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		ClusteredNodeHeader * nHdr = ClusteredFile::nodeHeader (pData);
+
+		while ( _currentPos < nHdr->numKeys ) {
+			size_t pos = _currentPos++;
+			char * recData = _file->recordAt (pData, pos);
+
+			if ( _onKey && pastRange (recData + _attrOffset) ) {
+				_state = End;
+				return RETCODE::EOFSCAN;
+			}
+
+			if ( _comp == nullptr || _comp (recData + _attrOffset, _attrValue.data ( ), _attrType, _attrLength) ) {
+				rec = Record (RecordIdentifier{ _currentLeaf, static_cast< SlotNum >( pos ) }, recData, _file->recordSize ( ));
+				return RETCODE::COMPLETE;
+			}
+		}
+
+		_currentLeaf = nHdr->next;
+		_currentPos = 0;
+	}
+
+	_state = End;
+
+	return RETCODE::EOFSCAN;
+}
+
+inline RETCODE ClusteredFileScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_file = nullptr;
+
+	return RETCODE::COMPLETE;
+}
+
+inline bool ClusteredFileScan::pastRange (void * key) const {
+	void * value = const_cast< char* >( _attrValue.data ( ) );
+
+	switch ( _compOp ) {
+	case EQ_OP:
+	case LE_OP:
+		return CompMethod::greater_than (key, value, _attrType, _attrLength);
+	case LT_OP:
+		return CompMethod::greater_than_or_eq_to (key, value, _attrType, _attrLength);
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+/*
+	1. ColumnEncoding encodes and decodes the values of one chunk (one page) of a ColumnFile segment
+	2. Every chunk is encoded on its own, Encode picks the smallest of PLAIN, RLE, DICT and FOR(INT only)
+	3. Bit-packed codes are little-endian, starting from the lowest bit of the first byte
+*/
+
+#include "Utils.hpp"
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+enum ColumnEncodingType {
+	PLAIN_ENCODING = 0,			// values stored one after another
+	RLE_ENCODING,				// (run length, value) pairs
+	DICT_ENCODING,				// sorted distinct values followed by bit-packed codes
+	FOR_ENCODING,				// frame of reference: bit-packed (value - base), INT only
+};
+
+struct ColumnChunkHeader {		// stored at the beginning of every chunk page of a column segment
+
+	ColumnEncodingType encoding;
+
+	PageNum firstRow;			// row number of the first value in the chunk
+
+	size_t numValues;
+
+	size_t dataSize;			// bytes of encoded payload after the header
+
+	size_t numEntries;			// RLE: number of runs, DICT: number of dictionary entries
+
+	size_t bitWidth;			// DICT / FOR: bits per packed code
+
+	int base;					// FOR: the smallest value of the chunk
+
+	ColumnChunkHeader ( ) {
+		encoding = PLAIN_ENCODING;
+		firstRow = 0;
+		numValues = dataSize = numEntries = bitWidth = 0;
+		base = 0;
+	}
+
+};
+
+namespace ColumnEncoding {
+
+	const size_t MAXPAYLOAD = Utils::PAGESIZE - sizeof (ColumnChunkHeader);
+
+	const size_t RUNLENGTHSIZE = sizeof (uint32_t);
+
+	/*
+		Bit-packing helpers
+	*/
+
+	size_t BitsFor (uint64_t maxValue) {
+		size_t bits = 0;
+		while ( maxValue > 0 ) {
+			bits++;
+			maxValue >>= 1;
+		}
+		return bits;
+	}
+
+	size_t PackedSize (size_t n, size_t width) {
+		return ( n * width + 7 ) / 8;
+	}
+
+	void PackBits (const std::vector<uint32_t> & codes, size_t width, char * out) {
+		memset (out, 0, PackedSize (codes.size ( ), width));
+
+		if ( width == 0 )
+			return;
+
+		for ( size_t i = 0; i < codes.size ( ); i++ ) {
+			size_t bit = i * width;
+			uint64_t window = static_cast< uint64_t >( codes[i] ) << ( bit % 8 );
+			size_t need = ( bit % 8 + width + 7 ) / 8;
+			for ( size_t k = 0; k < need; k++ ) {
+				out[bit / 8 + k] |= static_cast< char >( ( window >> ( 8 * k ) ) & 0xFF );
+			}
+		}
+	}
+
+	uint32_t UnpackBits (const char * in, size_t width, size_t i) {
+		if ( width == 0 )
+			return 0;
+
+		size_t bit = i * width;
+		size_t need = ( bit % 8 + width + 7 ) / 8;
+		uint64_t window = 0;
+
+		for ( size_t k = 0; k < need; k++ ) {
+			window |= static_cast< uint64_t >( static_cast< unsigned char >( in[bit / 8 + k] ) ) << ( 8 * k );
+		}
+
+		return static_cast< uint32_t >( ( window >> ( bit % 8 ) ) & ( ( static_cast< uint64_t >( 1 ) << width ) - 1 ) );
+	}
+
+	/*
+		Size estimation of every encoding, return UNKNOWNPOS if the encoding is not applicable
+	*/
+
+	size_t plainSize (size_t n, size_t attrLength) {
+		return n * attrLength;
+	}
+
+	size_t rleSize (const char * values, size_t n, size_t attrLength, size_t & runs) {
+		runs = 0;
+		for ( size_t i = 0; i < n; i++ ) {
+			if ( i == 0 || memcmp (values + i * attrLength, values + ( i - 1 ) * attrLength, attrLength) != 0 )
+				runs++;
+		}
+		return runs * ( RUNLENGTHSIZE + attrLength );
+	}
+
+	size_t dictSize (const char * values, size_t n, size_t attrLength, std::map<std::string, uint32_t> & dict) {
+		dict.clear ( );
+		for ( size_t i = 0; i < n; i++ ) {
+			dict.insert ({ std::string (values + i * attrLength, attrLength), 0 });
+			if ( dict.size ( ) * attrLength > plainSize (n, attrLength) )		// no gain, stop counting
+				return Utils::UNKNOWNPOS;
+		}
+
+		uint32_t code = 0;
+		for ( auto & item : dict ) {				// codes follow the order of the sorted values
+			item.second = code++;
+		}
+
+		return dict.size ( ) * attrLength + PackedSize (n, BitsFor (dict.size ( ) - 1));
+	}
+
+	size_t forSize (const char * values, size_t n, AttrType attrType, int & base, size_t & width) {
+		if ( attrType != INT || n == 0 )
+			return Utils::UNKNOWNPOS;
+
+		int minValue = *reinterpret_cast< const int* >( values );
+		int maxValue = minValue;
+
+		for ( size_t i = 1; i < n; i++ ) {
+			int v = *reinterpret_cast< const int* >( values + i * sizeof (int) );
+			if ( v < minValue ) minValue = v;
+			if ( v > maxValue ) maxValue = v;
+		}
+
+		base = minValue;
+		width = BitsFor (static_cast< uint64_t >( static_cast< int64_t >( maxValue ) - minValue ));
+
+		return PackedSize (n, width);
+	}
+
+	/*
+		Encode n values (n * attrLength bytes) into out, and fill encoding info of hdr
+		hdr.firstRow is not touched
+	*/
+	RETCODE Encode (const char * values, size_t n, AttrType attrType, size_t attrLength,
+					ColumnChunkHeader & hdr, std::vector<char> & out) {
+
+		if ( values == nullptr || attrLength == 0 )
+			return RETCODE::BADRECORD;
+
+		size_t runs, width;
+		int base;
+		std::map<std::string, uint32_t> dict;
+
+		size_t best = plainSize (n, attrLength);
+		ColumnEncodingType encoding = PLAIN_ENCODING;
+
+		size_t sz = rleSize (values, n, attrLength, runs);
+		if ( sz < best ) {
+			best = sz;
+			encoding = RLE_ENCODING;
+		}
+
+		sz = dictSize (values, n, attrLength, dict);
+		if ( sz < best ) {
+			best = sz;
+			encoding = DICT_ENCODING;
+		}
+
+		sz = forSize (values, n, attrType, base, width);
+		if ( sz < best ) {
+			best = sz;
+			encoding = FOR_ENCODING;
+		}
+
+		hdr.encoding = encoding;
+		hdr.numValues = n;
+		hdr.dataSize = best;
+		hdr.numEntries = hdr.bitWidth = 0;
+		hdr.base = 0;
+
+		out.assign (best, 0);
+
+		switch ( encoding ) {
+		case PLAIN_ENCODING:
+			memcpy (out.data ( ), values, best);
+			break;
+
+		case RLE_ENCODING:
+		{
+			char * p = out.data ( );
+			size_t i = 0;
+			while ( i < n ) {
+				uint32_t len = 1;
+				while ( i + len < n && memcmp (values + ( i + len ) * attrLength, values + i * attrLength, attrLength) == 0 )
+					len++;
+				memcpy (p, &len, RUNLENGTHSIZE);
+				memcpy (p + RUNLENGTHSIZE, values + i * attrLength, attrLength);
+				p += RUNLENGTHSIZE + attrLength;
+				i += len;
+			}
+			hdr.numEntries = runs;
+			break;
+		}
+
+		case DICT_ENCODING:
+		{
+			char * p = out.data ( );
+			for ( auto & item : dict ) {
+				memcpy (p, item.first.data ( ), attrLength);
+				p += attrLength;
+			}
+
+			std::vector<uint32_t> codes (n);
+			for ( size_t i = 0; i < n; i++ ) {
+				codes[i] = dict[std::string (values + i * attrLength, attrLength)];
+			}
+
+			hdr.numEntries = dict.size ( );
+			hdr.bitWidth = BitsFor (dict.size ( ) - 1);
+			PackBits (codes, hdr.bitWidth, p);
+			break;
+		}
+
+		case FOR_ENCODING:
+		{
+			std::vector<uint32_t> codes (n);
+			for ( size_t i = 0; i < n; i++ ) {
+				int v = *reinterpret_cast< const int* >( values + i * sizeof (int) );
+				codes[i] = static_cast< uint32_t >( static_cast< int64_t >( v ) - base );
+			}
+
+			hdr.base = base;
+			hdr.bitWidth = width;
+			PackBits (codes, width, out.data ( ));
+			break;
+		}
+
+		default:
+			return RETCODE::UNEXPECTED;
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+	/*
+		Decode the i-th value of a chunk into dst (attrLength bytes)
+	*/
+	RETCODE DecodeValue (const ColumnChunkHeader & hdr, const char * payload, size_t attrLength, size_t i, char * dst) {
+
+		if ( i >= hdr.numValues )
+			return RETCODE::OUTOFRANGE;
+
+		switch ( hdr.encoding ) {
+		case PLAIN_ENCODING:
+			memcpy (dst, payload + i * attrLength, attrLength);
+			break;
+
+		case RLE_ENCODING:
+		{
+			const char * p = payload;
+			size_t pos = 0;
+			for ( size_t r = 0; r < hdr.numEntries; r++ ) {
+				uint32_t len;
+				memcpy (&len, p, RUNLENGTHSIZE);
+				if ( i < pos + len ) {
+					memcpy (dst, p + RUNLENGTHSIZE, attrLength);
+					return RETCODE::COMPLETE;
+				}
+				pos += len;
+				p += RUNLENGTHSIZE + attrLength;
+			}
+			return RETCODE::UNEXPECTED;
+		}
+
+		case DICT_ENCODING:
+		{
+			uint32_t code = UnpackBits (payload + hdr.numEntries * attrLength, hdr.bitWidth, i);
+			memcpy (dst, payload + code * attrLength, attrLength);
+			break;
+		}
+
+		case FOR_ENCODING:
+		{
+			int v = static_cast< int >( static_cast< int64_t >( hdr.base ) + UnpackBits (payload, hdr.bitWidth, i) );
+			memcpy (dst, &v, sizeof (int));
+			break;
+		}
+
+		default:
+			return RETCODE::UNEXPECTED;
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+	/*
+		Decode the whole chunk, out holds numValues * attrLength bytes
+	*/
+	RETCODE Decode (const ColumnChunkHeader & hdr, const char * payload, size_t attrLength, std::vector<char> & out) {
+
+		out.resize (hdr.numValues * attrLength);
+
+		switch ( hdr.encoding ) {
+		case PLAIN_ENCODING:
+			memcpy (out.data ( ), payload, out.size ( ));
+			break;
+
+		case RLE_ENCODING:
+		{
+			const char * p = payload;
+			char * dst = out.data ( );
+			for ( size_t r = 0; r < hdr.numEntries; r++ ) {
+				uint32_t len;
+				memcpy (&len, p, RUNLENGTHSIZE);
+				for ( uint32_t k = 0; k < len; k++, dst += attrLength ) {
+					memcpy (dst, p + RUNLENGTHSIZE, attrLength);
+				}
+				p += RUNLENGTHSIZE + attrLength;
+			}
+			break;
+		}
+
+		case DICT_ENCODING:
+		case FOR_ENCODING:
+			for ( size_t i = 0; i < hdr.numValues; i++ ) {
+				DecodeValue (hdr, payload, attrLength, i, out.data ( ) + i * attrLength);
+			}
+			break;
+
+		default:
+			return RETCODE::UNEXPECTED;
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+}
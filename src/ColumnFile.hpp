@@ -0,0 +1,681 @@
+#pragma once
+
+/*
+	1. ColumnFile is the column-oriented counterpart of RecordFile, used by tables created with COLUMN_ENGINE
+	2. The table file (fileName) keeps ColumnFileHeader and the DataAttrInfo of every attribute in page 1
+	3. Every attribute is stored in its own PageFile segment (SegmentFileName), managed by a ColumnSegment
+	4. Page 1 of a segment is ColumnSegmentHeader, chunk i is stored in page (i + FIRSTCHUNKPAGE)
+	5. Segments are append only, new values are buffered until CHUNKROWS values are pending and then encoded
+	6. A RecordIdentifier of a ColumnFile is { row number, 0 }
+*/
+
+#include "Utils.hpp"
+#include "Record.hpp"
+#include "BufferManager.hpp"
+#include "ColumnEncoding.hpp"
+
+struct ColumnSegmentHeader {			// stored in page 1 of every segment file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];		// "MicroSQL ColumnSegment"
+	AttrType attrType;
+	size_t attrLength;
+	PageNum numRows;					// rows stored in chunk pages, not include pending values
+	PageNum numChunks;
+
+	ColumnSegmentHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::COLUMNSEGMENTIDENTIFYSTRING);
+		attrLength = 0;
+		numRows = numChunks = 0;
+	}
+};
+
+struct ColumnFileHeader {				// stored in page 1 of the table file, followed by attrCount DataAttrInfo
+	char identifyString[Utils::IDENTIFYSTRINGLEN];		// "MicroSQL ColumnFile"
+	size_t recordSize;
+	size_t attrCount;
+	PageNum numRows;
+
+	ColumnFileHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::COLUMNFILEIDENTIFYSTRING);
+		recordSize = attrCount = 0;
+		numRows = 0;
+	}
+};
+
+class ColumnSegment {
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static PageNum FIRSTCHUNKPAGE = 2;
+
+	const static size_t CHUNKROWS = 8192;		// pending values encoded at a time
+
+	ColumnSegment ( );
+	~ColumnSegment ( );
+
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE Append (const char * value);
+
+	RETCODE Flush ( );						// encode all pending values into chunk pages
+
+	/*
+		chunk == NumChunks() reads the pending values as the last chunk
+	*/
+	RETCODE ReadChunk (PageNum chunk, PageNum & firstRow, std::vector<char> & values);
+
+	RETCODE FindChunk (PageNum row, PageNum & chunk);
+
+	RETCODE GetValue (PageNum row, char * dst);
+
+	RETCODE ReadHeader ( );
+	RETCODE SaveHeader ( ) const;
+
+	PageNum NumRows ( ) const;					// include pending values
+
+	PageNum NumChunks ( ) const;				// not include the pending chunk
+
+	bool HasPending ( ) const;
+
+	AttrType GetAttrType ( ) const;
+
+	size_t GetAttrLength ( ) const;
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+private:
+
+	RETCODE writeChunk (const char * values, size_t n, PageNum firstRow);
+
+	RETCODE readChunkHeader (PageNum chunk, ColumnChunkHeader & hdr, PagePtr & page);
+
+	ColumnSegmentHeader header;
+
+	BufferManagerPtr bufMgr;
+
+	std::vector<char> pending;
+
+	mutable bool headerModified;
+
+};
+
+using ColumnSegmentPtr = shared_ptr<ColumnSegment>;
+
+class ColumnFile {
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	ColumnFile ( );
+	~ColumnFile ( );
+
+	/*
+		The file must be opened before any other operation, then every segment is attached by OpenSegment
+	*/
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE OpenSegment (size_t attr, const ColumnSegmentPtr & segment);
+
+	RETCODE InsertRec (const char * pData, RecordIdentifier & rid);		// Append a new record, and return record id
+	RETCODE GetRec (const RecordIdentifier & rid, Record & rec) const;
+
+	RETCODE Flush ( );
+
+	RETCODE ReadHeader ( );
+	RETCODE SaveHeader ( ) const;
+
+	RETCODE GetHeader (ColumnFileHeader & hdr) const;
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	bool isValidColumnFile ( ) const;
+
+	size_t AttrCount ( ) const;
+
+	const DataAttrInfo & GetAttr (size_t attr) const;
+
+	size_t FindAttrByOffset (size_t attrOffset) const;			// UNKNOWNPOS if not found
+
+	ColumnSegmentPtr GetSegment (size_t attr) const;
+
+	PageNum NumRows ( ) const;
+
+	size_t RecordSize ( ) const;
+
+	static std::string SegmentFileName (const char * fileName, const char * attrName);
+
+private:
+
+	ColumnFileHeader header;
+
+	std::vector<DataAttrInfo> attrs;
+
+	std::vector<ColumnSegmentPtr> segments;
+
+	BufferManagerPtr bufMgr;
+
+	mutable bool headerModified;
+
+	bool isFileOpen;
+
+};
+
+using ColumnFilePtr = shared_ptr<ColumnFile>;
+
+/*
+	ColumnSegment
+*/
+
+ColumnSegment::ColumnSegment ( ) {
+	bufMgr = nullptr;
+	headerModified = false;
+}
+
+ColumnSegment::~ColumnSegment ( ) {
+	RETCODE result;
+
+	if ( bufMgr == nullptr )
+		return;
+
+	if ( result = Flush ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+	}
+
+	if ( headerModified ) {
+		SaveHeader ( );
+	}
+}
+
+inline RETCODE ColumnSegment::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( result = ReadHeader ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	pending.reserve (CHUNKROWS * header.attrLength);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::Append (const char * value) {
+
+	if ( value == nullptr )
+		return RETCODE::BADRECORD;
+
+	pending.insert (pending.end ( ), value, value + header.attrLength);
+
+	if ( pending.size ( ) >= CHUNKROWS * header.attrLength )
+		return Flush ( );
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::Flush ( ) {
+	RETCODE result = RETCODE::COMPLETE;
+
+	if ( pending.empty ( ) )
+		return result;
+
+	if ( result = writeChunk (pending.data ( ), pending.size ( ) / header.attrLength, header.numRows) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	pending.clear ( );
+
+	return SaveHeader ( );
+}
+
+/*
+	Encode values[0, n) into one page, if the encoded data cannot fit in one page
+	split the values into two halves and try again
+*/
+inline RETCODE ColumnSegment::writeChunk (const char * values, size_t n, PageNum firstRow) {
+	RETCODE result;
+	ColumnChunkHeader chunkHdr;
+	std::vector<char> payload;
+
+	if ( result = ColumnEncoding::Encode (values, n, header.attrType, header.attrLength, chunkHdr, payload) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( payload.size ( ) > ColumnEncoding::MAXPAYLOAD ) {
+		size_t half = n / 2;
+
+		if ( half == 0 )
+			return RETCODE::BADRECORD;
+
+		if ( ( result = writeChunk (values, half, firstRow) )
+			 || ( result = writeChunk (values + half * header.attrLength, n - half, firstRow + half) ) ) {
+			return result;
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+	chunkHdr.firstRow = firstRow;
+
+	PagePtr page;
+	PageNum pageNum;
+	char * pData;
+
+	if ( ( result = bufMgr->AllocatePage (page) ) || ( result = page->GetData (pData) )
+		 || ( result = page->GetPageNum (pageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	assert (pageNum == header.numChunks + FIRSTCHUNKPAGE);
+
+	memcpy_s (pData, sizeof (ColumnChunkHeader), reinterpret_cast< const void* >( &chunkHdr ), sizeof (ColumnChunkHeader));
+	memcpy_s (pData + sizeof (ColumnChunkHeader), ColumnEncoding::MAXPAYLOAD, payload.data ( ), payload.size ( ));
+
+	if ( ( result = bufMgr->ForcePage (pageNum) ) || ( result = bufMgr->UnlockPage (pageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.numChunks++;
+	header.numRows += n;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::readChunkHeader (PageNum chunk, ColumnChunkHeader & hdr, PagePtr & page) {
+	RETCODE result;
+	PageNum pageNum = chunk + FIRSTCHUNKPAGE;
+	char * pData;
+
+	if ( chunk >= header.numChunks )
+		return RETCODE::EOFFILE;
+
+	if ( ( result = bufMgr->GetPage (pageNum, page) ) || ( result = bufMgr->UnlockPage (pageNum) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &hdr ), sizeof (ColumnChunkHeader), pData, sizeof (ColumnChunkHeader));
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::ReadChunk (PageNum chunk, PageNum & firstRow, std::vector<char> & values) {
+	RETCODE result;
+
+	if ( chunk == header.numChunks ) {			// the pending chunk
+		if ( pending.empty ( ) )
+			return RETCODE::EOFFILE;
+		firstRow = header.numRows;
+		values = pending;
+		return RETCODE::COMPLETE;
+	}
+
+	ColumnChunkHeader chunkHdr;
+	PagePtr page;
+
+	if ( result = readChunkHeader (chunk, chunkHdr, page) ) {
+		return result;
+	}
+
+	firstRow = chunkHdr.firstRow;
+
+	return ColumnEncoding::Decode (chunkHdr, page->GetDataRawPtr ( ) + sizeof (ColumnChunkHeader), header.attrLength, values);
+}
+
+/*
+	Binary search the chunk which contains row, chunk pages are sorted by firstRow
+*/
+inline RETCODE ColumnSegment::FindChunk (PageNum row, PageNum & chunk) {
+	RETCODE result;
+
+	if ( row >= NumRows ( ) )
+		return RETCODE::EOFFILE;
+
+	if ( row >= header.numRows ) {
+		chunk = header.numChunks;
+		return RETCODE::COMPLETE;
+	}
+
+	PageNum lo = 0, hi = header.numChunks;			// the answer is in [lo, hi)
+
+	while ( hi - lo > 1 ) {
+		PageNum mid = lo + ( hi - lo ) / 2;
+		ColumnChunkHeader chunkHdr;
+		PagePtr page;
+
+		if ( result = readChunkHeader (mid, chunkHdr, page) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( chunkHdr.firstRow <= row )
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	chunk = lo;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::GetValue (PageNum row, char * dst) {
+	RETCODE result;
+	PageNum chunk;
+
+	if ( result = FindChunk (row, chunk) )
+		return result;
+
+	if ( chunk == header.numChunks ) {
+		memcpy (dst, pending.data ( ) + ( row - header.numRows ) * header.attrLength, header.attrLength);
+		return RETCODE::COMPLETE;
+	}
+
+	ColumnChunkHeader chunkHdr;
+	PagePtr page;
+
+	if ( result = readChunkHeader (chunk, chunkHdr, page) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return ColumnEncoding::DecodeValue (chunkHdr, page->GetDataRawPtr ( ) + sizeof (ColumnChunkHeader),
+										header.attrLength, static_cast< size_t >( row - chunkHdr.firstRow ), dst);
+}
+
+inline RETCODE ColumnSegment::ReadHeader ( ) {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (ColumnSegmentHeader), pData, sizeof (ColumnSegmentHeader));
+
+	if ( strcmp (header.identifyString, Utils::COLUMNSEGMENTIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDPAGEFILE;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnSegment::SaveHeader ( ) const {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (ColumnSegmentHeader), reinterpret_cast< const void* >( &header ), sizeof (ColumnSegmentHeader));
+
+	if ( ( result = bufMgr->ForcePage (HEADERPAGE) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+inline PageNum ColumnSegment::NumRows ( ) const {
+	return header.numRows + pending.size ( ) / header.attrLength;
+}
+
+inline PageNum ColumnSegment::NumChunks ( ) const {
+	return header.numChunks;
+}
+
+inline bool ColumnSegment::HasPending ( ) const {
+	return !pending.empty ( );
+}
+
+inline AttrType ColumnSegment::GetAttrType ( ) const {
+	return header.attrType;
+}
+
+inline size_t ColumnSegment::GetAttrLength ( ) const {
+	return header.attrLength;
+}
+
+inline RETCODE ColumnSegment::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+/*
+	ColumnFile
+*/
+
+ColumnFile::ColumnFile ( ) {
+	bufMgr = nullptr;
+	headerModified = false;
+	isFileOpen = false;
+}
+
+ColumnFile::~ColumnFile ( ) {
+	if ( headerModified ) {
+		SaveHeader ( );
+	}
+}
+
+inline RETCODE ColumnFile::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+
+	if ( isFileOpen || bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( result = ReadHeader ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	segments.assign (header.attrCount, nullptr);
+	isFileOpen = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::OpenSegment (size_t attr, const ColumnSegmentPtr & segment) {
+
+	if ( attr >= AttrCount ( ) )
+		return RETCODE::OUTOFRANGE;
+
+	if ( segment == nullptr || segment->GetAttrType ( ) != attrs[attr].attrType
+		 || segment->GetAttrLength ( ) != static_cast< size_t >( attrs[attr].attrLength ) )
+		return RETCODE::INVALIDPAGEFILE;
+
+	segments[attr] = segment;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::InsertRec (const char * pData, RecordIdentifier & rid) {
+	RETCODE result;
+
+	if ( pData == nullptr )
+		return RETCODE::BADRECORD;
+
+	for ( size_t i = 0; i < AttrCount ( ); i++ ) {
+		if ( result = segments[i]->Append (pData + attrs[i].offset) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	rid = RecordIdentifier{ header.numRows, 0 };
+
+	header.numRows++;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::GetRec (const RecordIdentifier & rid, Record & rec) const {
+	RETCODE result;
+	PageNum row;
+
+	if ( result = rid.GetPageNum (row) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( row >= NumRows ( ) )
+		return RETCODE::EOFFILE;
+
+	std::vector<char> buf (RecordSize ( ), 0);
+
+	for ( size_t i = 0; i < AttrCount ( ); i++ ) {
+		if ( result = segments[i]->GetValue (row, buf.data ( ) + attrs[i].offset) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	rec = Record (rid, buf.data ( ), RecordSize ( ));
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::Flush ( ) {
+	RETCODE result;
+
+	for ( auto & segment : segments ) {
+		if ( segment != nullptr && ( result = segment->Flush ( ) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	return SaveHeader ( );
+}
+
+inline RETCODE ColumnFile::ReadHeader ( ) {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (ColumnFileHeader), pData, sizeof (ColumnFileHeader));
+
+	if ( strcmp (header.identifyString, Utils::COLUMNFILEIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDPAGEFILE;
+
+	attrs.clear ( );
+	pData += sizeof (ColumnFileHeader);
+
+	for ( size_t i = 0; i < header.attrCount; i++, pData += sizeof (DataAttrInfo) ) {
+		attrs.push_back (DataAttrInfo (pData));
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::SaveHeader ( ) const {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( bufMgr == nullptr ) {
+		Utils::PrintRetcode (RETCODE::HDRWRITE, __FUNCTION__, __LINE__);
+		return RETCODE::HDRWRITE;
+	}
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (ColumnFileHeader), reinterpret_cast< const void* >( &header ), sizeof (ColumnFileHeader));
+
+	if ( ( result = bufMgr->ForcePage (HEADERPAGE) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::GetHeader (ColumnFileHeader & hdr) const {
+	hdr = header;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFile::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline bool ColumnFile::isValidColumnFile ( ) const {
+	if ( strcmp (header.identifyString, Utils::COLUMNFILEIDENTIFYSTRING) != 0 )
+		return false;
+
+	for ( auto & segment : segments ) {
+		if ( segment == nullptr )
+			return false;
+	}
+
+	return true;
+}
+
+inline size_t ColumnFile::AttrCount ( ) const {
+	return header.attrCount;
+}
+
+inline const DataAttrInfo & ColumnFile::GetAttr (size_t attr) const {
+	return attrs[attr];
+}
+
+inline size_t ColumnFile::FindAttrByOffset (size_t attrOffset) const {
+	for ( size_t i = 0; i < AttrCount ( ); i++ ) {
+		if ( static_cast< size_t >( attrs[i].offset ) == attrOffset )
+			return i;
+	}
+	return Utils::UNKNOWNPOS;
+}
+
+inline ColumnSegmentPtr ColumnFile::GetSegment (size_t attr) const {
+	if ( attr >= AttrCount ( ) )
+		return nullptr;
+	return segments[attr];
+}
+
+inline PageNum ColumnFile::NumRows ( ) const {
+	return header.numRows;
+}
+
+inline size_t ColumnFile::RecordSize ( ) const {
+	return header.recordSize;
+}
+
+inline std::string ColumnFile::SegmentFileName (const char * fileName, const char * attrName) {
+	return std::string (fileName) + "." + attrName + ".col";
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+/*
+	1. ColumnFileManager creates, destroys, opens and closes the files of a COLUMN_ENGINE table
+	2. A table consists of the table file (ColumnFileHeader + attributes) and one segment file per attribute
+*/
+
+#include "Utils.hpp"
+#include "ColumnFile.hpp"
+#include "ColumnFileScan.hpp"
+#include "PageFileManager.hpp"
+
+class ColumnFileManager {
+
+public:
+	ColumnFileManager ( );
+	~ColumnFileManager ( );
+
+	RETCODE CreateFile (const char * fileName, int attrCount, const DataAttrInfo * attributes);
+	RETCODE DestroyFile (const char * fileName);
+	RETCODE OpenFile (const char * fileName, ColumnFilePtr & fileHandle);
+
+	RETCODE CloseFile (ColumnFilePtr & fileHandle);
+
+private:
+
+	RETCODE createSegment (const char * fileName, const DataAttrInfo & attr);
+
+	PageFileManagerPtr _pfMgr;
+
+};
+
+using ColumnFileManagerPtr = shared_ptr<ColumnFileManager>;
+
+ColumnFileManager::ColumnFileManager ( ) {
+	_pfMgr = make_shared<PageFileManager> ( );
+}
+
+ColumnFileManager::~ColumnFileManager ( ) {
+}
+
+inline RETCODE ColumnFileManager::CreateFile (const char * fileName, int attrCount, const DataAttrInfo * attributes) {
+
+	if ( fileName == nullptr )
+		return RETCODE::INVALIDNAME;
+
+	if ( attrCount <= 0 || attributes == nullptr
+		 || sizeof (ColumnFileHeader) + attrCount * sizeof (DataAttrInfo) > Utils::PAGESIZE )
+		return RETCODE::CREATEFAILED;
+
+	RETCODE result;
+	ColumnFileHeader header;
+
+	header.attrCount = attrCount;
+
+	for ( int i = 0; i < attrCount; i++ ) {
+		if ( attributes[i].attrLength <= 0 || static_cast< size_t >( attributes[i].attrLength ) > ColumnEncoding::MAXPAYLOAD )
+			return RETCODE::CREATEFAILED;
+		header.recordSize += attributes[i].attrLength;
+	}
+
+	if ( result = _pfMgr->CreateFile (fileName) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	PageFilePtr pageFile;
+	BufferManagerPtr bufMgr;
+
+	if ( result = _pfMgr->OpenFile (fileName, pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	bufMgr = make_shared<BufferManager> (pageFile);
+
+	PagePtr headerPage;
+	PageNum headerPageNum;
+	char * pData;
+
+	if ( ( result = bufMgr->AllocatePage (headerPage) ) || ( result = headerPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (ColumnFileHeader), reinterpret_cast< const void* >( &header ), sizeof (ColumnFileHeader));
+	memcpy_s (pData + sizeof (ColumnFileHeader), Utils::PAGESIZE - sizeof (ColumnFileHeader),
+			  reinterpret_cast< const void* >( attributes ), attrCount * sizeof (DataAttrInfo));
+
+	headerPage->GetPageNum (headerPageNum);
+
+	if ( ( result = bufMgr->ForcePage (headerPageNum) ) || ( result = bufMgr->UnlockPage (headerPageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = _pfMgr->CloseFile (pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( int i = 0; i < attrCount; i++ ) {
+		if ( result = createSegment (fileName, attributes[i]) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFileManager::createSegment (const char * fileName, const DataAttrInfo & attr) {
+	RETCODE result;
+	std::string segmentName = ColumnFile::SegmentFileName (fileName, attr.attrName);
+
+	if ( result = _pfMgr->CreateFile (segmentName.c_str ( )) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	PageFilePtr pageFile;
+
+	if ( result = _pfMgr->OpenFile (segmentName.c_str ( ), pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	BufferManagerPtr bufMgr = make_shared<BufferManager> (pageFile);
+
+	PagePtr headerPage;
+	PageNum headerPageNum;
+	char * pData;
+
+	if ( ( result = bufMgr->AllocatePage (headerPage) ) || ( result = headerPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	ColumnSegmentHeader header;
+	header.attrType = attr.attrType;
+	header.attrLength = attr.attrLength;
+
+	memcpy_s (pData, sizeof (ColumnSegmentHeader), reinterpret_cast< const void* >( &header ), sizeof (ColumnSegmentHeader));
+
+	headerPage->GetPageNum (headerPageNum);
+
+	if ( ( result = bufMgr->ForcePage (headerPageNum) ) || ( result = bufMgr->UnlockPage (headerPageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return _pfMgr->CloseFile (pageFile);
+}
+
+inline RETCODE ColumnFileManager::DestroyFile (const char * fileName) {
+	RETCODE result;
+	ColumnFilePtr fileHandle;
+
+	if ( result = OpenFile (fileName, fileHandle) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	std::vector<std::string> names;
+
+	for ( size_t i = 0; i < fileHandle->AttrCount ( ); i++ ) {
+		names.push_back (ColumnFile::SegmentFileName (fileName, fileHandle->GetAttr (i).attrName));
+	}
+
+	if ( result = CloseFile (fileHandle) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	fileHandle = nullptr;			// release the buffers before removing the files
+
+	for ( auto & name : names ) {
+		if ( result = _pfMgr->DestroyFile (name.c_str ( )) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	return _pfMgr->DestroyFile (fileName);
+}
+
+inline RETCODE ColumnFileManager::OpenFile (const char * fileName, ColumnFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( fileName == nullptr )
+		return RETCODE::INVALIDNAME;
+
+	if ( result = _pfMgr->OpenFile (fileName, ptr) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	fileHandle = make_shared<ColumnFile> ( );
+
+	if ( result = fileHandle->Open (make_shared<BufferManager> (ptr)) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( size_t i = 0; i < fileHandle->AttrCount ( ); i++ ) {
+		std::string segmentName = ColumnFile::SegmentFileName (fileName, fileHandle->GetAttr (i).attrName);
+		ColumnSegmentPtr segment = make_shared<ColumnSegment> ( );
+
+		if ( ( result = _pfMgr->OpenFile (segmentName.c_str ( ), ptr) )
+			 || ( result = segment->Open (make_shared<BufferManager> (ptr)) )
+			 || ( result = fileHandle->OpenSegment (i, segment) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFileManager::CloseFile (ColumnFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( fileHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( result = fileHandle->Flush ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( size_t i = 0; i < fileHandle->AttrCount ( ); i++ ) {
+		ColumnSegmentPtr segment = fileHandle->GetSegment (i);
+
+		if ( segment == nullptr )
+			continue;
+
+		if ( ( result = segment->GetPageFilePtr (ptr) ) || ( result = _pfMgr->CloseFile (ptr) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	if ( ( result = fileHandle->GetPageFilePtr (ptr) ) || ( result = _pfMgr->CloseFile (ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
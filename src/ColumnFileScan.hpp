@@ -0,0 +1,299 @@
+#pragma once
+
+/*
+	1. ColumnFileScan scans a ColumnFile with the same interface as RecordFileScan
+	2. The predicate column drives the scan: its chunks are decoded one by one and the matching rows are selected
+	3. Only the projected columns are read for the selected rows, the other attributes of the returned Record are zero
+*/
+
+#include "Utils.hpp"
+#include "ColumnFile.hpp"
+
+class ColumnFileScan {
+public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	ColumnFileScan ( );
+	~ColumnFileScan ( );
+
+	RETCODE OpenScan (const ColumnFilePtr &fileHandle,  // Initialize file scan
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value);
+
+	RETCODE OpenScan (const ColumnFilePtr &fileHandle,  // Initialize file scan reading only the projected attributes
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value,
+					  const std::vector<size_t> & projection);		// indexes of attributes, empty for all
+
+	RETCODE GetNextRec (Record &rec);                  // Get next matching record
+
+	RETCODE CloseScan ( );                                // Terminate file scan
+
+private:
+
+	struct ColumnCursor {					// the decoded chunk of one column
+
+		ColumnSegmentPtr segment;
+
+		PageNum chunk;
+
+		PageNum firstRow;
+
+		std::vector<char> values;
+
+		size_t attrLength;
+
+		bool Contains (PageNum row) const {
+			return chunk != Utils::UNKNOWNPAGENUM && row >= firstRow && row < firstRow + values.size ( ) / attrLength;
+		}
+
+	};
+
+	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	RETCODE nextBatch ( );
+
+	RETCODE seek (ColumnCursor & cursor, PageNum row);
+
+	Comparator _comp;
+
+	ColumnFilePtr _colFile;
+
+	AttrType _attrType;
+
+	size_t _attrLength;
+
+	std::vector<char> _attrValue;
+
+	size_t _driver;							// the attribute whose chunks drive the scan
+
+	std::vector<size_t> _projection;
+
+	std::vector<ColumnCursor> _cursors;		// one cursor per attribute, only projected ones are used
+
+	std::vector<size_t> _selection;			// positions of matching rows in the driver chunk
+
+	size_t _selPos;
+
+	PageNum _nextChunk;
+
+	ScanState _state;
+
+};
+
+ColumnFileScan::ColumnFileScan ( ) {
+	_state = ScanState::Close;
+	_comp = nullptr;
+	_colFile = nullptr;
+	_selPos = 0;
+	_nextChunk = 0;
+}
+
+ColumnFileScan::~ColumnFileScan ( ) {
+
+}
+
+inline RETCODE ColumnFileScan::OpenScan (const ColumnFilePtr & fileHandle, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value) {
+	return OpenScan (fileHandle, attrType, attrLength, attrOffset, compOp, value, std::vector<size_t> ( ));
+}
+
+inline RETCODE ColumnFileScan::OpenScan (const ColumnFilePtr & fileHandle, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value, const std::vector<size_t> & projection) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( fileHandle == nullptr || !fileHandle->isValidColumnFile ( ) )
+		return RETCODE::INVALIDPAGEFILE;
+
+	_colFile = fileHandle;
+	_comp = nullptr;
+	_driver = 0;
+
+	if ( value != nullptr && compOp != NO_OP ) {			// has condition
+
+		_driver = _colFile->FindAttrByOffset (attrOffset);
+
+		if ( _driver == Utils::UNKNOWNPOS || _colFile->GetAttr (_driver).attrType != attrType
+			 || static_cast< size_t >( _colFile->GetAttr (_driver).attrLength ) != attrLength )
+			return RETCODE::INVALIDSCAN;
+
+		switch ( compOp ) {
+		case EQ_OP:
+			_comp = CompMethod::equal;
+			break;
+		case LT_OP:
+			_comp = CompMethod::less_than;
+			break;
+		case GT_OP:
+			_comp = CompMethod::greater_than;
+			break;
+		case LE_OP:
+			_comp = CompMethod::less_than_or_eq_to;
+			break;
+		case GE_OP:
+			_comp = CompMethod::greater_than_or_eq_to;
+			break;
+		case NE_OP:
+			_comp = CompMethod::not_equal;
+			break;
+		default:
+			return RETCODE::INVALIDSCAN;
+		}
+
+		_attrType = attrType;
+		_attrLength = attrLength;
+		_attrValue.assign (reinterpret_cast< char* >( value ), reinterpret_cast< char* >( value ) + attrLength);
+
+	} else if ( !projection.empty ( ) ) {
+		_driver = projection[0];
+	}
+
+	_projection.clear ( );
+
+	if ( projection.empty ( ) ) {
+		for ( size_t i = 0; i < _colFile->AttrCount ( ); i++ )
+			_projection.push_back (i);
+	} else {
+		for ( auto attr : projection ) {
+			if ( attr >= _colFile->AttrCount ( ) )
+				return RETCODE::INVALIDSCAN;
+			_projection.push_back (attr);
+		}
+	}
+
+	_cursors.assign (_colFile->AttrCount ( ), ColumnCursor ( ));
+
+	for ( size_t i = 0; i < _cursors.size ( ); i++ ) {
+		_cursors[i].segment = _colFile->GetSegment (i);
+		_cursors[i].chunk = Utils::UNKNOWNPAGENUM;
+		_cursors[i].firstRow = 0;
+		_cursors[i].attrLength = _colFile->GetAttr (i).attrLength;
+	}
+
+	// initialize the status
+	_selection.clear ( );
+	_selPos = 0;
+	_nextChunk = 0;
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Decode the next chunk of the driver column and select the matching rows
+*/
+inline RETCODE ColumnFileScan::nextBatch ( ) {
+	RETCODE result;
+	ColumnCursor & driver = _cursors[_driver];
+
+	_selection.clear ( );
+	_selPos = 0;
+
+	while ( _selection.empty ( ) ) {
+
+		if ( _nextChunk > driver.segment->NumChunks ( ) )
+			return RETCODE::EOFSCAN;
+
+		if ( result = driver.segment->ReadChunk (_nextChunk, driver.firstRow, driver.values) ) {
+			if ( result == RETCODE::EOFFILE )
+				return RETCODE::EOFSCAN;
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		driver.chunk = _nextChunk++;
+
+		size_t n = driver.values.size ( ) / driver.attrLength;
+
+		for ( size_t i = 0; i < n; i++ ) {
+			if ( _comp == nullptr || _comp (driver.values.data ( ) + i * driver.attrLength, _attrValue.data ( ), _attrType, _attrLength) )
+				_selection.push_back (i);
+		}
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Move the cursor to the chunk containing row, rows are visited in increasing order
+*/
+inline RETCODE ColumnFileScan::seek (ColumnCursor & cursor, PageNum row) {
+	RETCODE result;
+	PageNum chunk;
+
+	if ( cursor.Contains (row) )
+		return RETCODE::COMPLETE;
+
+	if ( cursor.chunk != Utils::UNKNOWNPAGENUM && row >= cursor.firstRow + cursor.values.size ( ) / cursor.attrLength ) {
+		chunk = cursor.chunk + 1;			// most likely the following chunk
+		if ( ( result = cursor.segment->ReadChunk (chunk, cursor.firstRow, cursor.values) ) == RETCODE::COMPLETE ) {
+			cursor.chunk = chunk;
+			if ( cursor.Contains (row) )
+				return RETCODE::COMPLETE;
+		}
+	}
+
+	if ( ( result = cursor.segment->FindChunk (row, chunk) )
+		 || ( result = cursor.segment->ReadChunk (chunk, cursor.firstRow, cursor.values) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	cursor.chunk = chunk;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFileScan::GetNextRec (Record & rec) {
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
+
+	RETCODE result;
+
+	if ( _selPos == _selection.size ( ) ) {
+		if ( result = nextBatch ( ) ) {
+			if ( result == RETCODE::EOFSCAN )
+				_state = End;
+			return result;
+		}
+	}
+
+	PageNum row = _cursors[_driver].firstRow + _selection[_selPos++];
+	std::vector<char> buf (_colFile->RecordSize ( ), 0);
+
+	for ( auto attr : _projection ) {
+		ColumnCursor & cursor = _cursors[attr];
+
+		if ( result = seek (cursor, row) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		memcpy (buf.data ( ) + _colFile->GetAttr (attr).offset,
+				cursor.values.data ( ) + ( row - cursor.firstRow ) * cursor.attrLength, cursor.attrLength);
+	}
+
+	rec = Record (RecordIdentifier{ row, 0 }, buf.data ( ), buf.size ( ));
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ColumnFileScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_cursors.clear ( );
+	_selection.clear ( );
+
+	return RETCODE::COMPLETE;
+}
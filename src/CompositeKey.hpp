@@ -0,0 +1,236 @@
+#pragma once
+
+/*
+	1. CompositeKey encodes the values of an ordered list of attributes into one key of type COMPOSITE,
+	   the keys compare with memcmp in the order of the first attribute, then the second and so on
+	2. Every attribute takes attrLength bytes: INT and FLOAT are stored big endian with the sign bit flipped
+	   (a negative FLOAT has all its bits flipped), a STRING is cut at its '\0' and padded with '\0'
+	3. The keys whose first attributes equal some values form one range, the next attribute may limit it further,
+	   Bounds gives the two keys of the range for IndexScan
+	4. The last numIncluded columns are INCLUDE columns, they follow the KeyLength bytes of the key columns and are never compared,
+	   the index keeps them in the leaves only to be read back by an index-only scan. DecodeRecord writes every column back
+	   at its offset in the record
+*/
+
+#include "Utils.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct KeyColumn {
+	AttrType attrType;
+	size_t attrLength;
+	size_t offset;				// of the attribute in the record
+};
+
+class CompositeKey {
+public:
+
+	const static size_t MAXCOLUMNS = 8;
+
+	CompositeKey ( );
+
+	explicit CompositeKey (const std::vector<KeyColumn> & columns, size_t numIncluded = 0);
+
+	size_t Length ( ) const;			// the bytes of a key with its INCLUDE columns
+
+	size_t KeyLength ( ) const;			// the bytes of the key columns, the part of a key that is compared
+
+	size_t NumColumns ( ) const;
+
+	size_t NumKeyColumns ( ) const;		// the columns before the INCLUDE columns
+
+	const KeyColumn & Column (size_t column) const;
+
+	void EncodeRecord (const char * pData, char * key) const;		// the key of the record
+
+	void EncodeValue (size_t column, const void * value, char * key) const;		// the bytes of the column in key
+
+	void DecodeRecord (const char * key, char * pData) const;		// the columns of key into the record
+
+	void DecodeValue (size_t column, const char * key, void * value) const;
+
+	bool Covers (const std::vector<size_t> & offsets) const;		// every attribute at one of offsets is a column
+
+	/*
+		The keys whose first numEqual attributes are values and whose next attribute is between low and high,
+		a nullptr bound does not limit it. The bounds keep the inclusiveness given for low and high,
+		a missing bound is inclusive
+	*/
+	void Bounds (const void * const * values, size_t numEqual, const void * low, bool lowInclusive, const void * high, bool highInclusive,
+				 std::vector<char> & lowKey, std::vector<char> & highKey) const;
+
+	RETCODE Validate ( ) const;			// BADATTR unless every column can be encoded
+
+private:
+
+	std::vector<KeyColumn> _columns;
+
+	std::vector<size_t> _keyOffsets;	// of every attribute in the key
+
+	size_t _length;
+
+	size_t _numIncluded;
+
+};
+
+CompositeKey::CompositeKey ( ) {
+	_length = 0;
+	_numIncluded = 0;
+}
+
+CompositeKey::CompositeKey (const std::vector<KeyColumn> & columns, size_t numIncluded) {
+	_columns = columns;
+	_length = 0;
+	_numIncluded = numIncluded;
+
+	for ( const KeyColumn & column : _columns ) {
+		_keyOffsets.push_back (_length);
+		_length += column.attrLength;
+	}
+}
+
+inline size_t CompositeKey::Length ( ) const {
+	return _length;
+}
+
+inline size_t CompositeKey::KeyLength ( ) const {
+	return _numIncluded > 0 ? _keyOffsets[NumKeyColumns ( )] : _length;
+}
+
+inline size_t CompositeKey::NumColumns ( ) const {
+	return _columns.size ( );
+}
+
+inline size_t CompositeKey::NumKeyColumns ( ) const {
+	return _columns.size ( ) - _numIncluded;
+}
+
+inline const KeyColumn & CompositeKey::Column (size_t column) const {
+	return _columns[column];
+}
+
+inline void CompositeKey::EncodeRecord (const char * pData, char * key) const {
+	for ( size_t i = 0; i < _columns.size ( ); i++ )
+		EncodeValue (i, pData + _columns[i].offset, key);
+}
+
+inline void CompositeKey::EncodeValue (size_t column, const void * value, char * key) const {
+	const KeyColumn & col = _columns[column];
+	unsigned char * dst = reinterpret_cast< unsigned char* >( key + _keyOffsets[column] );
+	uint32_t bits;
+
+	switch ( col.attrType ) {
+	case INT:
+		memcpy (&bits, value, sizeof (bits));
+		bits ^= 0x80000000u;
+		break;
+	case FLOAT:
+		memcpy (&bits, value, sizeof (bits));
+		bits = *reinterpret_cast< const float* >( value ) == 0.0f ? 0 : bits;		// -0.0f is 0.0f
+		bits = bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+		break;
+	default: {
+		size_t length = strnlen (reinterpret_cast< const char* >( value ), col.attrLength);
+
+		memcpy (dst, value, length);
+		memset (dst + length, 0, col.attrLength - length);
+		return;
+	}
+	}
+
+	for ( size_t i = 0; i < sizeof (bits); i++ )
+		dst[i] = static_cast< unsigned char >( bits >> ( 8 * ( sizeof (bits) - 1 - i ) ) );
+}
+
+inline void CompositeKey::DecodeRecord (const char * key, char * pData) const {
+	for ( size_t i = 0; i < _columns.size ( ); i++ )
+		DecodeValue (i, key, pData + _columns[i].offset);
+}
+
+/*
+	A STRING gets its padding back as '\0', -0.0f comes back as 0.0f
+*/
+inline void CompositeKey::DecodeValue (size_t column, const char * key, void * value) const {
+	const KeyColumn & col = _columns[column];
+	const unsigned char * src = reinterpret_cast< const unsigned char* >( key + _keyOffsets[column] );
+	uint32_t bits = 0;
+
+	if ( col.attrType == STRING ) {
+		memcpy (value, src, col.attrLength);
+		return;
+	}
+
+	for ( size_t i = 0; i < sizeof (bits); i++ )
+		bits = bits << 8 | src[i];
+
+	if ( col.attrType == INT )
+		bits ^= 0x80000000u;
+	else
+		bits = bits & 0x80000000u ? bits ^ 0x80000000u : ~bits;
+
+	memcpy (value, &bits, sizeof (bits));
+}
+
+inline bool CompositeKey::Covers (const std::vector<size_t> & offsets) const {
+	for ( size_t offset : offsets ) {
+		bool found = false;
+
+		for ( const KeyColumn & column : _columns )
+			found = found || column.offset == offset;
+
+		if ( !found )
+			return false;
+	}
+
+	return true;
+}
+
+/*
+	The attributes after the limited ones are filled with 0x00 where the range takes every key from the bound on
+	and with 0xFF where it stops at the bound, so an inclusive bound takes all of them and an exclusive one none
+*/
+inline void CompositeKey::Bounds (const void * const * values, size_t numEqual, const void * low, bool lowInclusive, const void * high, bool highInclusive,
+								  std::vector<char> & lowKey, std::vector<char> & highKey) const {
+	lowKey.assign (_length, 0);
+	highKey.assign (_length, 0);
+
+	for ( size_t i = 0; i < numEqual && i < _columns.size ( ); i++ ) {
+		EncodeValue (i, values[i], lowKey.data ( ));
+		EncodeValue (i, values[i], highKey.data ( ));
+	}
+
+	size_t rest = numEqual < _columns.size ( ) ? _keyOffsets[numEqual] : _length;
+
+	if ( low != nullptr && numEqual < _columns.size ( ) ) {
+		EncodeValue (numEqual, low, lowKey.data ( ));
+		rest = _keyOffsets[numEqual] + _columns[numEqual].attrLength;
+	}
+
+	memset (lowKey.data ( ) + rest, low == nullptr || lowInclusive ? 0x00 : 0xFF, _length - rest);
+
+	rest = numEqual < _columns.size ( ) ? _keyOffsets[numEqual] : _length;
+
+	if ( high != nullptr && numEqual < _columns.size ( ) ) {
+		EncodeValue (numEqual, high, highKey.data ( ));
+		rest = _keyOffsets[numEqual] + _columns[numEqual].attrLength;
+	}
+
+	memset (highKey.data ( ) + rest, high == nullptr || highInclusive ? 0xFF : 0x00, _length - rest);
+}
+
+inline RETCODE CompositeKey::Validate ( ) const {
+
+	if ( _columns.size ( ) <= _numIncluded || _columns.size ( ) > MAXCOLUMNS )
+		return RETCODE::BADATTR;
+
+	for ( const KeyColumn & column : _columns ) {
+		if ( column.attrType != INT && column.attrType != FLOAT && column.attrType != STRING )
+			return RETCODE::BADATTR;
+
+		if ( column.attrType != STRING && column.attrLength != sizeof (uint32_t) )
+			return RETCODE::BADATTR;
+	}
+
+	return RETCODE::COMPLETE;
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+/*
+	1. EntrySorter sorts the (key, rid) entries of an index by key and then by rid, CREATE INDEX fills it from the rows of the table
+	   and IndexHandle::BulkLoad builds the tree from the sorted entries
+	2. The entries are kept in memory up to memorySize bytes, a full buffer is sorted and written to a run file,
+	   Sort merges the runs through a heap and reads every run through a buffer of RUNBUFFERSIZE bytes
+	3. The run files are named by the prefix given to the constructor and removed by the destructor
+	4. A key may carry payloadLen bytes after its attrLen bytes, the INCLUDE columns of a COMPOSITE index, they are kept with the key
+	   but take no part in the order
+*/
+
+#include "Utils.hpp"
+#include "RecordIdentifier.hpp"
+#include "KeyPolicy.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EntrySorter {
+public:
+
+	const static size_t MEMORYSIZE = 64 * 1024 * 1024;
+
+	const static size_t RUNBUFFERSIZE = 256 * 1024;
+
+	EntrySorter (AttrType attrType, size_t attrLen, const std::string & runPrefix, size_t memorySize = MEMORYSIZE, size_t payloadLen = 0);
+	~EntrySorter ( );
+
+	RETCODE Add (const void * key, const RecordIdentifier & rid);
+
+	RETCODE Sort ( );								// no entry can be added after Sort
+
+	/*
+		The next entry in order, EOFSCAN after the last one
+		key points to attrLen bytes and the payload that stay valid until the next call
+	*/
+	RETCODE Next (const char *& key, RecordIdentifier & rid);
+
+	size_t numEntries ( ) const;
+
+	size_t numRuns ( ) const;
+
+private:
+
+	struct Run {
+		std::fstream stream;
+
+		std::vector<char> buffer;
+
+		size_t pos;					// the current entry in buffer
+
+		size_t end;					// the bytes of buffer read from the file
+
+		size_t left;				// the entries of the run not read from the file yet
+	};
+
+	using RunPtr = std::unique_ptr<Run>;
+
+	RETCODE writeRun ( );
+
+	RETCODE fillRun (Run & run) const;
+
+	void sortBuffer ( );
+
+	bool less (const char * a, const char * b) const;
+
+	const char * currentOf (size_t run) const;
+
+	using Compare = int (*)( const void *, const void *, size_t );
+
+	Compare _compare;
+
+	size_t _attrLen;
+
+	size_t _payloadLen;
+
+	size_t _entrySize;					// the key, the payload and then the rid
+
+	size_t _memorySize;
+
+	std::string _runPrefix;
+
+	std::vector<char> _buffer;			// the entries not written to a run
+
+	std::vector<const char*> _order;	// the entries of _buffer after sortBuffer
+
+	size_t _next;						// the next entry of _order when there is no run
+
+	std::vector<RunPtr> _runs;
+
+	std::vector<std::string> _runNames;
+
+	std::vector<size_t> _heap;			// the runs that have entries left, the smallest current entry on top
+
+	std::vector<char> _current;			// the entry returned by the last Next
+
+	size_t _numEntries;
+
+	bool _sorted;
+
+};
+
+using EntrySorterPtr = shared_ptr<EntrySorter>;
+
+EntrySorter::EntrySorter (AttrType attrType, size_t attrLen, const std::string & runPrefix, size_t memorySize, size_t payloadLen) {
+	switch ( attrType ) {
+	case INT:
+		_compare = IntKeyPolicy::Compare;
+		break;
+	case FLOAT:
+		_compare = FloatKeyPolicy::Compare;
+		break;
+	case STRING:
+		_compare = StringKeyPolicy::Compare;
+		break;
+	default:
+		_compare = BytesKeyPolicy::Compare;
+		break;
+	}
+
+	_attrLen = attrLen;
+	_payloadLen = payloadLen;
+	_entrySize = attrLen + payloadLen + sizeof (RecordIdentifier);
+	_memorySize = std::max (memorySize, _entrySize + sizeof (const char*));
+	_runPrefix = runPrefix;
+	_next = 0;
+	_numEntries = 0;
+	_sorted = false;
+	_current.resize (_entrySize);
+}
+
+EntrySorter::~EntrySorter ( ) {
+	_runs.clear ( );						// close the streams before the files are removed
+
+	for ( const std::string & name : _runNames )
+		std::remove (name.c_str ( ));
+}
+
+inline RETCODE EntrySorter::Add (const void * key, const RecordIdentifier & rid) {
+	RETCODE result;
+
+	if ( _sorted )
+		return RETCODE::INVALIDSCAN;
+
+	if ( key == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( ( _buffer.size ( ) / _entrySize + 1 ) * ( _entrySize + sizeof (const char*) ) > _memorySize && ( result = writeRun ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	_buffer.insert (_buffer.end ( ), reinterpret_cast< const char* >( key ), reinterpret_cast< const char* >( key ) + _attrLen + _payloadLen);
+	_buffer.insert (_buffer.end ( ), reinterpret_cast< const char* >( &rid ), reinterpret_cast< const char* >( &rid ) + sizeof (RecordIdentifier));
+	_numEntries++;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Entries that all fit in memory are returned from the sorted buffer without a run file,
+	otherwise the last buffer becomes a run too and the runs are merged
+*/
+inline RETCODE EntrySorter::Sort ( ) {
+	RETCODE result;
+
+	if ( _sorted )
+		return RETCODE::INVALIDSCAN;
+
+	_sorted = true;
+
+	if ( _runs.empty ( ) ) {
+		sortBuffer ( );
+		return RETCODE::COMPLETE;
+	}
+
+	if ( !_buffer.empty ( ) && ( result = writeRun ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( size_t i = 0; i < _runs.size ( ); i++ ) {
+		Run & run = *_runs[i];
+
+		run.stream.seekg (0);
+		run.buffer.resize (std::max (RUNBUFFERSIZE / _entrySize, static_cast< size_t >( 1 )) * _entrySize);
+
+		if ( result = fillRun (run) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( run.end > 0 )
+			_heap.push_back (i);
+	}
+
+	auto greater = [this] (size_t a, size_t b) { return less (currentOf (b), currentOf (a)); };
+
+	std::make_heap (_heap.begin ( ), _heap.end ( ), greater);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE EntrySorter::Next (const char *& key, RecordIdentifier & rid) {
+	RETCODE result;
+
+	if ( !_sorted )
+		return RETCODE::INVALIDSCAN;
+
+	if ( _runs.empty ( ) ) {
+		if ( _next >= _order.size ( ) )
+			return RETCODE::EOFSCAN;
+
+		memcpy (_current.data ( ), _order[_next++], _entrySize);
+	} else {
+		if ( _heap.empty ( ) )
+			return RETCODE::EOFSCAN;
+
+		auto greater = [this] (size_t a, size_t b) { return less (currentOf (b), currentOf (a)); };
+
+		std::pop_heap (_heap.begin ( ), _heap.end ( ), greater);
+
+		Run & run = *_runs[_heap.back ( )];
+
+		memcpy (_current.data ( ), run.buffer.data ( ) + run.pos, _entrySize);
+		run.pos += _entrySize;
+
+		if ( run.pos >= run.end && ( result = fillRun (run) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( run.end > 0 )
+			std::push_heap (_heap.begin ( ), _heap.end ( ), greater);
+		else
+			_heap.pop_back ( );
+	}
+
+	key = _current.data ( );
+	memcpy (reinterpret_cast< char* >( &rid ), _current.data ( ) + _attrLen + _payloadLen, sizeof (RecordIdentifier));
+
+	return RETCODE::COMPLETE;
+}
+
+inline size_t EntrySorter::numEntries ( ) const {
+	return _numEntries;
+}
+
+inline size_t EntrySorter::numRuns ( ) const {
+	return _runs.size ( );
+}
+
+inline RETCODE EntrySorter::writeRun ( ) {
+	RunPtr run (new Run);
+	std::string name = _runPrefix + ".run" + std::to_string (_runs.size ( ));
+
+	sortBuffer ( );
+
+	run->stream.open (name, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	_runNames.push_back (name);
+
+	if ( !run->stream.is_open ( ) )
+		return RETCODE::CREATEFAILED;
+
+	for ( const char * entry : _order )
+		run->stream.write (entry, _entrySize);
+
+	if ( !run->stream.good ( ) )
+		return RETCODE::INCOMPLETEWRITE;
+
+	run->pos = run->end = 0;
+	run->left = _order.size ( );
+
+	_runs.push_back (std::move (run));
+	_buffer.clear ( );
+	_order.clear ( );
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Read the next entries of the run into its buffer, end is 0 when the run has no entry left
+*/
+inline RETCODE EntrySorter::fillRun (Run & run) const {
+	size_t count = std::min (run.left, run.buffer.size ( ) / _entrySize);
+
+	run.pos = 0;
+	run.end = count * _entrySize;
+	run.left -= count;
+
+	if ( count > 0 && !run.stream.read (run.buffer.data ( ), run.end) )
+		return RETCODE::INCOMPLETEREAD;
+
+	return RETCODE::COMPLETE;
+}
+
+inline void EntrySorter::sortBuffer ( ) {
+	_order.resize (_buffer.size ( ) / _entrySize);
+	_next = 0;
+
+	for ( size_t i = 0; i < _order.size ( ); i++ )
+		_order[i] = _buffer.data ( ) + i * _entrySize;
+
+	std::sort (_order.begin ( ), _order.end ( ), [this] (const char * a, const char * b) { return less (a, b); });
+}
+
+inline bool EntrySorter::less (const char * a, const char * b) const {
+	int comp = _compare (a, b, _attrLen);
+
+	if ( comp != 0 )
+		return comp < 0;
+
+	RecordIdentifier ridA, ridB;
+	PageNum pageA, pageB;
+	SlotNum slotA, slotB;
+
+	memcpy (reinterpret_cast< char* >( &ridA ), a + _attrLen + _payloadLen, sizeof (RecordIdentifier));
+	memcpy (reinterpret_cast< char* >( &ridB ), b + _attrLen + _payloadLen, sizeof (RecordIdentifier));
+	ridA.GetPageNum (pageA);
+	ridB.GetPageNum (pageB);
+	ridA.GetSlotNum (slotA);
+	ridB.GetSlotNum (slotB);
+
+	return pageA != pageB ? pageA < pageB : slotA < slotB;
+}
+
+inline const char * EntrySorter::currentOf (size_t run) const {
+	return _runs[run]->buffer.data ( ) + _runs[run]->pos;
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+/*
+	1. FreeSpaceMap keeps one byte per data page of a RecordFile telling how full the page is, 0 means full
+	2. The map is stored in its own page file "<file>.fsm", page 1 is FreeSpaceMapHeader,
+	   map page 2 + n / PAGESIZE holds the byte of data page n
+	3. The map is only a hint, the RecordFile always checks the page header of the page it picked
+	4. FindPage keeps a next-fit cursor per thread slot and returns the cursor page while it has room, so a lookup is O(1)
+	   until the page fills, and the cursor then moves on past the full pages once
+	5. FindPage skips the page another cursor is on, so concurrent inserters work on different pages
+*/
+
+#include "Utils.hpp"
+#include "BufferManager.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FreeSpaceMapHeader {				// stored in page 1 of every free space map file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL FreeSpaceMap"
+	PageNum numMapPages;
+
+	FreeSpaceMapHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::FREESPACEMAPIDENTIFYSTRING);
+		numMapPages = 0;
+	}
+};
+
+class FreeSpaceMap {
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static PageNum FIRSTMAPPAGE = 2;
+
+	const static size_t PAGESPERMAPPAGE = Utils::PAGESIZE;
+
+	const static unsigned char FULL = 0;
+
+	const static size_t NUMCURSORS = 16;
+
+	FreeSpaceMap ( );
+	~FreeSpaceMap ( );
+
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE Create (const BufferManagerPtr & ptr);						// write the header page of a new map file
+
+	RETCODE Set (PageNum page, unsigned char category, bool claim = false);		// record the fullness of a data page, claim moves the caller's cursor to it
+
+	RETCODE Get (PageNum page, unsigned char & category) const;
+
+	RETCODE FindPage (unsigned char minCategory, PageNum & page);		// find a data page whose category >= minCategory
+
+	RETCODE Flush ( );
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	/*
+		Static Functions
+	*/
+	static std::string FileName (const char * fileName);
+
+	static unsigned char Category (size_t freeSlots, size_t numSlots);		// 1 ~ 255 for a page with free slots
+
+private:
+
+	RETCODE writeCategory (PageNum page, unsigned char category);
+
+	RETCODE saveHeader ( );
+
+	size_t & cursor ( );								// the cursor of the calling thread
+
+	bool isClaimed (size_t page, const size_t & own) const;		// the page is the cursor page of another thread
+
+	FreeSpaceMapHeader header;
+
+	std::vector<unsigned char> _categories;			// copy of the map
+
+	std::vector<size_t> _freePages;					// number of non-full pages covered by every map page
+
+	size_t _totalFree;
+
+	size_t _cursors[NUMCURSORS];					// page last returned to every thread slot, 0 for none
+
+	mutable std::mutex _mutex;
+
+	BufferManagerPtr bufMgr;
+
+};
+
+using FreeSpaceMapPtr = shared_ptr<FreeSpaceMap>;
+
+FreeSpaceMap::FreeSpaceMap ( ) {
+	bufMgr = nullptr;
+	_totalFree = 0;
+	std::fill (_cursors, _cursors + NUMCURSORS, 0);
+}
+
+FreeSpaceMap::~FreeSpaceMap ( ) {
+	if ( bufMgr != nullptr )
+		Flush ( );
+}
+
+inline RETCODE FreeSpaceMap::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	PagePtr page;
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (FreeSpaceMapHeader), pData, sizeof (FreeSpaceMapHeader));
+
+	if ( strcmp (header.identifyString, Utils::FREESPACEMAPIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDPAGEFILE;
+
+	for ( PageNum mapPage = FIRSTMAPPAGE; mapPage < FIRSTMAPPAGE + header.numMapPages; mapPage++ ) {
+
+		if ( ( result = bufMgr->GetPage (mapPage, page) ) || ( result = bufMgr->UnlockPage (mapPage) )
+			 || ( result = page->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_categories.insert (_categories.end ( ), pData, pData + PAGESPERMAPPAGE);
+		_freePages.push_back (PAGESPERMAPPAGE - std::count (pData, pData + PAGESPERMAPPAGE, static_cast< char >( FULL )));
+		_totalFree += _freePages.back ( );
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE FreeSpaceMap::Create (const BufferManagerPtr & ptr) {
+	RETCODE result;
+	PagePtr page;
+	PageNum pageNum;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( ( result = bufMgr->AllocatePage (page) ) || ( result = page->GetPageNum (pageNum) )
+		 || ( result = bufMgr->UnlockPage (pageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return saveHeader ( );
+}
+
+inline RETCODE FreeSpaceMap::Set (PageNum page, unsigned char category, bool claim) {
+	std::lock_guard<std::mutex> guard (_mutex);
+	RETCODE result;
+
+	while ( page >= _categories.size ( ) ) {		// the map grows with the data file
+		PagePtr mapPage;
+		PageNum mapPageNum;
+
+		if ( ( result = bufMgr->AllocatePage (mapPage) ) || ( result = mapPage->GetPageNum (mapPageNum) )
+			 || ( result = bufMgr->UnlockPage (mapPageNum) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_categories.resize (_categories.size ( ) + PAGESPERMAPPAGE, static_cast< unsigned char >( FULL ));
+		_freePages.push_back (0);
+		header.numMapPages++;
+
+		if ( result = saveHeader ( ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	if ( claim )
+		cursor ( ) = page;
+
+	unsigned char old = _categories[page];
+
+	if ( old == category )
+		return RETCODE::COMPLETE;
+
+	if ( old == FULL ) {
+		_freePages[page / PAGESPERMAPPAGE]++;
+		_totalFree++;
+	} else if ( category == FULL ) {
+		_freePages[page / PAGESPERMAPPAGE]--;
+		_totalFree--;
+	}
+
+	_categories[page] = category;
+
+	return writeCategory (page, category);
+}
+
+inline RETCODE FreeSpaceMap::Get (PageNum page, unsigned char & category) const {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	category = page < _categories.size ( ) ? _categories[page] : static_cast< unsigned char >( FULL );
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Next fit from the cursor of the calling thread, the map pages without free pages are skipped
+	and the search gives up at once when every free page is the cursor page of another thread
+*/
+inline RETCODE FreeSpaceMap::FindPage (unsigned char minCategory, PageNum & page) {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	if ( _categories.empty ( ) || minCategory == FULL )
+		return RETCODE::PAGENUMNOTFOUND;
+
+	size_t & own = cursor ( );
+	size_t claimed = 0;
+
+	for ( size_t i = 0; i < NUMCURSORS; i++ ) {
+		if ( &_cursors[i] != &own && _cursors[i] < _categories.size ( ) && _categories[_cursors[i]] != FULL
+			 && std::find (_cursors, _cursors + i, _cursors[i]) == _cursors + i )
+			claimed++;
+	}
+
+	if ( _totalFree <= claimed )
+		return RETCODE::PAGENUMNOTFOUND;
+
+	size_t numPages = _categories.size ( );
+	size_t p = own < numPages ? own : 0;
+
+	for ( size_t visited = 0; visited < numPages; ) {
+		size_t mapPage = p / PAGESPERMAPPAGE;
+
+		if ( _freePages[mapPage] == 0 ) {			// jump to the next map page
+			size_t next = ( mapPage + 1 ) * PAGESPERMAPPAGE;
+			visited += next - p;
+			p = next < numPages ? next : 0;
+			continue;
+		}
+
+		if ( _categories[p] >= minCategory && !isClaimed (p, own) ) {
+			own = p;
+			page = static_cast< PageNum >( p );
+			return RETCODE::COMPLETE;
+		}
+
+		visited++;
+		p = p + 1 < numPages ? p + 1 : 0;
+	}
+
+	return RETCODE::PAGENUMNOTFOUND;
+}
+
+inline RETCODE FreeSpaceMap::Flush ( ) {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	return bufMgr->FlushPages ( );
+}
+
+inline RETCODE FreeSpaceMap::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline std::string FreeSpaceMap::FileName (const char * fileName) {
+	return std::string (fileName) + ".fsm";
+}
+
+inline unsigned char FreeSpaceMap::Category (size_t freeSlots, size_t numSlots) {
+	if ( freeSlots == 0 || numSlots == 0 )
+		return FULL;
+
+	return static_cast< unsigned char >( 1 + ( freeSlots - 1 ) * 254 / numSlots );
+}
+
+/*
+	The map page stays in the buffer and is written when the map is flushed
+*/
+inline RETCODE FreeSpaceMap::writeCategory (PageNum page, unsigned char category) {
+	RETCODE result;
+	PagePtr mapPage;
+	PageNum mapPageNum = FIRSTMAPPAGE + page / PAGESPERMAPPAGE;
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (mapPageNum, mapPage) ) || ( result = bufMgr->UnlockPage (mapPageNum) )
+		 || ( result = mapPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	pData[page % PAGESPERMAPPAGE] = static_cast< char >( category );
+
+	return bufMgr->MarkDirty (mapPageNum);
+}
+
+inline size_t & FreeSpaceMap::cursor ( ) {
+	return _cursors[std::hash<std::thread::id> ( ) ( std::this_thread::get_id ( ) ) % NUMCURSORS];
+}
+
+inline bool FreeSpaceMap::isClaimed (size_t page, const size_t & own) const {
+	for ( const size_t & other : _cursors ) {
+		if ( &other != &own && other == page )
+			return true;
+	}
+
+	return false;
+}
+
+inline RETCODE FreeSpaceMap::saveHeader ( ) {
+	RETCODE result;
+	PagePtr page;
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (FreeSpaceMapHeader), reinterpret_cast< const void* >( &header ), sizeof (FreeSpaceMapHeader));
+
+	return bufMgr->ForcePage (HEADERPAGE);
+}
@@ -0,0 +1,627 @@
+#pragma once
+
+/*
+	1. HashIndexHandle is a linear hashing index, it answers only equality and a lookup reads the pages of one bucket
+	2. Page 1 is HashIndexHeader, the first pages of the buckets are listed in directory pages that are read when the index is opened,
+	   a directory page starts with the next directory page
+	3. A bucket page holds HashBucketHeader and then the entries (key, rid), a full bucket links an overflow page
+	4. Bucket b holds the keys whose hash is b modulo 2^level, the buckets before split already use level + 1 bits.
+	   When the entries pass LOADFACTOR of what the buckets hold without overflow, the bucket at split is divided
+	   between itself and a new bucket split + 2^level
+	5. Entries are not kept in order, a delete moves the last entry of the page into its place, empty overflow pages stay in the chain
+*/
+
+#include "Utils.hpp"
+#include "BufferManager.hpp"
+#include "RecordIdentifier.hpp"
+#include "KeyPolicy.hpp"
+
+#include <vector>
+
+struct HashIndexHeader {				// page 1 of every hash index
+
+	char identifyString[Utils::IDENTIFYSTRINGLEN];		// "MicroSQL HashIndex"
+
+	AttrType attrType;
+
+	size_t attrLength;
+
+	size_t numPages;
+
+	size_t numEntries;
+
+	size_t level;				// bucket 0 to 2^level - 1 take level bits of the hash
+
+	size_t split;				// the next bucket to split, the buckets before it take level + 1 bits
+
+	PageNum dirPage;			// the first directory page, none until the index is opened first
+
+	HashIndexHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::HASHINDEXIDENTIFYSTRING);
+		attrLength = numPages = numEntries = level = split = 0;
+		dirPage = Utils::UNKNOWNPAGENUM;
+	}
+
+};
+
+struct HashBucketHeader {				// at the start of every bucket and overflow page
+
+	PageNum overflow;
+
+	size_t numEntries;
+
+};
+
+class HashIndexHandle {
+
+	friend class HashIndexScan;
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static size_t DIRENTRIES = ( Utils::PAGESIZE - sizeof (PageNum) ) / sizeof (PageNum);		// buckets listed by one directory page
+
+	static constexpr double LOADFACTOR = 0.75;
+
+	HashIndexHandle ( );
+	~HashIndexHandle ( );
+
+	RETCODE Open (BufferManagerPtr buf);
+
+	RETCODE InsertEntry (void * pData, const RecordIdentifier & rid);		// ENTRYEXISTS if the index has the key with rid
+
+	RETCODE DeleteEntry (void * pData, const RecordIdentifier & rid);
+
+	RETCODE ForcePages ( );
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	AttrType attrType ( ) const;
+
+	size_t attrLen ( ) const;
+
+	size_t numEntries ( ) const;
+
+	size_t numBuckets ( ) const;
+
+	bool IsValid ( ) const;
+
+	/*
+		Static Functions
+	*/
+	static size_t BucketCapacity (size_t attrLen);		// the entries of a bucket page
+
+private:
+
+	RETCODE readHeader ( );
+
+	RETCODE saveHeader ( ) const;
+
+	RETCODE readDirectory ( );
+
+	RETCODE pageData (PageNum page, char *& pData) const;
+
+	RETCODE allocate (PageNum & page, char *& pData);		// a new bucket page without entries
+
+	RETCODE addBucket (PageNum page);
+
+	RETCODE splitBucket ( );
+
+	RETCODE append (PageNum first, const void * key, const RecordIdentifier & rid);		// into the first page of the chain with room
+
+	RETCODE findEntry (PageNum first, void * key, const RecordIdentifier & rid, PageNum & page, size_t & pos) const;
+
+	size_t bucketOf (void * key) const;
+
+	char * entryAt (char * pData, size_t pos) const;
+
+	RecordIdentifier ridAt (const char * pData, size_t pos) const;
+
+	bool equal (const void * a, const void * b) const;
+
+	static unsigned long long hashOf (const void * key, AttrType attrType, size_t attrLength);
+
+	using Compare = int (*)( const void *, const void *, size_t );
+
+	Compare _compare;
+
+	std::vector<PageNum> _buckets;			// the first page of every bucket
+
+	std::vector<PageNum> _dirPages;
+
+	HashIndexHeader header;
+
+	BufferManagerPtr bufMgr;
+
+	mutable bool headerModified;
+
+};
+
+using HashIndexHandlePtr = shared_ptr<HashIndexHandle>;
+
+HashIndexHandle::HashIndexHandle ( ) {
+	_compare = nullptr;
+	bufMgr = nullptr;
+	headerModified = false;
+}
+
+HashIndexHandle::~HashIndexHandle ( ) {
+	RETCODE result;
+
+	if ( headerModified && bufMgr != nullptr ) {
+
+		if ( result = saveHeader ( ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		}
+
+	}
+}
+
+/*
+	An index opened the first time gets its directory and bucket 0
+*/
+inline RETCODE HashIndexHandle::Open (BufferManagerPtr buf) {
+	RETCODE result;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( buf == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = buf;
+
+	if ( result = readHeader ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	switch ( header.attrType ) {
+	case INT:
+		_compare = IntKeyPolicy::Compare;
+		break;
+	case FLOAT:
+		_compare = FloatKeyPolicy::Compare;
+		break;
+	default:
+		_compare = StringKeyPolicy::Compare;
+		break;
+	}
+
+	if ( header.dirPage != Utils::UNKNOWNPAGENUM )
+		return readDirectory ( );
+
+	PageNum page;
+	char * pData;
+
+	if ( ( result = allocate (page, pData) ) || ( result = addBucket (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::InsertEntry (void * pData, const RecordIdentifier & rid) {
+	RETCODE result;
+	PageNum page;
+	size_t pos;
+
+	if ( pData == nullptr )
+		return RETCODE::BADKEY;
+
+	PageNum first = _buckets[bucketOf (pData)];
+
+	if ( ( result = findEntry (first, pData, rid, page, pos) ) != RETCODE::KEYNOTFOUND )
+		return result == RETCODE::COMPLETE ? RETCODE::ENTRYEXISTS : result;
+
+	if ( result = append (first, pData, rid) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.numEntries++;
+	headerModified = true;
+
+	if ( header.numEntries > LOADFACTOR * _buckets.size ( ) * BucketCapacity (attrLen ( )) && ( result = splitBucket ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The last entry of the page fills the place of the deleted one
+*/
+inline RETCODE HashIndexHandle::DeleteEntry (void * pData, const RecordIdentifier & rid) {
+	RETCODE result;
+	PageNum page;
+	size_t pos;
+	char * data;
+
+	if ( pData == nullptr )
+		return RETCODE::BADKEY;
+
+	if ( result = findEntry (_buckets[bucketOf (pData)], pData, rid, page, pos) )
+		return result;
+
+	if ( result = pageData (page, data) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	HashBucketHeader * bucket = reinterpret_cast< HashBucketHeader* >( data );
+	size_t entrySize = attrLen ( ) + sizeof (RecordIdentifier);
+
+	bucket->numEntries--;
+	memmove (entryAt (data, pos), entryAt (data, bucket->numEntries), entrySize);
+
+	if ( result = bufMgr->MarkDirty (page) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.numEntries--;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::ForcePages ( ) {
+	RETCODE result;
+
+	if ( ( result = saveHeader ( ) ) || ( result = bufMgr->FlushPages ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline AttrType HashIndexHandle::attrType ( ) const {
+	return header.attrType;
+}
+
+inline size_t HashIndexHandle::attrLen ( ) const {
+	return header.attrLength;
+}
+
+inline size_t HashIndexHandle::numEntries ( ) const {
+	return header.numEntries;
+}
+
+inline size_t HashIndexHandle::numBuckets ( ) const {
+	return _buckets.size ( );
+}
+
+inline bool HashIndexHandle::IsValid ( ) const {
+	return strcmp (header.identifyString, Utils::HASHINDEXIDENTIFYSTRING) == 0;
+}
+
+inline size_t HashIndexHandle::BucketCapacity (size_t attrLen) {
+	return ( Utils::PAGESIZE - sizeof (HashBucketHeader) ) / ( attrLen + sizeof (RecordIdentifier) );
+}
+
+inline RETCODE HashIndexHandle::readHeader ( ) {
+	RETCODE result;
+	char * pData;
+
+	if ( result = pageData (HEADERPAGE, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (HashIndexHeader), pData, sizeof (HashIndexHeader));
+
+	if ( !IsValid ( ) ) {
+		Utils::PrintRetcode (RETCODE::INVALIDINDEX, __FUNCTION__, __LINE__);
+		return RETCODE::INVALIDINDEX;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::saveHeader ( ) const {
+	RETCODE result;
+	char * pData;
+
+	if ( result = pageData (HEADERPAGE, pData) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (HashIndexHeader), reinterpret_cast< const void* >( &header ), sizeof (HashIndexHeader));
+
+	if ( result = bufMgr->ForcePage (HEADERPAGE) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	There are 2^level + split buckets
+*/
+inline RETCODE HashIndexHandle::readDirectory ( ) {
+	RETCODE result;
+	size_t count = ( static_cast< size_t >( 1 ) << header.level ) + header.split;
+	PageNum dirPage = header.dirPage;
+	char * pData;
+
+	while ( _buckets.size ( ) < count ) {
+		if ( dirPage == Utils::UNKNOWNPAGENUM ) {
+			Utils::PrintRetcode (RETCODE::INVALIDINDEX, __FUNCTION__, __LINE__);
+			return RETCODE::INVALIDINDEX;
+		}
+
+		if ( result = pageData (dirPage, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		const PageNum * pages = reinterpret_cast< const PageNum* >( pData );
+		size_t n = std::min (count - _buckets.size ( ), DIRENTRIES);
+
+		_dirPages.push_back (dirPage);
+		_buckets.insert (_buckets.end ( ), pages + 1, pages + 1 + n);
+		dirPage = pages[0];
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::pageData (PageNum page, char *& pData) const {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) ) || ( result = pagePtr->GetData (pData) ) )
+		return result;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexHandle::allocate (PageNum & page, char *& pData) {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	if ( ( result = bufMgr->AllocatePage (pagePtr) ) || ( result = pagePtr->GetPageNum (page) ) || ( result = bufMgr->UnlockPage (page) )
+		 || ( result = pagePtr->GetData (pData) ) || ( result = bufMgr->MarkDirty (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	HashBucketHeader * bucket = reinterpret_cast< HashBucketHeader* >( pData );
+
+	bucket->overflow = Utils::UNKNOWNPAGENUM;
+	bucket->numEntries = 0;
+
+	header.numPages++;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	page becomes the next bucket, a full directory page links a new one
+*/
+inline RETCODE HashIndexHandle::addBucket (PageNum page) {
+	RETCODE result;
+	size_t slot = _buckets.size ( ) % DIRENTRIES;
+	char * pData;
+
+	if ( slot == 0 ) {
+		PageNum dirPage;
+
+		if ( result = allocate (dirPage, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		reinterpret_cast< PageNum* >( pData )[0] = Utils::UNKNOWNPAGENUM;
+
+		if ( _dirPages.empty ( ) ) {
+			header.dirPage = dirPage;
+		} else if ( ( result = pageData (_dirPages.back ( ), pData) ) == RETCODE::COMPLETE ) {
+			reinterpret_cast< PageNum* >( pData )[0] = dirPage;
+			result = bufMgr->MarkDirty (_dirPages.back ( ));
+		}
+
+		if ( result ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_dirPages.push_back (dirPage);
+	}
+
+	if ( ( result = pageData (_dirPages.back ( ), pData) ) || ( result = bufMgr->MarkDirty (_dirPages.back ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	reinterpret_cast< PageNum* >( pData )[1 + slot] = page;
+	_buckets.push_back (page);
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The entries of the bucket at split are taken out of its pages and appended again with one more bit of their hash,
+	they stay in the bucket or go to the new one. The pages of the bucket are kept for the entries that stay
+*/
+inline RETCODE HashIndexHandle::splitBucket ( ) {
+	RETCODE result;
+	size_t entrySize = attrLen ( ) + sizeof (RecordIdentifier);
+	std::vector<char> entries;
+	PageNum page;
+	char * pData;
+
+	if ( ( result = allocate (page, pData) ) || ( result = addBucket (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( page = _buckets[header.split]; page != Utils::UNKNOWNPAGENUM; page = reinterpret_cast< HashBucketHeader* >( pData )->overflow ) {
+		if ( ( result = pageData (page, pData) ) || ( result = bufMgr->MarkDirty (page) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		HashBucketHeader * bucket = reinterpret_cast< HashBucketHeader* >( pData );
+
+		entries.insert (entries.end ( ), entryAt (pData, 0), entryAt (pData, bucket->numEntries));
+		bucket->numEntries = 0;
+	}
+
+	if ( ++header.split == static_cast< size_t >( 1 ) << header.level ) {
+		header.level++;
+		header.split = 0;
+	}
+
+	for ( size_t i = 0; i < entries.size ( ); i += entrySize ) {
+		char * key = entries.data ( ) + i;
+		RecordIdentifier rid;
+
+		memcpy (reinterpret_cast< char* >( &rid ), key + attrLen ( ), sizeof (RecordIdentifier));
+
+		if ( result = append (_buckets[bucketOf (key)], key, rid) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	A chain whose pages are all full gets a new overflow page at its end
+*/
+inline RETCODE HashIndexHandle::append (PageNum first, const void * key, const RecordIdentifier & rid) {
+	RETCODE result;
+	PageNum page = first;
+	char * pData;
+
+	for ( ;; ) {
+		if ( result = pageData (page, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		HashBucketHeader * bucket = reinterpret_cast< HashBucketHeader* >( pData );
+
+		if ( bucket->numEntries < BucketCapacity (attrLen ( )) )
+			break;
+
+		if ( bucket->overflow == Utils::UNKNOWNPAGENUM ) {
+			PageNum overflow;
+
+			if ( ( result = bufMgr->MarkDirty (page) ) || ( result = allocate (overflow, pData) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			bucket->overflow = overflow;
+			page = overflow;
+			break;
+		}
+
+		page = bucket->overflow;
+	}
+
+	HashBucketHeader * bucket = reinterpret_cast< HashBucketHeader* >( pData );
+	char * entry = entryAt (pData, bucket->numEntries++);
+
+	memcpy (entry, key, attrLen ( ));
+	memcpy (entry + attrLen ( ), reinterpret_cast< const char* >( &rid ), sizeof (RecordIdentifier));
+
+	return bufMgr->MarkDirty (page);
+}
+
+/*
+	The page and the position of the entry of key with rid in the chain, KEYNOTFOUND if the chain has none
+*/
+inline RETCODE HashIndexHandle::findEntry (PageNum first, void * key, const RecordIdentifier & rid, PageNum & page, size_t & pos) const {
+	RETCODE result;
+	char * pData;
+
+	for ( page = first; page != Utils::UNKNOWNPAGENUM; page = reinterpret_cast< HashBucketHeader* >( pData )->overflow ) {
+		if ( result = pageData (page, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		for ( pos = 0; pos < reinterpret_cast< HashBucketHeader* >( pData )->numEntries; pos++ ) {
+			if ( equal (entryAt (pData, pos), key) && ridAt (pData, pos) == rid )
+				return RETCODE::COMPLETE;
+		}
+	}
+
+	return RETCODE::KEYNOTFOUND;
+}
+
+inline size_t HashIndexHandle::bucketOf (void * key) const {
+	unsigned long long hash = hashOf (key, attrType ( ), attrLen ( ));
+	size_t bucket = hash & ( ( static_cast< size_t >( 1 ) << header.level ) - 1 );
+
+	if ( bucket < header.split )
+		bucket = hash & ( ( static_cast< size_t >( 1 ) << ( header.level + 1 ) ) - 1 );
+
+	return bucket;
+}
+
+inline char * HashIndexHandle::entryAt (char * pData, size_t pos) const {
+	return pData + sizeof (HashBucketHeader) + pos * ( attrLen ( ) + sizeof (RecordIdentifier) );
+}
+
+inline RecordIdentifier HashIndexHandle::ridAt (const char * pData, size_t pos) const {
+	RecordIdentifier rid;
+
+	memcpy (reinterpret_cast< char* >( &rid ), entryAt (const_cast< char* >( pData ), pos) + attrLen ( ), sizeof (RecordIdentifier));
+
+	return rid;
+}
+
+inline bool HashIndexHandle::equal (const void * a, const void * b) const {
+	return _compare (a, b, attrLen ( )) == 0;
+}
+
+/*
+	Keys that compare equal must have the same hash: a STRING ends at its first '\0' and 0.0f and -0.0f are the same FLOAT.
+	The buckets take the low bits, so the FNV-1a hash is mixed until every bit depends on every byte
+*/
+inline unsigned long long HashIndexHandle::hashOf (const void * key, AttrType attrType, size_t attrLength) {
+	const unsigned char * bytes = reinterpret_cast< const unsigned char* >( key );
+	size_t length = attrLength;
+	float zero = 0.0f;
+
+	if ( attrType == STRING )
+		length = strnlen (reinterpret_cast< const char* >( key ), attrLength);
+	else if ( attrType == FLOAT && *reinterpret_cast< const float* >( key ) == 0.0f )
+		bytes = reinterpret_cast< const unsigned char* >( &zero );
+
+	unsigned long long h = 14695981039346656037ULL;
+
+	for ( size_t i = 0; i < length; i++ ) {
+		h ^= bytes[i];
+		h *= 1099511628211ULL;
+	}
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
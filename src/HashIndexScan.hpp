@@ -0,0 +1,164 @@
+#pragma once
+
+/*
+	1. HashIndexScan returns the rids of the entries equal to one value, only EQ_OP can be answered by a hash index
+	2. It reads the pages of the bucket of the value one at a time and copies the matching rids of a page when the scan reaches it
+*/
+
+#include "Utils.hpp"
+#include "HashIndexHandle.hpp"
+#include "RecordIdentifier.hpp"
+
+#include <vector>
+
+class HashIndexScan {
+public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	HashIndexScan ( );
+	~HashIndexScan ( );
+
+	RETCODE OpenScan (const HashIndexHandlePtr & indexHandle, CompOp compOp, void * value);		// BADOP unless compOp is EQ_OP
+
+	RETCODE GetNextEntry (RecordIdentifier & rid);
+
+	RETCODE GetNextEntries (RecordIdentifier * rids, size_t max, size_t & n);	// Get up to max entries, EOFSCAN if none is left
+
+	RETCODE CloseScan ( );
+
+private:
+
+	RETCODE readPage ( );
+
+	HashIndexHandlePtr _index;
+
+	std::vector<char> _key;
+
+	PageNum _nextPage;
+
+	std::vector<RecordIdentifier> _rids;	// the matching entries of the current page
+
+	size_t _pos;
+
+	ScanState _state;
+
+};
+
+HashIndexScan::HashIndexScan ( ) {
+	_state = ScanState::Close;
+	_index = nullptr;
+	_pos = 0;
+}
+
+HashIndexScan::~HashIndexScan ( ) {
+}
+
+/*
+	A STRING value may be shorter than the attribute, it is copied up to its '\0'
+*/
+inline RETCODE HashIndexScan::OpenScan (const HashIndexHandlePtr & indexHandle, CompOp compOp, void * value) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( indexHandle == nullptr || !indexHandle->IsValid ( ) )
+		return RETCODE::INVALIDINDEX;
+
+	if ( compOp != EQ_OP || value == nullptr )
+		return RETCODE::BADOP;
+
+	const char * chars = reinterpret_cast< const char* >( value );
+	size_t length = indexHandle->attrType ( ) == STRING ? strnlen (chars, indexHandle->attrLen ( )) : indexHandle->attrLen ( );
+
+	_index = indexHandle;
+	_key.assign (_index->attrLen ( ), 0);
+	memcpy (_key.data ( ), chars, length);
+	_nextPage = _index->_buckets[_index->bucketOf (_key.data ( ))];
+	_rids.clear ( );
+	_pos = 0;
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE HashIndexScan::GetNextEntry (RecordIdentifier & rid) {
+	size_t n;
+
+	return GetNextEntries (&rid, 1, n);
+}
+
+inline RETCODE HashIndexScan::GetNextEntries (RecordIdentifier * rids, size_t max, size_t & n) {
+	RETCODE result;
+
+	n = 0;
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open || rids == nullptr )
+		return RETCODE::INVALIDSCAN;
+
+	while ( n < max ) {
+		if ( _pos == _rids.size ( ) ) {
+			result = readPage ( );
+
+			if ( result == RETCODE::EOFSCAN )
+				break;
+
+			if ( result ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+		}
+
+		size_t count = std::min (max - n, _rids.size ( ) - _pos);
+
+		std::copy (_rids.begin ( ) + _pos, _rids.begin ( ) + _pos + count, rids + n);
+		_pos += count;
+		n += count;
+	}
+
+	return n > 0 ? RETCODE::COMPLETE : RETCODE::EOFSCAN;
+}
+
+inline RETCODE HashIndexScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_index = nullptr;
+	_rids.clear ( );
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Copy the matching entries of the next pages of the bucket until one page has any
+*/
+inline RETCODE HashIndexScan::readPage ( ) {
+	RETCODE result;
+	char * pData;
+
+	_rids.clear ( );
+	_pos = 0;
+
+	while ( _rids.empty ( ) ) {
+		if ( _nextPage == Utils::UNKNOWNPAGENUM ) {
+			_state = End;
+			return RETCODE::EOFSCAN;
+		}
+
+		if ( result = _index->pageData (_nextPage, pData) )
+			return result;
+
+		const HashBucketHeader * bucket = reinterpret_cast< const HashBucketHeader* >( pData );
+
+		for ( size_t i = 0; i < bucket->numEntries; i++ ) {
+			if ( _index->equal (_index->entryAt (pData, i), _key.data ( )) )
+				_rids.push_back (_index->ridAt (pData, i));
+		}
+
+		_nextPage = bucket->overflow;
+	}
+
+	return RETCODE::COMPLETE;
+}
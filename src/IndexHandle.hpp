@@ -8,19 +8,41 @@
 	5. Ҷڵڲ㶼ͳһһstruct
 	6. RootPagePageNumһ2, IndexHandleHeader
 	7. ͨReadHeaderȡļеHeaderϢ, ͨSaveHeaderѵǰڴеHeader浽ļ
+	8. Child i of an internal node holds the keys not less than key i, key 0 of the first node of a level is the smallest key of the type
+	9. Deletes do not merge nodes, an empty leaf stays in the chain
+	10. BulkLoad builds the tree of an empty index from sorted entries, the nodes of every level are filled from left to right
+	11. Operations run in parallel by optimistic lock coupling, every node has a version that a writer makes odd while it holds the node.
+	    Readers take no lock and go down again when a node they read changed, an insert or delete locks its leaf,
+	    a split locks the path from the root and one split runs at a time
+	12. The header of a COMPOSITE index keeps its attributes, the keys are the bytes CompositeKey encodes and compare with memcmp.
+	    The values of the INCLUDE attributes are the payload of the leaf entries, attrLength only covers the key attributes,
+	    so they are never compared and never go into a separator, and a leaf holds every attribute an index-only scan returns
+	13. A key not less than largestKey belongs to the last leaf, the insert goes straight to lastLeaf without a descent.
+	    largestKey is never less than the lower separator of the last leaf, Open takes the separator when that leaf is empty
+	    A node of the right edge that is split by an insert at its end keeps RIGHTSPLIT of the keys, so ascending keys fill the nodes
+	14. The latch of a page keeps the node decoded at the current version, readers share it until a writer changes the node,
+	    so a descent allocates nothing per level. A writer that locked a node changes its own copy, never the shared one
 
 */
 
 #include "Utils.hpp"
 #include "RecordIdentifier.hpp"
+#include "BufferManager.hpp"
 #include "BpTreeNode.hpp"
+#include "EntrySorter.hpp"
+#include "CompositeKey.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 struct IndexHeader {				// the information of every index
 
 	char identifyString[Utils::IDENTIFYSTRINGLEN];
 
 	AttrType attrType;
-	
+
 	PageNum rootPage;
 
 	size_t attrLength;
@@ -31,11 +53,18 @@ struct IndexHeader {				// the information of every index
 
 	size_t height;
 
+	size_t numColumns;			// the attributes of a COMPOSITE index, 0 for others
+
+	KeyColumn columns[CompositeKey::MAXCOLUMNS];
+
+	size_t numIncluded;			// the last columns are INCLUDE columns, stored in the payload of the leaves
+
 	IndexHeader() {
 		memset (identifyString, 0, sizeof ( identifyString ));
 		strcpy_s (identifyString, Utils::INDEXIDENTIFYSTRING);
 		rootPage = Utils::UNKNOWNPAGENUM;
-		attrLength = numPages = height = numMaxKeys = 0;
+		attrLength = numPages = height = numMaxKeys = numColumns = numIncluded = 0;
+		memset (columns, 0, sizeof (columns));
 	}
 
 };
@@ -43,30 +72,43 @@ struct IndexHeader {				// the information of every index
 class IndexHandle {
 	friend class IndexManager;
 
+	friend class IndexScan;
+
 public:
 	using Comparator = BpTreeNode::Comparator;
 
-	//IndexHandle ( );
 	IndexHandle ();
 	~IndexHandle ( );
 
-	RETCODE InsertEntry (void *pData, const RecordIdentifier & rid);  // Insert new index entry ( b+tree algorithm)
+	RETCODE InsertEntry (void *pData, const RecordIdentifier & rid);  // Insert new index entry ( b+tree algorithm), pData is followed by the payload
 
 	RETCODE DeleteEntry (void *pData, const RecordIdentifier & rid);  // Delete index entry
-	
+
+	/*
+		Build the tree of an empty index from the entries of the sorted sorter, every node gets
+		fillFactor of the keys it can hold, ENTRYEXISTS if the index has entries
+	*/
+	RETCODE BulkLoad (EntrySorter & sorter, double fillFactor);
+
 	RETCODE ForcePages ( );                             // Copy all pages (the whole b+tree) to disk
 
 	RETCODE ReadHeader ( );
 	RETCODE SaveHeader ( ) const;
 
-	BpTreeNodePtr FetchNode (PageNum page) const;
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	BpTreeNodePtr FetchNode (PageNum page) const;			// without the version of the node, for a single thread
 
 	BpTreeNodePtr FetchNode (const RecordIdentifier &) const;
 
-	BpTreeNodePtr FindLeaf (void * pData) ;
+	BpTreeNodePtr FindLeaf (void * pData) ;			// the leaf where the keys not less than pData start, the first leaf for nullptr
+
+	BpTreeNodePtr FindLastLeaf (void * pData) ;		// the leaf where the keys not greater than pData end, the last leaf for nullptr
 
 	BpTreeNodePtr FindLargestLeaf ( ) ;
 
+	const CompositeKey & KeyColumns ( ) const;		// the attributes of a COMPOSITE index, no column for others
+
 private:
 	/*
 	The file must be opened before any other operation
@@ -75,12 +117,99 @@ private:
 
 	const static PageNum HEADERPAGE = 1;
 
+	const static size_t LATCHCHUNK = 16 * 1024;			// the latches of LATCHCHUNK pages are allocated together
+
+	const static size_t MAXLATCHCHUNKS = 16 * 1024;
+
+	static constexpr double RIGHTSPLIT = 0.9;			// the share of the keys the left node keeps in a split at the right edge
+
 	bool IsValid ( ) const;
 
 	RETCODE GetThisPage (PageNum, PagePtr &);
 	RETCODE GetNewPage (PagePtr  &);
 
-	RETCODE SetHeight (size_t h);
+	RETCODE NewNode (bool leaf, BpTreeNodePtr & node);
+
+	struct DecodedNode {					// the node as it was at version, only read
+		uint64_t version;
+
+		BpTreeNode node;
+
+		DecodedNode (uint64_t _version, AttrType type, size_t attrLen, PagePtr page) : version (_version), node (type, attrLen, page, false) { }
+	};
+
+	struct NodeLatch {						// the version of a node for optimistic lock coupling
+		std::atomic<uint64_t> version;		// odd while a writer holds the node, every write adds 2
+
+		std::atomic<bool> cached;			// page is set
+
+		PagePtr page;
+
+		shared_ptr<DecodedNode> decoded;	// taken and set by std::atomic_load and std::atomic_store
+
+		NodeLatch ( ) : version (0), cached (false) { }
+	};
+
+	struct Path {							// the nodes of a descent from the root to a leaf
+		std::vector<BpTreeNodePtr> nodes;
+
+		std::vector<uint64_t> versions;		// the version every node was read at
+
+		std::vector<size_t> children;		// the child taken in each internal node
+	};
+
+	const static size_t PATHRESERVE = 8;		// the levels a Path holds before its vectors grow
+
+	NodeLatch & latchOf (PageNum page) const;
+
+	RETCODE pageOf (PageNum page, PagePtr & pagePtr) const;
+
+	RETCODE readNode (PageNum page, BpTreeNodePtr & node, uint64_t & version) const;		// node is nullptr if it changed while it was read
+
+	RETCODE ownNode (BpTreeNodePtr & node) const;		// the copy of a locked node its writer changes
+
+	bool validate (PageNum page, uint64_t version) const;		// the node is still at version
+
+	bool upgrade (PageNum page, uint64_t version) const;		// lock the node if it is still at version
+
+	void lockNode (PageNum page) const;
+
+	void unlockNodes (const std::vector<BpTreeNodePtr> & nodes, bool changed) const;
+
+	RETCODE descend (void * pData, bool rightmost, Path & path) const;
+
+	RETCODE splitEntry (void * pData, const RecordIdentifier & rid);
+
+	RETCODE insertEntries (Path & path, size_t level, size_t pos, const std::vector<char> & newKeys, const std::vector<RecordIdentifier> & newRids,
+						   std::vector<BpTreeNodePtr> & locked);
+
+	bool hasEntry (const BpTreeNodePtr & leaf, void * pData, const RecordIdentifier & rid, bool & changed) const;
+
+	void updateLargestKey (const BpTreeNodePtr & leaf, void * pData);
+
+	bool appendLeaf (void * pData, BpTreeNodePtr & leaf, uint64_t & version);		// lastLeaf and its version if pData goes to it
+
+	std::vector<size_t> partition (const char * keys, size_t n, size_t payloadLen, bool rightEdge) const;
+
+	void setRoot (PageNum page, size_t height);
+
+	struct BulkLevel {						// the node of a level BulkLoad is filling
+		std::vector<char> keys;				// the entries of a leaf, the keys of an internal node
+
+		std::vector<RecordIdentifier> rids;
+
+		size_t prefixLen;					// the layout of the keys, STRING only
+
+		size_t longest;
+
+		std::vector<char> lastKey;			// the last key of the node before
+
+		BpTreeNodePtr last;					// the node before, nullptr for the first node of the level
+	};
+
+	RETCODE bulkAppend (std::vector<BulkLevel> & levels, size_t level, const char * key, const RecordIdentifier & rid, double fillFactor);
+
+	RETCODE bulkEmit (std::vector<BulkLevel> & levels, size_t level, double fillFactor, bool root);
 
 	/*
 		Get Info
@@ -90,6 +219,10 @@ private:
 
 	size_t attrLen ( ) const;
 
+	size_t payloadLen ( ) const;		// the INCLUDE attributes after the key of a leaf entry
+
+	size_t entryLen ( ) const;
+
 	size_t numMaxKeys ( ) const;		// the order of tree
 
 	size_t numPages ( ) const;
@@ -97,64 +230,58 @@ private:
 	size_t height ( ) const;
 
 /* B+Tree Members */
-	BpTreeNodePtr root;
+	VoidPtr largestKey;			// not less than any key of the tree nor the lower separator of lastLeaf
+
+	std::mutex largestKeyMutex;
 
-	VoidPtr largestKey;
+	std::atomic<PageNum> lastLeaf;			// the last leaf when it was set, checked by its next before it is used
+
+	std::atomic<PageNum> rootPage;			// header.rootPage for the readers
+
+	std::unique_ptr<std::atomic<NodeLatch*>[]> latches;		// MAXLATCHCHUNKS chunks of LATCHCHUNK latches, allocated on first use
+
+	mutable std::mutex latchMutex;			// allocates the chunks and caches the pages
+
+	std::mutex splitMutex;					// one split at a time
 
 /*	IndexHandle Members */
 
 	IndexHeader header;
 
+	CompositeKey compositeKey;			// from header.columns
+
 	BufferManagerPtr bufMgr;
-	
-	bool headerModified;
 
-	bool isOpenHandle;
+	mutable bool headerModified;
 
-	std::vector<BpTreeNodePtr> path;
-	
-	std::vector<size_t> pathPage;
+	bool isOpenHandle;
 
 };
 
 using IndexHandlePtr = shared_ptr<IndexHandle>;
-//
-//IndexHandle::IndexHandle ( ) {
-//	largestKey = root = nullptr;
-//	
-//	header.height = 0;
-//
-//}
 
 inline IndexHandle::IndexHandle () {
 	headerModified = false;
 	isOpenHandle = false;
-	root = nullptr;
-
+	bufMgr = nullptr;
+	rootPage = Utils::UNKNOWNPAGENUM;
+	lastLeaf = Utils::UNKNOWNPAGENUM;
+	latches.reset (new std::atomic<NodeLatch*>[MAXLATCHCHUNKS] ( ));
 }
 
 IndexHandle::~IndexHandle ( ) {
 	RETCODE result;
 
-	if ( headerModified ) {
-		
+	if ( headerModified && bufMgr != nullptr ) {
+
 		if ( result = SaveHeader ( ) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		}
 
 	}
 
-	for ( size_t i = 0; i < path.size ( ); i++ ) {
-		PageNum page = path[i]->GetPageNum ( );
-
-		if ( result = path[i]->writePage ( ) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-		}
-		
-		if ( result = bufMgr->ForcePage (page) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-		}
-	}
+	for ( size_t i = 0; i < MAXLATCHCHUNKS; i++ )
+		delete[] latches[i].load ( );
 
 }
 
@@ -162,8 +289,6 @@ IndexHandle::~IndexHandle ( ) {
 The file must be opened before any other operation
 */
 inline RETCODE IndexHandle::Open (BufferManagerPtr buf) {
-	PagePtr pagePtr;				// for root page
-	DataPtr pData;
 	RETCODE result = RETCODE::COMPLETE;
 
 	if ( bufMgr != nullptr || isOpenHandle ) {
@@ -187,203 +312,229 @@ inline RETCODE IndexHandle::Open (BufferManagerPtr buf) {
 
 	isOpenHandle = true;
 	headerModified = false;
-	
-	bool hasLeaf = false;
-	if ( height() == 0 ) {		// is empty tree (without root)
-		if ( result = this->GetNewPage (pagePtr) ) {
+	rootPage = header.rootPage;
+	compositeKey = CompositeKey (std::vector<KeyColumn> (header.columns, header.columns + header.numColumns), header.numIncluded);
+
+	if ( height() == 0 ) {		// is empty tree (without root), the root starts as a leaf
+		BpTreeNodePtr root;
+
+		if ( result = NewNode (true, root) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
-		pagePtr->GetPageNum (header.rootPage);
-		root = make_shared<BpTreeNode> (header.attrType, header.attrLength, pagePtr, true);
-		SetHeight (1);
-	} else {
-		hasLeaf = true;
-		this->GetThisPage (header.rootPage, pagePtr);
-		root = make_shared<BpTreeNode> (header.attrType, header.attrLength, pagePtr, false);
-		SetHeight (header.height);
+
+		setRoot (root->GetPageNum ( ), 1);
 	}
-	// lock root page
-	bufMgr->GetPage (header.rootPage, pagePtr);
 
-	path[0] = root;
-	headerModified = true;
-	largestKey = VoidPtr ( reinterpret_cast<void*>(new char[attrLen()]() ) );
-	if ( hasLeaf ) {
-		BpTreeNodePtr largestLeaf = FindLargestLeaf ( );
-		if( largestLeaf->GetNumKeys() > 0 )
-			largestLeaf->CopyKeyTo (largestLeaf->GetNumKeys ( ) - 1, largestKey.get());
+	largestKey = VoidPtr (new char[attrLen ( )]( ), std::default_delete<char[]> ( ));
+
+	Path path;
+
+	if ( result = descend (nullptr, true, path) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
 	}
+
+	BpTreeNodePtr largestLeaf = path.nodes.back ( );
+
+	// an empty last leaf still takes every key from its lower separator on, the key its parent keeps for it
+	if ( largestLeaf->GetNumKeys ( ) > 0 )
+		largestLeaf->CopyKeyTo (largestLeaf->GetNumKeys ( ) - 1, largestKey.get ( ));
+	else if ( path.nodes.size ( ) > 1 )
+		path.nodes[path.nodes.size ( ) - 2]->CopyKeyTo (path.children.back ( ), largestKey.get ( ));
+	else
+		BpTreeNode::MinKey (attrType ( ), attrLen ( ), largestKey.get ( ));
+
+	lastLeaf = largestLeaf->GetPageNum ( );
+
 	return result;
 }
 
+/*
+	Only the leaf is locked when the entry fits in it, a full leaf is left to splitEntry
+*/
 inline RETCODE IndexHandle::InsertEntry (void * pData, const RecordIdentifier & rid) {
-	
+
 	if ( pData == nullptr )
 		return BADKEY;
 
 	RETCODE result;
-	BpTreeNodePtr node = FindLeaf (pData);			// find the leaf node to insert
-	BpTreeNodePtr newNode = nullptr;
-	size_t level = height ( ) - 1;						// from bottom up
-	bool newLargest = false;
-	void * prevKey = nullptr;
 
-	assert (node != nullptr);
-	// check if the entry(key, rid) is already exists
-	size_t keyPos;
+	for ( ;; ) {
+		Path path;
+		bool changed;
+		BpTreeNodePtr leaf;
+		uint64_t version;
 
-	if ( result = node->FindKey (pData, rid, keyPos) ) {		// Acutally is { key, rid } Not found
-		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-		return result;
-	}
+		if ( !appendLeaf (pData, leaf, version) ) {
+			if ( result = descend (pData, true, path) ) {		// the last leaf the key can go to
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
 
-	if ( keyPos != Utils::UNKNOWNPOS ) {
-		return RETCODE::ENTRYEXISTS;
-	}
+			leaf = path.nodes.back ( );
+			version = path.versions.back ( );
+		}
 
-	if ( node->GetNumKeys ( ) == 0 || node->comp (pData, largestKey.get()) > 0 ){		// if is new key is the largest key
-		newLargest = true;
-		prevKey = largestKey.get ( );
-		//void * tmp;
-		//root->GetKey (root->GetMaxKeys ( ) - 1, tmp);
-		//assert (prevKey == tmp);
-	}
+		// check if the entry(key, rid) is already exists
+		bool found = hasEntry (leaf, pData, rid, changed);
 
-	if ( (result = node->Insert (pData, rid)) && result != RETCODE::NODEKEYSFULL ) {
-		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-		return result;
-	}
+		if ( changed || !validate (leaf->GetPageNum ( ), version) )
+			continue;
 
-	// if the inserting entry has the largest key
-	if ( newLargest ) {
-		for ( size_t i = 0; i < height ( ); i++ ) {
-			size_t pos = path[i]->FindKey (prevKey);
-			if ( pos != Utils::UNKNOWNPOS ){			// here the condition must be true (i.e. the prevKey(currently largest) should be found found)
-				path[i]->SetKey (pos, pData);
-				bufMgr->MarkDirty (path[i]->GetPageNum ( ));
-			} else {		// if the root is empty
-				// TODO: 
-			}
-		}
+		if ( found )
+			return RETCODE::ENTRYEXISTS;
 
-		memcpy_s (largestKey.get ( ), attrLen ( ), pData, attrLen ( ));
-	}
+		if ( !upgrade (leaf->GetPageNum ( ), version) )
+			continue;
 
-	// no space in node -> overflow nonroot
-	void * failedKey = pData;
-	RecordIdentifier failedRid = rid;
-	while ( result = RETCODE::NODEKEYSFULL ) {			// if the insert node is full
+		if ( result = ownNode (leaf) ) {
+			unlockNodes ({ leaf }, false);
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
 
-		VoidPtr oldLargest = shared_ptr<void> ( reinterpret_cast<char*>(new char[attrLen()]()) );
+		result = leaf->Insert (pData, rid);
 
-		if ( node->LargestKey ( ) == nullptr ) {		// numkeys == 0
-			oldLargest = nullptr;
-		} else {
-			node->CopyKeyTo (node->GetNumKeys ( ) - 1, oldLargest.get());
+		if ( result == RETCODE::NODEKEYSFULL ) {
+			unlockNodes ({ leaf }, false);
+			return splitEntry (pData, rid);
 		}
 
-		PagePtr pagePtr;
+		if ( result == RETCODE::COMPLETE )
+			result = bufMgr->MarkDirty (leaf->GetPageNum ( ));
 
-		if ( result = this->GetNewPage (pagePtr) ) {
+		unlockNodes ({ leaf }, true);
+
+		if ( result ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
 
-		newNode = make_shared<BpTreeNode> (attrType ( ), attrLen ( ), pagePtr, true);
-		
-		if ( result = node->Split (*newNode.get ( )) ) {
+		if ( leaf->GetNext ( ) == Utils::UNKNOWNPAGENUM ) {		// only the last leaf takes a key larger than largestKey
+			lastLeaf = leaf->GetPageNum ( );
+			updateLargestKey (leaf, pData);
+		}
+
+		return RETCODE::COMPLETE;
+	}
+}
+
+/*
+	Deletes do not merge nodes, an empty leaf stays in the chain until a key falls into it again.
+	The next leaf is locked before the current one is released
+*/
+inline RETCODE IndexHandle::DeleteEntry (void * pData, const RecordIdentifier & rid) {
+	RETCODE result;
+
+	if ( pData == nullptr )
+		return BADKEY;
+
+	Path path;
+
+	do {
+		if ( result = descend (pData, false, path) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
+	} while ( !upgrade (path.nodes.back ( )->GetPageNum ( ), path.versions.back ( )) );
 
-		BpTreeNodePtr curRight = FetchNode (newNode->GetRight ( ));
-		if ( curRight != nullptr ) {
-			curRight->SetLeft (newNode->GetPageNum());
-			curRight = nullptr;
-		}
+	BpTreeNodePtr node = path.nodes.back ( );
+
+	if ( result = ownNode (node) ) {
+		unlockNodes ({ node }, false);
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	// the equal keys may continue in the next leaves
+	for ( ;; ) {
+		size_t pos = node->FindKey (pData, rid);
+
+		if ( pos != Utils::UNKNOWNPOS ) {
 
-		BpTreeNodePtr nodeInsertedInto = nullptr;
+			if ( ( result = node->Delete (pos) ) || ( result = bufMgr->MarkDirty (node->GetPageNum ( )) ) ) {
+				unlockNodes ({ node }, true);
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
 
-		// put the new entry into one of the 2 now.
-		// In the comparison,
-		// > takes care of normal cases
-		// = is a hack for dups - this results in affinity for preserving
-		// RID ordering for children - more balanced tree when all keys are the same.
+			unlockNodes ({ node }, true);
 
-		if ( node->comp (pData, node->LargestKey ( )) >= 0 ) {
-			newNode->Insert (failedKey, failedRid);
-			nodeInsertedInto = newNode;
-		} else {
-			node->Insert (failedKey, failedRid);
-			nodeInsertedInto = node;
+			return RETCODE::COMPLETE;
 		}
-		// go up to parent level and repeat
-		if( level < 0 )		// if root
+
+		if ( node->UpperBound (pData) < node->GetNumKeys ( ) || node->GetNext ( ) == Utils::UNKNOWNPAGENUM )	// a greater key is found
 			break;
-		size_t posAtParent = pathPage[level];
-		BpTreeNodePtr parent = path[level];
 
-		// update old key - keep same addr
-		parent->Delete (posAtParent);
+		PageNum next = node->GetNext ( );
 
-		result = parent->Insert (node->LargestKey ( ), node->GetPageRid( ));
-		// this result should always be good - we removed first before
-		// inserting to prevent overflow.
+		lockNode (next);
+		unlockNodes ({ node }, false);
 
-		// insert new key
-		result = parent->Insert (newNode->LargestKey ( ), newNode->GetPageRid ( ));
+		node = FetchNode (next);
 
-		// iterate for parent node and split if required
-		node = parent;
-		failedKey = node->LargestKey ( );
-		failedRid = node->GetPageRid ( );
+		if ( node == nullptr ) {
+			latchOf (next).version.fetch_sub (1, std::memory_order_release);
+			Utils::PrintRetcode (RETCODE::INVALIDINDEX, __FUNCTION__, __LINE__);
+			return RETCODE::INVALIDINDEX;
+		}
+	}
 
-		bufMgr->MarkDirty (node->GetPageNum ( ));
-		bufMgr->MarkDirty (newNode->GetPageNum ( ));
-		bufMgr->MarkDirty (parent->GetPageNum ( ));
+	unlockNodes ({ node }, false);
 
-		newNode = nullptr;
-	}
+	return RETCODE::KEYNOTFOUND;
+}
 
-	if ( level >= 0 ) {
-		// insertion done
-		return RETCODE::COMPLETE;
+/*
+	The leaves are filled in the order of the entries, when a leaf has its share of keys it is written to its page
+	and its separator goes to the node of the level above in the same way, so only one node per level is in memory.
+	The last node of every level is written at the end, the level with a single node is the root
+*/
+inline RETCODE IndexHandle::BulkLoad (EntrySorter & sorter, double fillFactor) {
+	RETCODE result;
+
+	if ( !( fillFactor > 0 && fillFactor <= 1 ) )
+		return RETCODE::OUTOFRANGE;
+
+	if ( height ( ) != 1 ) {
+		return RETCODE::ENTRYEXISTS;
 	} else {
-		// root split happened
-		if ( result = bufMgr->UnlockPage (header.rootPage) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-			return result;
-		}
-		// make new root node
-		PagePtr pagePtr;
-		if ( result = GetNewPage (pagePtr) ) {
+		BpTreeNodePtr root = FetchNode (header.rootPage);
+
+		if ( root == nullptr || root->GetNumKeys ( ) > 0 )
+			return root == nullptr ? RETCODE::INVALIDINDEX : RETCODE::ENTRYEXISTS;
+	}
+
+	std::vector<BulkLevel> levels (1);
+	const char * key;
+	RecordIdentifier rid;
+
+	while ( ( result = sorter.Next (key, rid) ) == RETCODE::COMPLETE ) {
+		if ( result = bulkAppend (levels, 0, key, rid, fillFactor) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
+	}
+
+	if ( result != RETCODE::EOFSCAN ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
 
-		root = make_shared<BpTreeNode> (attrType ( ), attrLen ( ), pagePtr, true);
+	if ( levels[0].rids.empty ( ) )
+		return RETCODE::COMPLETE;
 
-		root->Insert (node->LargestKey ( ), node->GetPageRid ( ));
-		root->Insert (newNode->LargestKey ( ), newNode->GetPageRid ( ));
+	memcpy_s (largestKey.get ( ), attrLen ( ), &levels[0].keys[levels[0].keys.size ( ) - entryLen ( )], attrLen ( ));
 
-		// lock root page
-		header.rootPage = root->GetPageNum ( );
-		PagePtr rootPagePtr;
-		if ( result = GetThisPage (header.rootPage, rootPagePtr) ) {
+	// the last node of a level sends its separator up, so the levels above the current one may grow
+	for ( size_t level = 0; level < levels.size ( ); level++ ) {
+		if ( result = bulkEmit (levels, level, fillFactor, level + 1 == levels.size ( )) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
-
-		
-
 	}
 
-
-	/*MarkDirty and UnLock*/
-	
-	headerModified = true;
-	header.numPages++;
 	return RETCODE::COMPLETE;
 }
 
@@ -391,7 +542,7 @@ inline RETCODE IndexHandle::ForcePages ( ) {
 
 	PagePtr headerPage;
 	RETCODE result;
-	
+
 	if ( result = SaveHeader ( ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
@@ -415,12 +566,12 @@ inline RETCODE IndexHandle::ReadHeader ( ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
-	
+
 	if ( result = pagePtr->GetData (pData) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
-	
+
 	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (IndexHeader), pData, sizeof (IndexHeader));
 
 	if ( strcmp (header.identifyString, Utils::INDEXIDENTIFYSTRING) != 0 ) {
@@ -438,31 +589,44 @@ inline RETCODE IndexHandle::SaveHeader ( ) const{
 
 	if ( bufMgr == nullptr ) {
 		Utils::PrintRetcode (RETCODE::HDRWRITE, __FUNCTION__, __LINE__);
+		return RETCODE::HDRWRITE;
 	}
 
 	if ( result = bufMgr->GetPage (HEADERPAGE, rootpage) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
 	}
 
 	if ( result = rootpage->GetData (pData) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
 	}
 
 	memcpy_s (pData, sizeof (IndexHeader), reinterpret_cast< const void * >( &header ), sizeof (IndexHeader));
 
 	if ( result = bufMgr->ForcePage (HEADERPAGE) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
 	}
 
+	headerModified = false;
+
 	return result;
 }
 
+inline RETCODE IndexHandle::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
 inline BpTreeNodePtr IndexHandle::FetchNode (PageNum page) const {
 	return FetchNode(RecordIdentifier{page, 0});
 }
 
+/*
+	The caller may change the node, so the node decoded for the readers is dropped
+*/
 inline BpTreeNodePtr IndexHandle::FetchNode (const RecordIdentifier & rid) const {
-	
+
 	PageNum page;
 	PagePtr pagePtr;
 	RETCODE result;
@@ -472,51 +636,43 @@ inline BpTreeNodePtr IndexHandle::FetchNode (const RecordIdentifier & rid) const
 		return nullptr;
 	}
 
-	if ( result = bufMgr->GetPage (page, pagePtr) ) {
+	if ( result = pageOf (page, pagePtr) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return nullptr;
 	}
 
+	std::atomic_store (&latchOf (page).decoded, shared_ptr<DecodedNode> ( ));
+
 	return make_shared<BpTreeNode> (attrType ( ), attrLen ( ), pagePtr, false);
 
 }
 
-inline BpTreeNodePtr IndexHandle::FindLargestLeaf ( ) {
-	PageNum page;
-	PagePtr pagePtr;
+inline BpTreeNodePtr IndexHandle::FindLeaf (void * pData) {
 	RETCODE result;
+	Path path;
 
-	if ( root == nullptr )
+	if ( result = descend (pData, false, path) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return nullptr;
-
-	if ( height ( ) == 1 ) {
-		path[0] = root;
-		return root;
 	}
 
-	for ( size_t i = 1; i < height ( ); i++ ) {
-		auto rid = path[i - 1]->GetRid (path[i - 1]->GetNumKeys ( ) - 1);
-		if ( rid.GetPageNum (page) == RETCODE::COMPLETE && page == Utils::UNKNOWNPAGENUM ) {
-			return nullptr;
-		}
-		// start with a new page 
-		if ( path[i] != nullptr ) {
-			bufMgr->UnlockPage (path[i]->GetPageNum());
-			path[i] = nullptr;
-			//pathPage[i] = 0;
-		} 		
-		path[i] = FetchNode (rid);
-
-		// make the buffer lock page
-		if ( result = bufMgr->GetPage (page, pagePtr) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-			return nullptr;
-		}
+	return path.nodes.back ( );
+}
+
+inline BpTreeNodePtr IndexHandle::FindLastLeaf (void * pData) {
+	RETCODE result;
+	Path path;
 
-		pathPage[i - 1] = 0;
+	if ( result = descend (pData, true, path) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return nullptr;
 	}
 
-	return path[height()-1];
+	return path.nodes.back ( );
+}
+
+inline BpTreeNodePtr IndexHandle::FindLargestLeaf ( ) {
+	return FindLastLeaf (nullptr);
 }
 
 inline AttrType IndexHandle::attrType ( ) const {
@@ -527,6 +683,14 @@ inline size_t IndexHandle::attrLen( )const {
 	return header.attrLength;
 }
 
+inline size_t IndexHandle::payloadLen ( ) const {
+	return compositeKey.Length ( ) - compositeKey.KeyLength ( );
+}
+
+inline size_t IndexHandle::entryLen ( ) const {
+	return attrLen ( ) + payloadLen ( );
+}
+
 inline size_t IndexHandle::numMaxKeys ( ) const {
 	return header.numMaxKeys;
 }
@@ -539,60 +703,8 @@ inline size_t IndexHandle::height ( ) const {
 	return header.height;
 }
 
-
-
-inline BpTreeNodePtr IndexHandle::FindLeaf (void * pData) {
-	if ( root == nullptr )
-		return nullptr;
-
-	if ( height() == 1 ) {
-		path[0] = root;
-		return root;
-	}
-
-	PageNum page;
-	RETCODE result;
-	PagePtr pagePtr;
-
-	//path[0] = root;
-	//pathPage[0] = roo
-
-	for ( size_t i = 1; i < height ( ); i++ ) {
-		RecordIdentifier r = path[i - 1]->GetRid (pData);
-		size_t pos = path[i - 1]->FindKeyPosFit (pData);
-
-		if ( result = r.GetPageNum (page) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-			return nullptr;
-		}
-		
-		if ( page == Utils::UNKNOWNPAGENUM ) {
-			void * p = path[i - 1]->LargestKey ( );
-			r = path[i - 1]->GetRid (p);
-			pos = path[i - 1]->FindKey (p);
-		}
-
-		// if start with a new page
-		if ( i < path.size ( ) ) {
-			if ( result = bufMgr->UnlockPage (path[i]->GetPageNum ( )) ) {
-				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-				return nullptr;
-			}
-			path[i] = nullptr;
-		}
-
-		path[i] = FetchNode (page);
-		
-		// lock page
-		PagePtr tmp;
-		if ( result = bufMgr->GetPage (page, tmp) ) {
-			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-			return nullptr;
-		}
-		pathPage[i - 1] = pos;
-	}
-
-	return path[height()-1];
+inline const CompositeKey & IndexHandle::KeyColumns ( ) const {
+	return compositeKey;
 }
 
 inline bool IndexHandle::IsValid ( ) const {
@@ -631,25 +743,693 @@ inline RETCODE IndexHandle::GetNewPage (PagePtr & page) {
 	return RETCODE::COMPLETE;
 }
 
+inline RETCODE IndexHandle::NewNode (bool leaf, BpTreeNodePtr & node) {
+	RETCODE result;
+	PagePtr pagePtr;
+	PageNum page;
+
+	if ( ( result = GetNewPage (pagePtr) ) || ( result = pagePtr->GetPageNum (page) ) || ( result = bufMgr->UnlockPage (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( page >= LATCHCHUNK * MAXLATCHCHUNKS ) {
+		Utils::PrintRetcode (RETCODE::INVALIDPAGE, __FUNCTION__, __LINE__);
+		return RETCODE::INVALIDPAGE;
+	}
+
+	NodeLatch & latch = latchOf (page);
+
+	{
+		std::lock_guard<std::mutex> guard (latchMutex);
+
+		latch.page = pagePtr;
+		latch.cached.store (true, std::memory_order_release);
+	}
+
+	std::atomic_store (&latch.decoded, shared_ptr<DecodedNode> ( ));
+
+	node = make_shared<BpTreeNode> (attrType ( ), attrLen ( ), pagePtr, true, leaf ? payloadLen ( ) : 0);
+	node->SetLeaf (leaf);
+
+	return bufMgr->MarkDirty (page);
+}
+
 /*
-	Update height and allocate space for path and pathPages
+	The latch of a page, the chunk that holds it is allocated when one of its pages is used first
+*/
+inline IndexHandle::NodeLatch & IndexHandle::latchOf (PageNum page) const {
+	std::atomic<NodeLatch*> & chunk = latches[page / LATCHCHUNK];
+	NodeLatch * latch = chunk.load (std::memory_order_acquire);
 
+	if ( latch == nullptr ) {
+		std::lock_guard<std::mutex> guard (latchMutex);
+
+		latch = chunk.load (std::memory_order_relaxed);
+
+		if ( latch == nullptr ) {
+			latch = new NodeLatch[LATCHCHUNK];
+			chunk.store (latch, std::memory_order_release);
+		}
+	}
+
+	return latch[page % LATCHCHUNK];
+}
+
+/*
+	The buffer keeps every page in memory, so the page is fetched once and kept in its latch
 */
-inline RETCODE IndexHandle::SetHeight (size_t h) {
-	path.clear ( );
-	pathPage.clear ( );
+inline RETCODE IndexHandle::pageOf (PageNum page, PagePtr & pagePtr) const {
+	RETCODE result;
 
-	header.height = h;
-	
-	path.push_back (root);
+	if ( page >= LATCHCHUNK * MAXLATCHCHUNKS )
+		return RETCODE::INVALIDPAGE;
 
-	/*
-		Initialize path with size height() and pathPage with size height()-1
-	*/
-	for ( size_t i = 1; i < height ( ); i++ ) {
-		path.push_back (nullptr);
-		pathPage.push_back (Utils::UNKNOWNPOS);
+	NodeLatch & latch = latchOf (page);
+
+	if ( !latch.cached.load (std::memory_order_acquire) ) {
+		std::lock_guard<std::mutex> guard (latchMutex);
+
+		if ( !latch.cached.load (std::memory_order_relaxed) ) {
+			if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) ) )
+				return result;
+
+			latch.page = pagePtr;
+			latch.cached.store (true, std::memory_order_release);
+		}
 	}
 
+	pagePtr = latch.page;
+
 	return RETCODE::COMPLETE;
 }
+
+/*
+	Read the node at page without a lock, it waits while a writer holds the node.
+	node is nullptr if a writer took the node while it was read, the caller reads it again.
+	The node decoded at the version is shared, it is decoded again only after the version changed
+*/
+inline RETCODE IndexHandle::readNode (PageNum page, BpTreeNodePtr & node, uint64_t & version) const {
+	RETCODE result;
+	PagePtr pagePtr;
+
+	node = nullptr;
+
+	if ( result = pageOf (page, pagePtr) )
+		return result;
+
+	NodeLatch & latch = latchOf (page);
+
+	while ( ( version = latch.version.load (std::memory_order_acquire) ) & 1 )
+		std::this_thread::yield ( );
+
+	shared_ptr<DecodedNode> decoded = std::atomic_load (&latch.decoded);
+
+	if ( decoded == nullptr || decoded->version != version ) {
+		decoded = make_shared<DecodedNode> (version, attrType ( ), attrLen ( ), pagePtr);
+
+		if ( !validate (page, version) )
+			return RETCODE::COMPLETE;
+
+		std::atomic_store (&latch.decoded, decoded);
+	}
+
+	node = BpTreeNodePtr (decoded, &decoded->node);
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The page is consistent while the writer holds the node, its copy is read from the page
+*/
+inline RETCODE IndexHandle::ownNode (BpTreeNodePtr & node) const {
+	BpTreeNodePtr own = FetchNode (node->GetPageNum ( ));
+
+	if ( own == nullptr )
+		return RETCODE::INVALIDINDEX;
+
+	node = own;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	What was read from the node before is valid if the node still has the version
+*/
+inline bool IndexHandle::validate (PageNum page, uint64_t version) const {
+	std::atomic_thread_fence (std::memory_order_acquire);
+
+	return latchOf (page).version.load (std::memory_order_relaxed) == version;
+}
+
+inline bool IndexHandle::upgrade (PageNum page, uint64_t version) const {
+	return latchOf (page).version.compare_exchange_strong (version, version + 1, std::memory_order_acquire);
+}
+
+inline void IndexHandle::lockNode (PageNum page) const {
+	std::atomic<uint64_t> & version = latchOf (page).version;
+
+	for ( ;; ) {
+		uint64_t current = version.load (std::memory_order_relaxed);
+
+		if ( !( current & 1 ) && version.compare_exchange_weak (current, current + 1, std::memory_order_acquire) )
+			return;
+
+		std::this_thread::yield ( );
+	}
+}
+
+/*
+	Changed nodes write their headers to the pages before any of them is released, so a reader sees all of them or none
+*/
+inline void IndexHandle::unlockNodes (const std::vector<BpTreeNodePtr> & nodes, bool changed) const {
+	if ( changed ) {
+		for ( const BpTreeNodePtr & node : nodes )
+			node->writePage ( );
+	}
+
+	for ( const BpTreeNodePtr & node : nodes ) {
+		if ( changed )
+			latchOf (node->GetPageNum ( )).version.fetch_add (1, std::memory_order_release);
+		else
+			latchOf (node->GetPageNum ( )).version.fetch_sub (1, std::memory_order_release);
+	}
+}
+
+/*
+	Go from the root to a leaf without a lock, path receives the nodes with their versions and the child taken in each internal node.
+	A parent is validated after the child is read, when it changed the descent starts again from the root.
+	Child i of an internal node holds the keys not less than key i, a key goes to the last child whose key is
+	less than it (rightmost: not greater than it), pData nullptr goes to the first (rightmost: the last) child
+*/
+inline RETCODE IndexHandle::descend (void * pData, bool rightmost, Path & path) const {
+	RETCODE result;
+
+	path.nodes.reserve (PATHRESERVE);
+	path.versions.reserve (PATHRESERVE);
+	path.children.reserve (PATHRESERVE);
+
+	for ( ;; ) {
+		path.nodes.clear ( );
+		path.versions.clear ( );
+		path.children.clear ( );
+
+		PageNum page = rootPage.load (std::memory_order_acquire);
+		BpTreeNodePtr node;
+		uint64_t version;
+
+		if ( result = readNode (page, node, version) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		// a split may have put a new root above the node read
+		if ( node == nullptr || rootPage.load (std::memory_order_acquire) != page )
+			continue;
+
+		while ( node != nullptr && !node->IsLeaf ( ) ) {
+			size_t pos;
+			PageNum child;
+
+			if ( pData == nullptr )
+				pos = rightmost ? node->GetNumKeys ( ) : 0;
+			else
+				pos = rightmost ? node->UpperBound (pData) : node->LowerBound (pData);
+
+			pos = pos > 0 ? pos - 1 : 0;
+
+			node->GetRid (pos).GetPageNum (child);
+
+			path.nodes.push_back (node);
+			path.versions.push_back (version);
+			path.children.push_back (pos);
+
+			if ( !validate (page, version) ) {
+				node = nullptr;
+				break;
+			}
+
+			if ( result = readNode (child, node, version) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			if ( !validate (page, path.versions.back ( )) )
+				node = nullptr;
+
+			page = child;
+		}
+
+		if ( node == nullptr )
+			continue;
+
+		path.nodes.push_back (node);
+		path.versions.push_back (version);
+
+		return RETCODE::COMPLETE;
+	}
+}
+
+/*
+	Insert an entry whose leaf is full, any node of the path may split so all of them are locked from the root down.
+	One split runs at a time, and the neighbors it locks right of the path are only held by writers that lock to the right too
+*/
+inline RETCODE IndexHandle::splitEntry (void * pData, const RecordIdentifier & rid) {
+	std::lock_guard<std::mutex> guard (splitMutex);
+	RETCODE result;
+	Path path;
+	std::vector<BpTreeNodePtr> locked;
+	bool found;
+
+	for ( ;; ) {
+		bool changed;
+
+		if ( result = descend (pData, true, path) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		found = hasEntry (path.nodes.back ( ), pData, rid, changed);
+
+		if ( changed )
+			continue;
+
+		locked.clear ( );
+
+		for ( size_t i = 0; i < path.nodes.size ( ) && upgrade (path.nodes[i]->GetPageNum ( ), path.versions[i]); i++ )
+			locked.push_back (path.nodes[i]);
+
+		if ( locked.size ( ) == path.nodes.size ( ) )
+			break;
+
+		unlockNodes (locked, false);
+	}
+
+	if ( found ) {
+		unlockNodes (locked, false);
+		return RETCODE::ENTRYEXISTS;
+	}
+
+	for ( size_t i = 0; i < path.nodes.size ( ); i++ ) {
+		if ( result = ownNode (path.nodes[i]) ) {
+			unlockNodes (locked, false);
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		locked[i] = path.nodes[i];
+	}
+
+	BpTreeNodePtr leaf = path.nodes.back ( );
+	std::vector<char> key (reinterpret_cast< char* >( pData ), reinterpret_cast< char* >( pData ) + entryLen ( ));
+	std::vector<RecordIdentifier> keyRid (1, rid);
+
+	result = insertEntries (path, path.nodes.size ( ) - 1, leaf->UpperBound (pData), key, keyRid, locked);
+
+	// before a new last leaf is unlocked, its separator may be the key just inserted
+	if ( result == RETCODE::COMPLETE )
+		updateLargestKey (leaf, pData);
+
+	unlockNodes (locked, true);
+
+	if ( result ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Insert the sorted newKeys (the entries of a leaf) and their rids before pos in the node of path at level,
+	a node that cannot hold them is split and the separators of the new nodes go to the level above.
+	The neighbors and new nodes it changes are locked and added to locked
+*/
+inline RETCODE IndexHandle::insertEntries (Path & path, size_t level, size_t pos, const std::vector<char> & newKeys, const std::vector<RecordIdentifier> & newRids,
+										   std::vector<BpTreeNodePtr> & locked) {
+	RETCODE result;
+	BpTreeNodePtr node = path.nodes[level];
+
+	if ( newRids.size ( ) == 1 ) {
+		result = node->Insert (pos, const_cast< char* >( newKeys.data ( ) ), newRids[0]);
+
+		if ( result == RETCODE::COMPLETE )
+			return bufMgr->MarkDirty (node->GetPageNum ( ));
+
+		if ( result != RETCODE::NODEKEYSFULL )
+			return result;
+	}
+
+	// the entries of the node with the new ones at pos
+	size_t stride = attrLen ( ) + node->GetPayloadLen ( );
+	std::vector<char> keys (node->GetNumKeys ( ) * stride);
+	std::vector<RecordIdentifier> rids (node->GetNumKeys ( ));
+
+	node->CopyKeysTo (keys.data ( ), rids.data ( ));
+	keys.insert (keys.begin ( ) + pos * stride, newKeys.begin ( ), newKeys.end ( ));
+	rids.insert (rids.begin ( ) + pos, newRids.begin ( ), newRids.end ( ));
+
+	// appending at the end of the last node of the level, the keys to come go to the right as well
+	bool rightEdge = node->GetNext ( ) == Utils::UNKNOWNPAGENUM && pos == node->GetNumKeys ( );
+	std::vector<size_t> bounds = partition (keys.data ( ), rids.size ( ), node->GetPayloadLen ( ), rightEdge);		// part i is [bounds[i], bounds[i + 1])
+	std::vector<char> sepKeys;
+	std::vector<RecordIdentifier> sepRids;
+	BpTreeNodePtr left = node;
+
+	if ( ( result = node->Load (keys.data ( ), rids.data ( ), bounds[1]) ) || ( result = bufMgr->MarkDirty (node->GetPageNum ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( size_t i = 1; i + 1 < bounds.size ( ); i++ ) {
+		const char * first = keys.data ( ) + bounds[i] * stride;
+		BpTreeNodePtr right;
+
+		if ( result = NewNode (node->IsLeaf ( ), right) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		lockNode (right->GetPageNum ( ));
+		locked.push_back (right);
+
+		if ( result = right->Load (first, rids.data ( ) + bounds[i], bounds[i + 1] - bounds[i]) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		right->SetPrev (left->GetPageNum ( ));
+		right->SetNext (left->GetNext ( ));
+		left->SetNext (right->GetPageNum ( ));
+
+		// the separator of a leaf only has to tell its keys from the keys of the leaf before it
+		std::vector<char> sep (attrLen ( ));
+
+		if ( node->IsLeaf ( ) )
+			BpTreeNode::Separator (attrType ( ), attrLen ( ), first - stride, first, sep.data ( ));
+		else
+			memcpy (sep.data ( ), first, attrLen ( ));
+
+		sepKeys.insert (sepKeys.end ( ), sep.begin ( ), sep.end ( ));
+		sepRids.push_back (RecordIdentifier{ right->GetPageNum ( ), 0 });
+
+		left = right;
+	}
+
+	// the old next of node now follows the last new node, it is locked once however many nodes were added
+	if ( left != node && left->GetNext ( ) != Utils::UNKNOWNPAGENUM ) {
+		lockNode (left->GetNext ( ));
+
+		BpTreeNodePtr next = FetchNode (left->GetNext ( ));
+
+		if ( next == nullptr ) {
+			latchOf (left->GetNext ( )).version.fetch_sub (1, std::memory_order_release);
+			Utils::PrintRetcode (RETCODE::INVALIDINDEX, __FUNCTION__, __LINE__);
+			return RETCODE::INVALIDINDEX;
+		}
+
+		locked.push_back (next);
+		next->SetPrev (left->GetPageNum ( ));
+
+		if ( result = bufMgr->MarkDirty (next->GetPageNum ( )) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+	else if ( left != node && node->IsLeaf ( ) )
+		lastLeaf = left->GetPageNum ( );
+
+	if ( level > 0 )
+		return insertEntries (path, level - 1, path.children[level - 1] + 1, sepKeys, sepRids, locked);
+
+	// the root was split, the tree grows by one level
+	BpTreeNodePtr root;
+	std::vector<char> rootKeys (attrLen ( ));
+	std::vector<RecordIdentifier> rootRids (1, RecordIdentifier{ node->GetPageNum ( ), 0 });
+
+	BpTreeNode::MinKey (attrType ( ), attrLen ( ), rootKeys.data ( ));
+	rootKeys.insert (rootKeys.end ( ), sepKeys.begin ( ), sepKeys.end ( ));
+	rootRids.insert (rootRids.end ( ), sepRids.begin ( ), sepRids.end ( ));
+
+	if ( result = NewNode (false, root) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	lockNode (root->GetPageNum ( ));
+	locked.push_back (root);
+
+	if ( result = root->Load (rootKeys.data ( ), rootRids.data ( ), rootRids.size ( )) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	setRoot (root->GetPageNum ( ), height ( ) + 1);
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Equal keys may continue in the leaves before leaf, they are searched until a leaf has a smaller key.
+	The leaves before leaf are read without a lock, changed is set if one of them changed while it was read
+*/
+inline bool IndexHandle::hasEntry (const BpTreeNodePtr & leaf, void * pData, const RecordIdentifier & rid, bool & changed) const {
+	BpTreeNodePtr node = leaf;
+	uint64_t version = 0;
+
+	changed = false;
+
+	for ( ;; ) {
+		bool found = node->FindKey (pData, rid) != Utils::UNKNOWNPOS;
+		bool last = found || node->LowerBound (pData) > 0 || node->GetPrev ( ) == Utils::UNKNOWNPAGENUM;
+		PageNum prev = node->GetPrev ( );
+
+		if ( node != leaf && !validate (node->GetPageNum ( ), version) ) {
+			changed = true;
+			return false;
+		}
+
+		if ( last )
+			return found;
+
+		if ( readNode (prev, node, version) )
+			return false;
+
+		if ( node == nullptr ) {
+			changed = true;
+			return false;
+		}
+	}
+}
+
+inline void IndexHandle::updateLargestKey (const BpTreeNodePtr & leaf, void * pData) {
+	std::lock_guard<std::mutex> guard (largestKeyMutex);
+
+	if ( leaf->comp (pData, largestKey.get ( )) > 0 )		// if is new key is the largest key
+		memcpy_s (largestKey.get ( ), attrLen ( ), pData, attrLen ( ));
+}
+
+/*
+	The leaf is the last one if it has no next at a version that is still valid, then no separator is greater than
+	largestKey and a key not less than it goes to that leaf. A leaf that is not the last any more falls back to a descent
+*/
+inline bool IndexHandle::appendLeaf (void * pData, BpTreeNodePtr & leaf, uint64_t & version) {
+	PageNum page = lastLeaf.load ( );
+
+	if ( page == Utils::UNKNOWNPAGENUM || readNode (page, leaf, version) || leaf == nullptr )
+		return false;
+
+	if ( !leaf->IsLeaf ( ) || leaf->GetNext ( ) != Utils::UNKNOWNPAGENUM )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> guard (largestKeyMutex);
+
+		if ( leaf->comp (pData, largestKey.get ( )) < 0 )
+			return false;
+	}
+
+	return validate (page, version);
+}
+
+/*
+	Readers find the root through rootPage, it is set after the root is in its page
+*/
+inline void IndexHandle::setRoot (PageNum page, size_t height) {
+	header.rootPage = page;
+	header.height = height;
+	headerModified = true;
+	rootPage.store (page, std::memory_order_release);
+}
+
+/*
+	The bounds of the parts the n sorted entries of attrLen + payloadLen bytes are cut into, every part fits in one node.
+	Two parts are cut as near to the middle (rightEdge: to RIGHTSPLIT of the keys) as the layouts of the parts allow,
+	when no cut gives two parts that fit the keys are spread over more nodes
+*/
+inline std::vector<size_t> IndexHandle::partition (const char * keys, size_t n, size_t payloadLen, bool rightEdge) const {
+	std::vector<size_t> bounds (1, 0);
+
+	auto fits = [&] (size_t begin, size_t end) {
+		return end - begin <= BpTreeNode::Capacity (attrType ( ), attrLen ( ), payloadLen, keys + begin * ( attrLen ( ) + payloadLen ), end - begin);
+	};
+
+	if ( fits (0, n) ) {
+		bounds.push_back (n);
+		return bounds;
+	}
+
+	size_t low = 1, high = n - 1;			// the longest part from the left, one key always fits
+	while ( low < high ) {
+		size_t mid = ( low + high + 1 ) / 2;
+
+		if ( fits (0, mid) )
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	size_t most = low;
+
+	low = 1;
+	high = n - 1;							// the longest part from the right
+	while ( low < high ) {
+		size_t mid = ( low + high ) / 2;
+
+		if ( fits (mid, n) )
+			high = mid;
+		else
+			low = mid + 1;
+	}
+
+	size_t least = low;
+
+	if ( least <= most ) {
+		size_t cut = rightEdge ? static_cast< size_t >( n * RIGHTSPLIT ) : n / 2;
+
+		bounds.push_back (std::min (std::max (cut, least), most));
+		bounds.push_back (n);
+		return bounds;
+	}
+
+	for ( size_t begin = 0; begin < n; begin = bounds.back ( ) ) {
+		low = begin + 1;
+		high = n;
+
+		while ( low < high ) {
+			size_t mid = ( low + high + 1 ) / 2;
+
+			if ( fits (begin, mid) )
+				low = mid;
+			else
+				high = mid - 1;
+		}
+
+		bounds.push_back (low);
+	}
+
+	return bounds;
+}
+
+/*
+	Add an entry to the node of levels[level], the node is written first if the entry would take it
+	over fillFactor of the keys a page holds with the layout of its keys and the new key. The entry of a leaf carries the payload
+*/
+inline RETCODE IndexHandle::bulkAppend (std::vector<BulkLevel> & levels, size_t level, const char * key, const RecordIdentifier & rid, double fillFactor) {
+	RETCODE result;
+	BulkLevel * node = &levels[level];
+	size_t prefixLen = 0, longest = attrLen ( );
+	size_t payload = level == 0 ? payloadLen ( ) : 0;
+
+	if ( attrType ( ) == STRING && !node->rids.empty ( ) ) {
+		longest = std::max (node->longest, strnlen (key, attrLen ( )));
+
+		// the keys are sorted, the prefix of all keys is the prefix of the first and the new one
+		while ( prefixLen < node->prefixLen && node->keys[prefixLen] == key[prefixLen] )
+			prefixLen++;
+	}
+
+	size_t share = static_cast< size_t >( fillFactor * BpTreeNode::Capacity (prefixLen, longest - prefixLen, payload) );
+
+	if ( !node->rids.empty ( ) && node->rids.size ( ) + 1 > std::max (share, static_cast< size_t >( 1 )) ) {
+		if ( result = bulkEmit (levels, level, fillFactor, false) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		node = &levels[level];				// levels grows when the first node of a level is written
+	}
+
+	if ( node->rids.empty ( ) ) {
+		node->prefixLen = attrType ( ) == STRING ? strnlen (key, attrLen ( )) : 0;
+		node->longest = attrType ( ) == STRING ? node->prefixLen : attrLen ( );
+	} else {
+		node->prefixLen = prefixLen;
+		node->longest = longest;
+	}
+
+	node->keys.insert (node->keys.end ( ), key, key + attrLen ( ) + payload);
+	node->rids.push_back (rid);
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Write the node of levels[level] to a page and link it after the node before it,
+	the first leaf goes to the page of the empty root. The separator of the node is added to the level above
+	unless the node is the root
+*/
+inline RETCODE IndexHandle::bulkEmit (std::vector<BulkLevel> & levels, size_t level, double fillFactor, bool root) {
+	RETCODE result;
+	BulkLevel & bulk = levels[level];
+	BpTreeNodePtr node;
+
+	if ( level == 0 && bulk.last == nullptr ) {
+		node = FetchNode (header.rootPage);
+		result = node == nullptr ? RETCODE::INVALIDINDEX : RETCODE::COMPLETE;
+	} else {
+		result = NewNode (level == 0, node);
+	}
+
+	if ( result || ( result = node->Load (bulk.keys.data ( ), bulk.rids.data ( ), bulk.rids.size ( )) )
+		 || ( result = bufMgr->MarkDirty (node->GetPageNum ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( root ) {
+		setRoot (node->GetPageNum ( ), level + 1);
+
+		return RETCODE::COMPLETE;
+	}
+
+	// the separator of a leaf only has to tell its keys from the keys of the leaf before it
+	std::vector<char> sep (attrLen ( ));
+
+	if ( bulk.last == nullptr )
+		BpTreeNode::MinKey (attrType ( ), attrLen ( ), sep.data ( ));
+	else if ( level == 0 )
+		BpTreeNode::Separator (attrType ( ), attrLen ( ), bulk.lastKey.data ( ), bulk.keys.data ( ), sep.data ( ));
+	else
+		memcpy (sep.data ( ), bulk.keys.data ( ), attrLen ( ));
+
+	if ( bulk.last != nullptr ) {
+		bulk.last->SetNext (node->GetPageNum ( ));
+		node->SetPrev (bulk.last->GetPageNum ( ));
+
+		if ( result = bufMgr->MarkDirty (bulk.last->GetPageNum ( )) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	bulk.lastKey.assign (bulk.keys.end ( ) - ( level == 0 ? entryLen ( ) : attrLen ( ) ), bulk.keys.end ( ));
+	bulk.last = node;
+	bulk.keys.clear ( );
+	bulk.rids.clear ( );
+
+	if ( levels.size ( ) == level + 1 )
+		levels.emplace_back ( );
+
+	return bulkAppend (levels, level + 1, sep.data ( ), RecordIdentifier{ node->GetPageNum ( ), 0 }, fillFactor);
+}
@@ -3,6 +3,9 @@
 #include "Utils.hpp"
 #include "IndexHandle.hpp"
 #include "IndexScan.hpp"
+#include "HashIndexHandle.hpp"
+#include "HashIndexScan.hpp"
+#include "BitmapIndexHandle.hpp"
 #include "PageFileManager.hpp"
 
 class IndexManager {
@@ -13,18 +16,35 @@ public:
 	RETCODE CreateIndex (const char *fileName,          // Create new index
 											//int        indexNo,
 											AttrType   attrType,
-											int        attrLength);
+											int        attrLength,
+											IndexType  indexType = BTREE_INDEX,
+											size_t     slotsPerPage = 0);		// the rows of a page of the table, BITMAP_INDEX only
+
+	RETCODE CreateIndex (const char *fileName,          // Create a B+ tree index over the attributes of key
+											const CompositeKey & key);
 	
 	RETCODE DestroyIndex (const char *fileName);          // Destroy index
 											
 	RETCODE OpenIndex (const char *fileName,          // Open index
 											//int        indexNo,
 											IndexHandlePtr & indexHandle);
+
+	RETCODE OpenIndex (const char *fileName,          // Open an index created as HASH_INDEX
+											HashIndexHandlePtr & indexHandle);
+
+	RETCODE OpenIndex (const char *fileName,          // Open an index created as BITMAP_INDEX
+											BitmapIndexHandlePtr & indexHandle);
 	
 	RETCODE CloseIndex (const IndexHandlePtr & indexHandle);  // Close index
 
+	RETCODE CloseIndex (const HashIndexHandlePtr & indexHandle);
+
+	RETCODE CloseIndex (const BitmapIndexHandlePtr & indexHandle);
+
 private:
 
+	RETCODE writeHeader (const char * fileName, const void * header, size_t length);		// a new file with only the header page
+
 	PageFileManagerPtr _pfMgr;
 
 };
@@ -32,14 +52,17 @@ private:
 using IndexManagerPtr = shared_ptr<IndexManager>;
 
 IndexManager::IndexManager ( ) {
-	
+	_pfMgr = make_shared<PageFileManager> ( );
 }
 
 IndexManager::~IndexManager ( ) {
 
 }
 
-inline RETCODE IndexManager::CreateIndex (const char * fileName, AttrType attrType, int attrLength) {
+/*
+	Only the header page is written, the handle adds the root or the first bucket when the index is opened first
+*/
+inline RETCODE IndexManager::CreateIndex (const char * fileName, AttrType attrType, int attrLength, IndexType indexType, size_t slotsPerPage) {
 
 	if ( !( attrType == FLOAT || attrType == INT || attrType == STRING ) || fileName == nullptr )
 		return RETCODE::CREATEFAILED;
@@ -47,6 +70,65 @@ inline RETCODE IndexManager::CreateIndex (const char * fileName, AttrType attrTy
 	if ( ( attrType == FLOAT && attrLength != 4 ) || ( attrType == INT && attrLength != 4 ) )
 		return RETCODE::CREATEFAILED;
 
+	if ( indexType == HASH_INDEX ) {
+		HashIndexHeader header;
+		header.attrType = attrType;
+		header.attrLength = attrLength;
+		header.numPages = 1;
+
+		return writeHeader (fileName, &header, sizeof (HashIndexHeader));
+	}
+
+	if ( indexType == BITMAP_INDEX ) {
+		if ( slotsPerPage == 0 )
+			return RETCODE::CREATEFAILED;
+
+		BitmapIndexHeader header;
+		header.attrType = attrType;
+		header.attrLength = attrLength;
+		header.slotsPerPage = slotsPerPage;
+		header.numPages = 1;
+
+		return writeHeader (fileName, &header, sizeof (BitmapIndexHeader));
+	}
+
+	IndexHeader header;
+	header.attrType = attrType;
+	header.attrLength = attrLength;
+	header.numPages = 1;		// must have one header page
+	header.numMaxKeys = BpTreeNode::MaxKeys (attrLength);
+	header.rootPage = -1;
+	header.height = 0;
+
+	return writeHeader (fileName, &header, sizeof (IndexHeader));
+}
+
+/*
+	The keys are COMPOSITE, CREATEFAILED unless the attributes can be encoded and a leaf holds a few keys.
+	attrLength is the part of the key that is compared, the INCLUDE columns are the payload of the leaves
+*/
+inline RETCODE IndexManager::CreateIndex (const char * fileName, const CompositeKey & key) {
+
+	if ( fileName == nullptr || key.Validate ( ) || BpTreeNode::MaxKeys (key.KeyLength ( ), key.Length ( ) - key.KeyLength ( )) < 4 )
+		return RETCODE::CREATEFAILED;
+
+	IndexHeader header;
+	header.attrType = COMPOSITE;
+	header.attrLength = key.KeyLength ( );
+	header.numPages = 1;
+	header.numMaxKeys = BpTreeNode::MaxKeys (key.KeyLength ( ), key.Length ( ) - key.KeyLength ( ));
+	header.rootPage = -1;
+	header.height = 0;
+	header.numColumns = key.NumColumns ( );
+	header.numIncluded = key.NumColumns ( ) - key.NumKeyColumns ( );
+
+	for ( size_t i = 0; i < key.NumColumns ( ); i++ )
+		header.columns[i] = key.Column (i);
+
+	return writeHeader (fileName, &header, sizeof (IndexHeader));
+}
+
+inline RETCODE IndexManager::writeHeader (const char * fileName, const void * header, size_t length) {
 	PageFilePtr pagefile;
 	BufferManagerPtr bufMgr;
 	RETCODE result;
@@ -76,15 +158,7 @@ inline RETCODE IndexManager::CreateIndex (const char * fileName, AttrType attrTy
 		return result;
 	}
 
-	IndexHeader header;
-	header.attrType = attrType;
-	header.attrLength = attrLength;
-	header.numPages = 1;		// must have one header page
-	header.numMaxKeys = ( Utils::PAGESIZE - sizeof (BpTreeNodeHeader) ) / ( sizeof (attrLength) + sizeof (RecordIdentifier) );
-	header.rootPage = -1;
-	header.height = 0;
-
-	memcpy_s (pData, sizeof (IndexHeader), reinterpret_cast< void* >( &header ), sizeof (IndexHeader));
+	memcpy_s (pData, length, header, length);
 
 	PageNum page;
 	headerPage->GetPageNum (page);
@@ -130,6 +204,79 @@ inline RETCODE IndexManager::OpenIndex (const char * fileName, IndexHandlePtr &
 		return result;
 	}
 
+	return result;
+}
+
+inline RETCODE IndexManager::OpenIndex (const char * fileName, HashIndexHandlePtr & indexHandle) {
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( result = _pfMgr->OpenFile (fileName, pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	indexHandle = make_shared<HashIndexHandle> ( );
+
+	if ( result = indexHandle->Open (make_shared<BufferManager> (pageFile)) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE IndexManager::OpenIndex (const char * fileName, BitmapIndexHandlePtr & indexHandle) {
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( result = _pfMgr->OpenFile (fileName, pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	indexHandle = make_shared<BitmapIndexHandle> ( );
+
+	if ( result = indexHandle->Open (make_shared<BufferManager> (pageFile)) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE IndexManager::CloseIndex (const IndexHandlePtr & indexHandle) {
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( indexHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( ( result = indexHandle->ForcePages ( ) ) || ( result = indexHandle->GetPageFilePtr (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = _pfMgr->CloseFile (pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE IndexManager::CloseIndex (const HashIndexHandlePtr & indexHandle) {
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( indexHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( ( result = indexHandle->ForcePages ( ) ) || ( result = indexHandle->GetPageFilePtr (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	if ( result = _pfMgr->CloseFile (pageFile) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
@@ -137,3 +284,34 @@ inline RETCODE IndexManager::OpenIndex (const char * fileName, IndexHandlePtr &
 
 	return result;
 }
+
+inline RETCODE IndexManager::CloseIndex (const BitmapIndexHandlePtr & indexHandle) {
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( indexHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( ( result = indexHandle->ForcePages ( ) ) || ( result = indexHandle->GetPageFilePtr (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = _pfMgr->CloseFile (pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE IndexManager::DestroyIndex (const char * fileName) {
+	RETCODE result;
+
+	if ( result = _pfMgr->DestroyFile (fileName) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
@@ -1,30 +1,384 @@
 #pragma once
 
+/*
+	1. IndexScan goes down the tree once to the leaf of the lower bound and then follows nextNode of the leaves
+	   until the upper bound, every CompOp is a range with open or closed bounds, NE_OP is a full range without the equal keys
+	2. The rids of a leaf in the range are copied when the scan reaches it and no node is held between two calls,
+	   entries inserted into the current leaf after that are not returned, leaves are never merged so nextNode stays valid
+	3. GetNextEntries returns the rids in batches for RecordFile::GetRecs
+	4. A backward scan starts at the leaf of the upper bound and follows prevNode, the entries come in descending order
+	   so that ORDER BY DESC with LIMIT reads only the leaves it returns
+	5. Leaves are read without a lock against the version of IndexHandle, a leaf a writer changed while it was read is read again
+	6. A COMPOSITE index is scanned by a prefix of equal attributes and a range on the next one, that is one range of the encoded keys
+	7. An index-only scan takes the keys and their INCLUDE values with the rids, when the index covers the attributes a query reads
+	   CompositeKey::DecodeRecord gives them back without reading the RecordFile
+*/
+
 #include "Utils.hpp"
 #include "IndexHandle.hpp"
 #include "RecordIdentifier.hpp"
 
+#include <vector>
+
 class IndexScan {
 public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
 	IndexScan ( );
 	~IndexScan ( );
-	
-	RETCODE OpenScan (const IndexHandle & indexHandle, // Initialize index scan
+
+	RETCODE OpenScan (const IndexHandlePtr & indexHandle, // Initialize index scan
 										CompOp compOp,
-										void * value);
-	
+										void * value,
+										bool backward = false);		// from the largest key down
+
+	// the keys between low and high, a nullptr bound does not limit the scan
+	RETCODE OpenScan (const IndexHandlePtr & indexHandle,
+					  void * low, bool lowInclusive,
+					  void * high, bool highInclusive,
+					  bool backward = false);
+
+	// the keys of a COMPOSITE index whose first numEqual attributes are values and whose next one is between low and high
+	RETCODE OpenScan (const IndexHandlePtr & indexHandle,
+					  const void * const * values, size_t numEqual,
+					  void * low, bool lowInclusive,
+					  void * high, bool highInclusive,
+					  bool backward = false);
+
 	RETCODE GetNextEntry (RecordIdentifier & rid);                         // Get next matching entry
-	
+
+	RETCODE GetNextEntries (RecordIdentifier * rids, size_t max, size_t & n);	// Get up to max entries, EOFSCAN if none is left
+
+	RETCODE GetNextEntries (RecordIdentifier * rids, char * keys, size_t max, size_t & n);	// and the key with its INCLUDE values, entryLen bytes each
+
 	RETCODE CloseScan ( );                                 // Terminate index scan
 
 private:
 
-	//std::vector<>
+	RETCODE readLeaf ( );
+
+	void copyKey (void * value, std::vector<char> & key) const;
+
+	IndexHandlePtr _index;
+
+	std::vector<char> _low;					// empty when the scan has no lower bound
+
+	std::vector<char> _high;
+
+	std::vector<char> _skip;				// the key of NE_OP
+
+	bool _lowInclusive;
+
+	bool _highInclusive;
+
+	bool _backward;
+
+	bool _started;							// a leaf had keys past the bound the scan starts from, the next ones only have such keys
+
+	PageNum _nextLeaf;
+
+	std::vector<RecordIdentifier> _rids;	// the entries of the current leaf in the range
+
+	std::vector<char> _keys;				// the keys of _rids for an index-only scan
+
+	bool _withKeys;
+
+	size_t _pos;
+
+	ScanState _state;
 
 };
 
 IndexScan::IndexScan ( ) {
+	_state = ScanState::Close;
+	_index = nullptr;
+	_withKeys = false;
+	_pos = 0;
 }
 
 IndexScan::~IndexScan ( ) {
 }
+
+inline RETCODE IndexScan::OpenScan (const IndexHandlePtr & indexHandle, CompOp compOp, void * value, bool backward) {
+
+	if ( value == nullptr || compOp == NO_OP )
+		return OpenScan (indexHandle, nullptr, false, nullptr, false, backward);
+
+	switch ( compOp ) {
+	case EQ_OP:
+		return OpenScan (indexHandle, value, true, value, true, backward);
+	case LT_OP:
+		return OpenScan (indexHandle, nullptr, false, value, false, backward);
+	case GT_OP:
+		return OpenScan (indexHandle, value, false, nullptr, false, backward);
+	case LE_OP:
+		return OpenScan (indexHandle, nullptr, false, value, true, backward);
+	case GE_OP:
+		return OpenScan (indexHandle, value, true, nullptr, false, backward);
+	case NE_OP:
+		break;
+	default:
+		return RETCODE::INVALIDSCAN;
+	}
+
+	RETCODE result;
+
+	if ( result = OpenScan (indexHandle, nullptr, false, nullptr, false, backward) )
+		return result;
+
+	copyKey (value, _skip);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE IndexScan::OpenScan (const IndexHandlePtr & indexHandle, void * low, bool lowInclusive, void * high, bool highInclusive, bool backward) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( indexHandle == nullptr || !indexHandle->IsValid ( ) )
+		return RETCODE::INVALIDINDEX;
+
+	_index = indexHandle;
+	copyKey (low, _low);
+	copyKey (high, _high);
+	_skip.clear ( );
+	_lowInclusive = lowInclusive;
+	_highInclusive = highInclusive;
+	_backward = backward;
+	_started = false;
+	_rids.clear ( );
+	_keys.clear ( );
+	_withKeys = false;
+	_pos = 0;
+
+	BpTreeNodePtr leaf;
+
+	// the keys equal to a closed upper bound may go on after the leaf where they start
+	if ( !backward )
+		leaf = _index->FindLeaf (low == nullptr ? nullptr : _low.data ( ));
+	else if ( high == nullptr || highInclusive )
+		leaf = _index->FindLastLeaf (high == nullptr ? nullptr : _high.data ( ));
+	else
+		leaf = _index->FindLeaf (_high.data ( ));
+
+	if ( leaf == nullptr ) {
+		_index = nullptr;
+		return RETCODE::INVALIDINDEX;
+	}
+
+	_nextLeaf = leaf->GetPageNum ( );
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The values are attribute values, not encoded, CompositeKey::Bounds turns them into the two keys of the range
+*/
+inline RETCODE IndexScan::OpenScan (const IndexHandlePtr & indexHandle, const void * const * values, size_t numEqual,
+									void * low, bool lowInclusive, void * high, bool highInclusive, bool backward) {
+
+	if ( indexHandle == nullptr || !indexHandle->IsValid ( ) || indexHandle->attrType ( ) != COMPOSITE )
+		return RETCODE::INVALIDINDEX;
+
+	const CompositeKey & key = indexHandle->KeyColumns ( );
+
+	// INCLUDE columns do not limit the scan
+	if ( numEqual > key.NumKeyColumns ( ) || ( numEqual > 0 && values == nullptr ) )
+		return RETCODE::BADATTR;
+
+	if ( numEqual == key.NumKeyColumns ( ) && ( low != nullptr || high != nullptr ) )
+		return RETCODE::BADATTR;
+
+	std::vector<char> lowKey, highKey;
+
+	key.Bounds (values, numEqual, low, lowInclusive, high, highInclusive, lowKey, highKey);
+
+	return OpenScan (indexHandle, lowKey.data ( ), low == nullptr || lowInclusive, highKey.data ( ), high == nullptr || highInclusive, backward);
+}
+
+inline RETCODE IndexScan::GetNextEntry (RecordIdentifier & rid) {
+	size_t n;
+
+	return GetNextEntries (&rid, 1, n);
+}
+
+inline RETCODE IndexScan::GetNextEntries (RecordIdentifier * rids, size_t max, size_t & n) {
+	return GetNextEntries (rids, nullptr, max, n);
+}
+
+/*
+	The keys are copied from the first call that asks for them on, a scan that has returned
+	part of a leaf without them cannot take them any more
+*/
+inline RETCODE IndexScan::GetNextEntries (RecordIdentifier * rids, char * keys, size_t max, size_t & n) {
+	RETCODE result;
+
+	n = 0;
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open || rids == nullptr )
+		return RETCODE::INVALIDSCAN;
+
+	if ( keys != nullptr && !_withKeys ) {
+		if ( _pos < _rids.size ( ) )
+			return RETCODE::INVALIDSCAN;
+
+		_withKeys = true;
+	}
+
+	size_t entryLen = _index->entryLen ( );
+
+	while ( n < max ) {
+		if ( _pos == _rids.size ( ) ) {
+			result = readLeaf ( );
+
+			if ( result == RETCODE::EOFSCAN )
+				break;
+
+			if ( result ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+		}
+
+		size_t count = std::min (max - n, _rids.size ( ) - _pos);
+
+		std::copy (_rids.begin ( ) + _pos, _rids.begin ( ) + _pos + count, rids + n);
+
+		if ( keys != nullptr )
+			memcpy (keys + n * entryLen, _keys.data ( ) + _pos * entryLen, count * entryLen);
+
+		_pos += count;
+		n += count;
+	}
+
+	return n > 0 ? RETCODE::COMPLETE : RETCODE::EOFSCAN;
+}
+
+inline RETCODE IndexScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_index = nullptr;
+	_rids.clear ( );
+	_keys.clear ( );
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Copy the entries of the next leaves in the range until one leaf has any, the leaf is released before returning.
+	The leaf where the keys pass the bound the scan ends at is the last one.
+	A leaf is read without a lock, when a writer changed it meanwhile it is read again
+*/
+inline RETCODE IndexScan::readLeaf ( ) {
+	RETCODE result;
+
+	_rids.clear ( );
+	_keys.clear ( );
+	_pos = 0;
+
+	while ( _rids.empty ( ) ) {
+		if ( _nextLeaf == Utils::UNKNOWNPAGENUM ) {
+			_state = End;
+			return RETCODE::EOFSCAN;
+		}
+
+		BpTreeNodePtr leaf;
+		uint64_t version;
+
+		if ( result = _index->readNode (_nextLeaf, leaf, version) )
+			return result;
+
+		if ( leaf == nullptr )
+			continue;
+
+		size_t begin = 0, end = leaf->GetNumKeys ( );
+		bool started = _started;
+		PageNum next;
+
+		if ( !_backward ) {
+			// the keys equal to an open lower bound may fill several leaves
+			if ( !_low.empty ( ) && !started )
+				begin = _lowInclusive ? leaf->LowerBound (_low.data ( )) : leaf->UpperBound (_low.data ( ));
+
+			started = started || begin < end;
+			next = leaf->GetNext ( );
+
+			if ( !_high.empty ( ) ) {
+				size_t stop = _highInclusive ? leaf->UpperBound (_high.data ( )) : leaf->LowerBound (_high.data ( ));
+
+				if ( stop < end ) {
+					end = std::max (stop, begin);
+					next = Utils::UNKNOWNPAGENUM;
+				}
+			}
+		} else {
+			if ( !_high.empty ( ) && !started )
+				end = _highInclusive ? leaf->UpperBound (_high.data ( )) : leaf->LowerBound (_high.data ( ));
+
+			started = started || begin < end;
+			next = leaf->GetPrev ( );
+
+			if ( !_low.empty ( ) ) {
+				size_t stop = _lowInclusive ? leaf->LowerBound (_low.data ( )) : leaf->UpperBound (_low.data ( ));
+
+				if ( stop > 0 ) {
+					begin = std::min (stop, end);
+					next = Utils::UNKNOWNPAGENUM;
+				}
+			}
+		}
+
+		size_t skipBegin = end, skipEnd = end;
+
+		if ( !_skip.empty ( ) ) {
+			skipBegin = std::max (leaf->LowerBound (_skip.data ( )), begin);
+			skipEnd = std::max (leaf->UpperBound (_skip.data ( )), skipBegin);
+		}
+
+		for ( size_t i = begin; i < end; i++ ) {
+			size_t pos = _backward ? begin + end - 1 - i : i;
+
+			if ( pos < skipBegin || pos >= skipEnd ) {
+				_rids.push_back (leaf->GetRid (pos));
+
+				if ( _withKeys ) {
+					_keys.resize (_rids.size ( ) * _index->entryLen ( ));
+					leaf->CopyEntryTo (pos, _keys.data ( ) + ( _rids.size ( ) - 1 ) * _index->entryLen ( ));
+				}
+			}
+		}
+
+		if ( !_index->validate (_nextLeaf, version) ) {
+			_rids.clear ( );
+			_keys.clear ( );
+			continue;
+		}
+
+		_started = started;
+		_nextLeaf = next;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	A STRING value may be shorter than the attribute, it is copied up to its '\0'
+*/
+inline void IndexScan::copyKey (void * value, std::vector<char> & key) const {
+	key.clear ( );
+
+	if ( value == nullptr )
+		return;
+
+	const char * chars = reinterpret_cast< const char* >( value );
+	size_t length = _index->attrType ( ) == STRING ? strnlen (chars, _index->attrLen ( )) : _index->attrLen ( );
+
+	key.assign (_index->attrLen ( ), 0);
+	memcpy (key.data ( ), chars, length);
+}
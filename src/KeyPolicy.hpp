@@ -0,0 +1,204 @@
+#pragma once
+
+/*
+	1. A key policy tells how the keys of an index compare, the searches of BpTreeNode are templates over the policy
+	   so that the comparison is inlined instead of called through CompMethod
+	2. The policy is chosen once per search from the AttrType of the node, every node of an index has the AttrType of IndexHeader
+	3. BytesKeyPolicy compares with memcmp, it is used for keys encoded to be memcmp comparable (composite keys)
+	4. A policy searches the last WINDOW keys of a binary search by counting, INT and FLOAT count 8 keys per AVX2 instruction
+	   when the build targets AVX2, otherwise 8 keys per step with two SSE2 instructions
+*/
+
+#include "Utils.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define MICROSQL_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define MICROSQL_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace KeySearch {
+
+#if defined(MICROSQL_AVX2)
+	const size_t SIMDWINDOW = 32;			// keys counted after the binary search, 4 AVX2 steps
+#else
+	const size_t SIMDWINDOW = 16;
+#endif
+
+	inline size_t MaskBits (unsigned int mask) {			// number of bits set in an 8 bit movemask
+		mask = mask - ( ( mask >> 1 ) & 0x55 );
+		mask = ( mask & 0x33 ) + ( ( mask >> 2 ) & 0x33 );
+		return ( mask + ( mask >> 4 ) ) & 0x0F;
+	}
+
+	/*
+		Number of the n keys below key (Upper: not above key), one comparison per key
+	*/
+	template <class Policy, bool Upper>
+	size_t CountScalar (const char * keys, size_t n, size_t length, const void * key) {
+		size_t count = 0;
+
+		for ( size_t i = 0; i < n; i++ )
+			count += Upper ? !Policy::Less (key, keys + i * length, length) : Policy::Less (keys + i * length, key, length);
+
+		return count;
+	}
+
+}
+
+struct IntKeyPolicy {
+	static const size_t WINDOW = KeySearch::SIMDWINDOW;
+
+	static bool Less (const void * a, const void * b, size_t) {
+		return *reinterpret_cast< const int* >( a ) < *reinterpret_cast< const int* >( b );
+	}
+
+	static int Compare (const void * a, const void * b, size_t) {
+		int x = *reinterpret_cast< const int* >( a ), y = *reinterpret_cast< const int* >( b );
+		return ( x > y ) - ( x < y );
+	}
+
+	template <bool Upper>
+	static size_t Count (const char * keys, size_t n, size_t length, const void * key) {
+		size_t count = 0, i = 0;
+		// Upper counts the keys not greater than value, 8 minus the keys greater than value
+#if defined(MICROSQL_AVX2)
+		__m256i value = _mm256_set1_epi32 (*reinterpret_cast< const int* >( key ));
+
+		for ( ; i + 8 <= n; i += 8 ) {
+			__m256i block = _mm256_loadu_si256 (reinterpret_cast< const __m256i* >( keys + i * sizeof (int) ));
+			__m256i mask = Upper ? _mm256_cmpgt_epi32 (block, value) : _mm256_cmpgt_epi32 (value, block);
+			size_t bits = KeySearch::MaskBits (static_cast< unsigned int >( _mm256_movemask_ps (_mm256_castsi256_ps (mask)) ));
+
+			count += Upper ? 8 - bits : bits;
+		}
+#elif defined(MICROSQL_SSE2)
+		__m128i value = _mm_set1_epi32 (*reinterpret_cast< const int* >( key ));
+
+		for ( ; i + 8 <= n; i += 8 ) {
+			__m128i low = _mm_loadu_si128 (reinterpret_cast< const __m128i* >( keys + i * sizeof (int) ));
+			__m128i high = _mm_loadu_si128 (reinterpret_cast< const __m128i* >( keys + ( i + 4 ) * sizeof (int) ));
+			__m128i lowMask = Upper ? _mm_cmpgt_epi32 (low, value) : _mm_cmplt_epi32 (low, value);
+			__m128i highMask = Upper ? _mm_cmpgt_epi32 (high, value) : _mm_cmplt_epi32 (high, value);
+			size_t bits = KeySearch::MaskBits (static_cast< unsigned int >( _mm_movemask_ps (_mm_castsi128_ps (lowMask))
+																		  | _mm_movemask_ps (_mm_castsi128_ps (highMask)) << 4 ));
+
+			count += Upper ? 8 - bits : bits;
+		}
+#endif
+		return count + KeySearch::CountScalar<IntKeyPolicy, Upper> (keys + i * length, n - i, length, key);
+	}
+};
+
+struct FloatKeyPolicy {
+	static const size_t WINDOW = KeySearch::SIMDWINDOW;
+
+	static bool Less (const void * a, const void * b, size_t) {
+		return *reinterpret_cast< const float* >( a ) < *reinterpret_cast< const float* >( b );
+	}
+
+	static int Compare (const void * a, const void * b, size_t) {
+		float x = *reinterpret_cast< const float* >( a ), y = *reinterpret_cast< const float* >( b );
+		return ( x > y ) - ( x < y );
+	}
+
+	template <bool Upper>
+	static size_t Count (const char * keys, size_t n, size_t length, const void * key) {
+		size_t count = 0, i = 0;
+#if defined(MICROSQL_AVX2)
+		__m256 value = _mm256_set1_ps (*reinterpret_cast< const float* >( key ));
+
+		for ( ; i + 8 <= n; i += 8 ) {
+			__m256 block = _mm256_loadu_ps (reinterpret_cast< const float* >( keys + i * sizeof (float) ));
+			__m256 mask = Upper ? _mm256_cmp_ps (block, value, _CMP_LE_OQ) : _mm256_cmp_ps (block, value, _CMP_LT_OQ);
+
+			count += KeySearch::MaskBits (static_cast< unsigned int >( _mm256_movemask_ps (mask) ));
+		}
+#elif defined(MICROSQL_SSE2)
+		__m128 value = _mm_set1_ps (*reinterpret_cast< const float* >( key ));
+
+		for ( ; i + 8 <= n; i += 8 ) {
+			__m128 low = _mm_loadu_ps (reinterpret_cast< const float* >( keys + i * sizeof (float) ));
+			__m128 high = _mm_loadu_ps (reinterpret_cast< const float* >( keys + ( i + 4 ) * sizeof (float) ));
+			__m128 lowMask = Upper ? _mm_cmple_ps (low, value) : _mm_cmplt_ps (low, value);
+			__m128 highMask = Upper ? _mm_cmple_ps (high, value) : _mm_cmplt_ps (high, value);
+
+			count += KeySearch::MaskBits (static_cast< unsigned int >( _mm_movemask_ps (lowMask) | _mm_movemask_ps (highMask) << 4 ));
+		}
+#endif
+		return count + KeySearch::CountScalar<FloatKeyPolicy, Upper> (keys + i * length, n - i, length, key);
+	}
+};
+
+struct StringKeyPolicy {			// same order as CompMethod::compare_string
+	static const size_t WINDOW = 0;
+
+	static bool Less (const void * a, const void * b, size_t length) {
+		return Compare (a, b, length) < 0;
+	}
+
+	static int Compare (const void * a, const void * b, size_t length) {
+		return strncmp (reinterpret_cast< const char* >( a ), reinterpret_cast< const char* >( b ), length);
+	}
+
+	template <bool Upper>
+	static size_t Count (const char * keys, size_t n, size_t length, const void * key) {
+		return KeySearch::CountScalar<StringKeyPolicy, Upper> (keys, n, length, key);
+	}
+};
+
+struct BytesKeyPolicy {
+	static const size_t WINDOW = 0;
+
+	static bool Less (const void * a, const void * b, size_t length) {
+		return memcmp (a, b, length) < 0;
+	}
+
+	static int Compare (const void * a, const void * b, size_t length) {
+		return memcmp (a, b, length);
+	}
+
+	template <bool Upper>
+	static size_t Count (const char * keys, size_t n, size_t length, const void * key) {
+		return KeySearch::CountScalar<BytesKeyPolicy, Upper> (keys, n, length, key);
+	}
+};
+
+namespace KeySearch {
+
+	/*
+		Position of the first of n keys of length bytes for which below (key) is false, the keys are sorted.
+		The loop has no branch on the comparison, the compiler turns it into conditional moves,
+		the last Policy::WINDOW keys are counted by the policy
+	*/
+	template <class Policy, bool Upper>
+	size_t Bound (const char * keys, size_t n, size_t length, const void * key) {
+		size_t low = 0;
+
+		while ( n > Policy::WINDOW ) {
+			size_t half = n / 2;
+			const char * mid = keys + ( low + half ) * length;
+			bool below = Upper ? !Policy::Less (key, mid, length) : Policy::Less (mid, key, length);
+
+			low = below ? low + half + 1 : low;
+			n = below ? n - half - 1 : half;
+		}
+
+		return low + Policy::template Count<Upper> (keys + low * length, n, length, key);
+	}
+
+	template <class Policy>
+	size_t LowerBound (const char * keys, size_t n, size_t length, const void * key) {
+		return Bound<Policy, false> (keys, n, length, key);
+	}
+
+	template <class Policy>
+	size_t UpperBound (const char * keys, size_t n, size_t length, const void * key) {
+		return Bound<Policy, true> (keys, n, length, key);
+	}
+
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+/*
+	1. MemoryTable holds the rows of a MEMORY_ENGINE table, nothing goes through PageFile or BufferManager
+	   and the rows are lost when the database is closed, the application rebuilds them on startup
+	2. Rows live in an arena of blocks aligned to Utils::CACHELINESIZE, a row smaller than a cache line
+	   never crosses a cache line boundary, RecordIdentifier{ block, slot } locates a row
+	3. A table with a primary key keeps a hash index from the key to the row for point lookups
+*/
+
+#include "Utils.hpp"
+#include "Record.hpp"
+#include "RecordIdentifier.hpp"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MemoryTable {
+
+	friend class MemoryTableScan;
+
+public:
+
+	const static size_t BLOCKSIZE = 64 * 1024;
+
+	MemoryTable ( );
+	~MemoryTable ( );
+
+	RETCODE Open (size_t recordSize);									// table without a primary key
+
+	RETCODE Open (size_t recordSize, int keyOffset, AttrType keyType, int keyLength);
+
+	RETCODE InsertRec (const char *pData, RecordIdentifier &rid);		// ENTRYEXISTS if the key is used
+
+	RETCODE DeleteRec (const RecordIdentifier &rid);
+
+	RETCODE UpdateRec (const Record &rec);
+
+	RETCODE GetRec (const RecordIdentifier &rid, Record &rec) const;
+
+	RETCODE FindRec (const void *key, Record &rec) const;				// point lookup on the primary key
+
+	RETCODE FindRec (const void *key, RecordIdentifier &rid) const;
+
+	RETCODE Clear ( );
+
+	bool isValidRecordFile ( ) const;
+
+	bool hasKey ( ) const;
+
+	size_t recordSize ( ) const;
+
+	size_t numRecords ( ) const;
+
+	/*
+		Static Functions
+	*/
+	static size_t RowStride (size_t recordSize);			// bytes between two rows of a block
+
+private:
+
+	RETCODE locate (const RecordIdentifier &rid, size_t &row) const;
+
+	RETCODE findRow (const void *key, size_t &row) const;
+
+	std::string keyOf (const void *key) const;
+
+	char * rowAt (size_t row) const;
+
+	RecordIdentifier ridOf (size_t row) const;
+
+	size_t _recordSize;
+
+	size_t _stride;
+
+	size_t _rowsPerBlock;
+
+	int _keyOffset;					// -1 without a primary key
+
+	AttrType _keyType;
+
+	int _keyLength;
+
+	std::vector<std::unique_ptr<char[]>> _blocks;
+
+	std::vector<char*> _blockData;		// first aligned byte of every block
+
+	std::vector<bool> _used;			// one flag per row
+
+	std::vector<size_t> _freeRows;
+
+	size_t _numRecords;
+
+	std::unordered_map<std::string, size_t> _index;		// primary key -> row
+
+	mutable std::shared_mutex _mutex;
+
+};
+
+using MemoryTablePtr = shared_ptr<MemoryTable>;
+
+MemoryTable::MemoryTable ( ) {
+	_recordSize = 0;
+	_stride = 0;
+	_rowsPerBlock = 0;
+	_keyOffset = -1;
+	_keyType = INT;
+	_keyLength = 0;
+	_numRecords = 0;
+}
+
+MemoryTable::~MemoryTable ( ) {
+
+}
+
+inline RETCODE MemoryTable::Open (size_t recordSize) {
+	if ( _recordSize != 0 )
+		return RETCODE::FILEOPEN;
+
+	if ( recordSize == 0 || recordSize > BLOCKSIZE )
+		return RETCODE::INVALIDOPEN;
+
+	_recordSize = recordSize;
+	_stride = RowStride (recordSize);
+	_rowsPerBlock = BLOCKSIZE / _stride;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::Open (size_t recordSize, int keyOffset, AttrType keyType, int keyLength) {
+	RETCODE result;
+
+	if ( keyOffset < 0 || keyLength <= 0 || static_cast< size_t >( keyOffset + keyLength ) > recordSize
+		 || ( keyType != INT && keyType != FLOAT && keyType != STRING ) )
+		return RETCODE::INVALIDOPEN;
+
+	if ( result = Open (recordSize) )
+		return result;
+
+	_keyOffset = keyOffset;
+	_keyType = keyType;
+	_keyLength = keyLength;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::InsertRec (const char * pData, RecordIdentifier & rid) {
+	std::unique_lock<std::shared_mutex> guard (_mutex);
+
+	if ( !isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	if ( pData == nullptr )
+		return RETCODE::BADRECORD;
+
+	std::string key;
+
+	if ( hasKey ( ) ) {
+		key = keyOf (pData + _keyOffset);
+
+		if ( _index.find (key) != _index.end ( ) )
+			return RETCODE::ENTRYEXISTS;
+	}
+
+	if ( _freeRows.empty ( ) ) {			// add a block, its rows are used from the lowest one
+		std::unique_ptr<char[]> block (new char[BLOCKSIZE + Utils::CACHELINESIZE]);
+		size_t misalign = reinterpret_cast< uintptr_t >( block.get ( ) ) % Utils::CACHELINESIZE;
+
+		_blockData.push_back (block.get ( ) + ( misalign ? Utils::CACHELINESIZE - misalign : 0 ));
+		_blocks.push_back (std::move (block));
+		_used.resize (_blocks.size ( ) * _rowsPerBlock, false);
+
+		for ( size_t row = _blocks.size ( ) * _rowsPerBlock; row > ( _blocks.size ( ) - 1 ) * _rowsPerBlock; row-- )
+			_freeRows.push_back (row - 1);
+	}
+
+	size_t row = _freeRows.back ( );
+	_freeRows.pop_back ( );
+
+	memcpy_s (rowAt (row), _recordSize, pData, _recordSize);
+	_used[row] = true;
+	_numRecords++;
+
+	if ( hasKey ( ) )
+		_index.emplace (std::move (key), row);
+
+	rid = ridOf (row);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::DeleteRec (const RecordIdentifier & rid) {
+	std::unique_lock<std::shared_mutex> guard (_mutex);
+	RETCODE result;
+	size_t row;
+
+	if ( result = locate (rid, row) )
+		return result;
+
+	if ( hasKey ( ) )
+		_index.erase (keyOf (rowAt (row) + _keyOffset));
+
+	_used[row] = false;
+	_freeRows.push_back (row);
+	_numRecords--;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::UpdateRec (const Record & rec) {
+	std::unique_lock<std::shared_mutex> guard (_mutex);
+	RETCODE result;
+	RecordIdentifier rid;
+	char * pData;
+	size_t size;
+	size_t row;
+
+	if ( ( result = rec.GetIdentifier (rid) ) || ( result = rec.GetData (pData) ) || ( result = rec.GetSize (size) ) )
+		return result;
+
+	if ( size != _recordSize )
+		return RETCODE::BADRECORD;
+
+	if ( result = locate (rid, row) )
+		return result;
+
+	if ( hasKey ( ) ) {					// a changed key moves the index entry
+		std::string oldKey = keyOf (rowAt (row) + _keyOffset);
+		std::string newKey = keyOf (pData + _keyOffset);
+
+		if ( oldKey != newKey ) {
+			if ( _index.find (newKey) != _index.end ( ) )
+				return RETCODE::ENTRYEXISTS;
+
+			_index.erase (oldKey);
+			_index.emplace (std::move (newKey), row);
+		}
+	}
+
+	memcpy_s (rowAt (row), _recordSize, pData, _recordSize);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::GetRec (const RecordIdentifier & rid, Record & rec) const {
+	std::shared_lock<std::shared_mutex> guard (_mutex);
+	RETCODE result;
+	size_t row;
+
+	if ( result = locate (rid, row) )
+		return result;
+
+	rec = Record (rid, rowAt (row), _recordSize);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::FindRec (const void * key, Record & rec) const {
+	std::shared_lock<std::shared_mutex> guard (_mutex);
+	RETCODE result;
+	size_t row;
+
+	if ( result = findRow (key, row) )
+		return result;
+
+	rec = Record (ridOf (row), rowAt (row), _recordSize);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::FindRec (const void * key, RecordIdentifier & rid) const {
+	std::shared_lock<std::shared_mutex> guard (_mutex);
+	RETCODE result;
+	size_t row;
+
+	if ( result = findRow (key, row) )
+		return result;
+
+	rid = ridOf (row);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTable::Clear ( ) {
+	std::unique_lock<std::shared_mutex> guard (_mutex);
+
+	_blocks.clear ( );
+	_blockData.clear ( );
+	_used.clear ( );
+	_freeRows.clear ( );
+	_index.clear ( );
+	_numRecords = 0;
+
+	return RETCODE::COMPLETE;
+}
+
+inline bool MemoryTable::isValidRecordFile ( ) const {
+	return _recordSize != 0;
+}
+
+inline bool MemoryTable::hasKey ( ) const {
+	return _keyOffset >= 0;
+}
+
+inline size_t MemoryTable::recordSize ( ) const {
+	return _recordSize;
+}
+
+inline size_t MemoryTable::numRecords ( ) const {
+	std::shared_lock<std::shared_mutex> guard (_mutex);
+	return _numRecords;
+}
+
+/*
+	Rows smaller than a cache line are padded to a power of two so that a cache line holds whole rows,
+	larger rows start at a cache line boundary
+*/
+inline size_t MemoryTable::RowStride (size_t recordSize) {
+	if ( recordSize >= Utils::CACHELINESIZE )
+		return ( recordSize + Utils::CACHELINESIZE - 1 ) / Utils::CACHELINESIZE * Utils::CACHELINESIZE;
+
+	size_t stride = sizeof (int);
+
+	while ( stride < recordSize )
+		stride *= 2;
+
+	return stride;
+}
+
+inline RETCODE MemoryTable::locate (const RecordIdentifier & rid, size_t & row) const {
+	PageNum block;
+	SlotNum slot;
+
+	if ( !isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	rid.GetPageNum (block);
+	rid.GetSlotNum (slot);
+
+	if ( block >= _blocks.size ( ) || slot >= _rowsPerBlock )
+		return RETCODE::RECORDNOTFOUND;
+
+	row = block * _rowsPerBlock + slot;
+
+	return _used[row] ? RETCODE::COMPLETE : RETCODE::RECORDNOTFOUND;
+}
+
+inline RETCODE MemoryTable::findRow (const void * key, size_t & row) const {
+	if ( !isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	if ( !hasKey ( ) || key == nullptr )
+		return RETCODE::BADKEY;
+
+	auto it = _index.find (keyOf (key));
+
+	if ( it == _index.end ( ) )
+		return RETCODE::RECORDNOTFOUND;
+
+	row = it->second;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The bytes of the key as the index stores them, a STRING ends at its first '\0' and -0.0 is stored as 0.0
+	so that keys equal by CompMethod::equal are equal here
+*/
+inline std::string MemoryTable::keyOf (const void * key) const {
+	const char * chars = reinterpret_cast< const char* >( key );
+
+	if ( _keyType == STRING )
+		return std::string (chars, strnlen (chars, _keyLength));
+
+	if ( _keyType == FLOAT && *reinterpret_cast< const float* >( key ) == 0.0f ) {
+		float zero = 0.0f;
+		return std::string (reinterpret_cast< const char* >( &zero ), sizeof (float));
+	}
+
+	return std::string (chars, _keyLength);
+}
+
+inline char * MemoryTable::rowAt (size_t row) const {
+	return _blockData[row / _rowsPerBlock] + row % _rowsPerBlock * _stride;
+}
+
+inline RecordIdentifier MemoryTable::ridOf (size_t row) const {
+	return RecordIdentifier{ static_cast< PageNum >( row / _rowsPerBlock ), static_cast< SlotNum >( row % _rowsPerBlock ) };
+}
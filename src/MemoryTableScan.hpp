@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+	1. MemoryTableScan scans a MemoryTable with the same interface as RecordFileScan
+	2. EQ_OP on the primary key is answered by the hash index, other conditions read every row in block order
+*/
+
+#include "Utils.hpp"
+#include "MemoryTable.hpp"
+
+class MemoryTableScan {
+public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	MemoryTableScan ( );
+	~MemoryTableScan ( );
+
+	RETCODE OpenScan (const MemoryTablePtr &table,     // Initialize table scan
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value);
+
+	RETCODE GetNextRec (Record &rec);                  // Get next matching record
+
+	RETCODE CloseScan ( );                                // Terminate table scan
+
+private:
+
+	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	Comparator _comp;
+
+	MemoryTablePtr _table;
+
+	AttrType _attrType;
+
+	size_t _attrLength;
+
+	size_t _attrOffset;
+
+	std::vector<char> _attrValue;
+
+	bool _lookup;						// EQ_OP on the primary key
+
+	size_t _currentRow;
+
+	ScanState _state;
+
+};
+
+MemoryTableScan::MemoryTableScan ( ) {
+	_state = ScanState::Close;
+	_comp = nullptr;
+	_table = nullptr;
+	_lookup = false;
+}
+
+MemoryTableScan::~MemoryTableScan ( ) {
+
+}
+
+inline RETCODE MemoryTableScan::OpenScan (const MemoryTablePtr & table, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( table == nullptr || !table->isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	_table = table;
+	_comp = nullptr;
+	_lookup = false;
+
+	if ( value != nullptr && compOp != NO_OP ) {			// has condition
+
+		if ( attrType != AttrType::INT && attrType != AttrType::FLOAT && attrType != AttrType::STRING )
+			return RETCODE::INVALIDSCAN;
+
+		if ( attrOffset + attrLength > _table->recordSize ( ) )
+			return RETCODE::INVALIDSCAN;
+
+		switch ( compOp ) {
+		case EQ_OP:
+			_comp = CompMethod::equal;
+			break;
+		case LT_OP:
+			_comp = CompMethod::less_than;
+			break;
+		case GT_OP:
+			_comp = CompMethod::greater_than;
+			break;
+		case LE_OP:
+			_comp = CompMethod::less_than_or_eq_to;
+			break;
+		case GE_OP:
+			_comp = CompMethod::greater_than_or_eq_to;
+			break;
+		case NE_OP:
+			_comp = CompMethod::not_equal;
+			break;
+		default:
+			return RETCODE::INVALIDSCAN;
+		}
+
+		_attrType = attrType;
+		_attrLength = attrLength;
+		_attrOffset = attrOffset;
+		_attrValue.assign (reinterpret_cast< char* >( value ), reinterpret_cast< char* >( value ) + attrLength);
+
+		_lookup = compOp == EQ_OP && _table->hasKey ( ) && static_cast< size_t >( _table->_keyOffset ) == attrOffset
+			&& _table->_keyType == attrType && static_cast< size_t >( _table->_keyLength ) == attrLength;
+	}
+
+	_currentRow = 0;
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE MemoryTableScan::GetNextRec (Record & rec) {
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( _lookup ) {				// at most one row has the key
+		RETCODE result = _table->FindRec (_attrValue.data ( ), rec);
+
+		_state = End;
+
+		return result == RETCODE::RECORDNOTFOUND ? RETCODE::EOFSCAN : result;
+	}
+
+	std::shared_lock<std::shared_mutex> guard (_table->_mutex);
+
+	while ( _currentRow < _table->_used.size ( ) ) {
+		size_t row = _currentRow++;
+
+		if ( !_table->_used[row] )
+			continue;
+
+		char * pData = _table->rowAt (row);
+
+		if ( _comp == nullptr || _comp (pData + _attrOffset, _attrValue.data ( ), _attrType, _attrLength) ) {
+			rec = Record (_table->ridOf (row), pData, _table->recordSize ( ));
+			return RETCODE::COMPLETE;
+		}
+	}
+
+	_state = End;
+
+	return RETCODE::EOFSCAN;
+}
+
+inline RETCODE MemoryTableScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_table = nullptr;
+
+	return RETCODE::COMPLETE;
+}
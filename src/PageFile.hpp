@@ -49,6 +49,8 @@ private:
 	// Get the previous page
 	RETCODE GetThisPage (PageNum pageNum, PagePtr &pageHandle) ;
 	// Get a specific page
+	RETCODE ReadThisPage (PageNum pageNum, PagePtr &pageHandle) const;
+	// Read a page through its own stream, may run in several threads at once
 	RETCODE AllocatePage (PagePtr &pageHandle);				     // Allocate a new page
 	RETCODE DisposePage (PageNum pageNum);                   // Dispose of a page 
 	RETCODE ForcePage (PageNum page, const PagePtr & pageHande);
@@ -130,35 +132,40 @@ inline RETCODE PageFile::GetPrevPage (PageNum current, PagePtr & pageHandle) {
 */
 inline RETCODE PageFile::GetThisPage (PageNum pageNum, PagePtr & pageHandle) {
 
-	RETCODE result = RETCODE::COMPLETE;
-
-	if ( !IsOpen ( ) )
-		this->OpenRead ( );
-
 	if ( pageNum >= header.pageCount )
 		return RETCODE::EOFFILE;
 
 	if ( pageNum < 1 )
 		return RETCODE::INVALIDPAGE;
 
+	return ReadThisPage (pageNum, pageHandle);
+}
+
+/*
+	Does not touch _stream or header, so the BufferManager can call it without holding its lock
+	The caller checks pageNum against the page count
+*/
+inline RETCODE PageFile::ReadThisPage (PageNum pageNum, PagePtr & pageHandle) const {
+
+	RETCODE result = RETCODE::COMPLETE;
+
+	std::ifstream stream (this->_filename, std::ios::binary | std::ios::in);
+
 	size_t offset = static_cast< size_t >( pageNum * PAGESIZEACTUAL );	// the first page is used 
 
-	_stream.seekg (offset , std::ios::beg);
+	stream.seekg (offset , std::ios::beg);
 
 	pageHandle = make_shared<Page> ( );
 
 	pageHandle->Create (pageNum);
 
-	_stream.read (pageHandle->_pData.get(), PAGESIZEACTUAL);
+	stream.read (pageHandle->_pData.get(), PAGESIZEACTUAL);
 
-	if ( _stream.gcount ( ) != PAGESIZEACTUAL ) {
-		Utils::PrintRetcode (RETCODE::INCOMPLETEREAD, __FUNCTION__, __LINE__, std::to_string(_stream.gcount ( )));
+	if ( stream.gcount ( ) != PAGESIZEACTUAL ) {
+		Utils::PrintRetcode (RETCODE::INCOMPLETEREAD, __FUNCTION__, __LINE__, std::to_string(stream.gcount ( )));
 		//return RETCODE::INCOMPLETEREAD;
 	}
 
-	if ( this->IsOpen ( ) )
-		this->Close ( );
-
 	return result;
 }
 
@@ -0,0 +1,318 @@
+#pragma once
+
+/*
+	1. ParallelRecordFileScan scans a RecordFile with a pool of worker threads, with the same interface as RecordFileScan
+	2. The data pages are split into morsels of MORSELPAGES pages, a worker claims the next morsel when it finishes one
+	3. Every worker collects the matching records of a morsel into a batch and hands it to GetNextRec through a bounded queue
+	4. The records are not returned in RecordIdentifier order
+	5. The file must not be modified while the scan is open
+*/
+
+#include "Utils.hpp"
+#include "RecordFile.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class ParallelRecordFileScan {
+public:
+
+	const static PageNum BeginPage = 2;		// page 1 is the RecordFileHeader
+
+	const static PageNum MORSELPAGES = 16;
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	ParallelRecordFileScan (size_t numWorkers = 0);		// 0 for one worker per hardware thread
+	~ParallelRecordFileScan ( );
+
+	RETCODE OpenScan (const RecordFilePtr &fileHandle,  // Initialize file scan and start the workers
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value);
+
+	RETCODE GetNextRec (Record &rec);                  // Get next matching record
+
+	RETCODE CloseScan ( );                                // Stop the workers and terminate file scan
+
+private:
+
+	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	using Batch = std::vector<Record>;
+
+	void work ( );
+
+	RETCODE scanPage (PageNum page, Batch & batch) const;
+
+	bool push (Batch && batch);
+
+	Comparator _comp;
+
+	RecordFilePtr _recFile;
+
+	AttrType _attrType;
+
+	size_t _attrLength;
+
+	size_t _attrOffset;
+
+	std::vector<char> _attrValue;
+
+	size_t _numWorkers;
+
+	std::vector<std::thread> _workers;
+
+	std::atomic<PageNum> _nextMorsel;		// first page of the next unclaimed morsel
+
+	PageNum _endPage;
+
+	std::mutex _mutex;						// protects the members below
+
+	std::condition_variable _notEmpty;
+
+	std::condition_variable _notFull;
+
+	std::deque<Batch> _batches;
+
+	size_t _running;						// workers that have not finished
+
+	bool _stop;
+
+	RETCODE _error;
+
+	Batch _current;							// the batch being returned by GetNextRec
+
+	size_t _currentPos;
+
+	ScanState _state;
+
+};
+
+ParallelRecordFileScan::ParallelRecordFileScan (size_t numWorkers) {
+	_numWorkers = numWorkers != 0 ? numWorkers : std::thread::hardware_concurrency ( );
+	if ( _numWorkers == 0 )
+		_numWorkers = 1;
+
+	_state = ScanState::Close;
+	_comp = nullptr;
+	_recFile = nullptr;
+	_running = 0;
+	_stop = false;
+	_error = RETCODE::COMPLETE;
+	_currentPos = 0;
+}
+
+ParallelRecordFileScan::~ParallelRecordFileScan ( ) {
+	CloseScan ( );
+}
+
+inline RETCODE ParallelRecordFileScan::OpenScan (const RecordFilePtr & fileHandle, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( fileHandle == nullptr || !fileHandle->isValidRecordFile ( ) )
+		return RETCODE::INVALIDPAGEFILE;
+
+	_recFile = fileHandle;
+	_comp = nullptr;
+
+	if ( value != nullptr && compOp != NO_OP ) {			// has condition
+
+		if ( attrType != AttrType::INT && attrType != AttrType::FLOAT && attrType != AttrType::STRING )
+			return RETCODE::INVALIDSCAN;
+
+		if ( attrOffset + attrLength > _recFile->recordSize ( ) )
+			return RETCODE::INVALIDSCAN;
+
+		if ( ( attrType == AttrType::INT || attrType == AttrType::FLOAT ) && attrLength != 4 )
+			return RETCODE::INVALIDSCAN;
+
+		switch ( compOp ) {
+		case EQ_OP:
+			_comp = CompMethod::equal;
+			break;
+		case LT_OP:
+			_comp = CompMethod::less_than;
+			break;
+		case GT_OP:
+			_comp = CompMethod::greater_than;
+			break;
+		case LE_OP:
+			_comp = CompMethod::less_than_or_eq_to;
+			break;
+		case GE_OP:
+			_comp = CompMethod::greater_than_or_eq_to;
+			break;
+		case NE_OP:
+			_comp = CompMethod::not_equal;
+			break;
+		default:
+			return RETCODE::INVALIDSCAN;
+		}
+
+		_attrType = attrType;
+		_attrLength = attrLength;
+		_attrOffset = attrOffset;
+		_attrValue.assign (reinterpret_cast< char* >( value ), reinterpret_cast< char* >( value ) + attrLength);
+	}
+
+	// initialize the status
+	_nextMorsel = BeginPage;
+	_endPage = _recFile->numPages ( ) + 1;		// numPages counts the header page
+	_batches.clear ( );
+	_current.clear ( );
+	_currentPos = 0;
+	_stop = false;
+	_error = RETCODE::COMPLETE;
+	_running = _numWorkers;
+	_state = Open;
+
+	for ( size_t i = 0; i < _numWorkers; i++ )
+		_workers.emplace_back (&ParallelRecordFileScan::work, this);
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Worker thread: claim morsels until the file ends or the scan is closed
+*/
+inline void ParallelRecordFileScan::work ( ) {
+	RETCODE result = RETCODE::COMPLETE;
+
+	for ( ;; ) {
+		PageNum first = _nextMorsel.fetch_add (MORSELPAGES);
+
+		if ( first >= _endPage )
+			break;
+
+		PageNum last = first + MORSELPAGES < _endPage ? first + MORSELPAGES : _endPage;
+		Batch batch;
+
+		for ( PageNum page = first; page < last && result == RETCODE::COMPLETE; page++ )
+			result = scanPage (page, batch);
+
+		if ( result != RETCODE::COMPLETE || ( !batch.empty ( ) && !push (std::move (batch)) ) )
+			break;
+	}
+
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	if ( result != RETCODE::COMPLETE && _error == RETCODE::COMPLETE )
+		_error = result;
+
+	_running--;
+	_notEmpty.notify_all ( );
+}
+
+/*
+	Append the matching records of one page to batch
+*/
+inline RETCODE ParallelRecordFileScan::scanPage (PageNum page, Batch & batch) const {
+	RETCODE result;
+	PagePtr pagePtr;
+	char * pData;
+	SlotNum numSlots = _recFile->numSlots ( );
+	RecordPageHeader pHdr (numSlots);
+
+	if ( ( result = _recFile->bufMgr->GetPage (page, pagePtr) ) || ( result = _recFile->bufMgr->UnlockPage (page) )
+		 || ( result = pagePtr->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	pHdr.from_buf (pData);
+
+	if ( pHdr.numFreeSlots == numSlots )			// empty page
+		return RETCODE::COMPLETE;
+
+	Bitmap bm (pHdr.getFreeSlotMap ( ), numSlots);
+
+	for ( SlotNum slot = 0; slot < numSlots; slot++ ) {
+		if ( bm.test (slot) )			// free slot
+			continue;
+
+		char * recData = pData + _recFile->getOffsetBySlot (slot);
+
+		if ( _comp == nullptr || _comp (recData + _attrOffset, const_cast< char* >( _attrValue.data ( ) ), _attrType, _attrLength) )
+			batch.emplace_back (RecordIdentifier{ page, slot }, recData, _recFile->recordSize ( ));
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Hand a batch to the consumer, wait while the queue is full, return false if the scan is closed
+*/
+inline bool ParallelRecordFileScan::push (Batch && batch) {
+	std::unique_lock<std::mutex> lock (_mutex);
+
+	_notFull.wait (lock, [this] { return _stop || _batches.size ( ) < 2 * _numWorkers; });
+
+	if ( _stop )
+		return false;
+
+	_batches.push_back (std::move (batch));
+	_notEmpty.notify_one ( );
+
+	return true;
+}
+
+inline RETCODE ParallelRecordFileScan::GetNextRec (Record & rec) {
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( _currentPos == _current.size ( ) ) {
+		std::unique_lock<std::mutex> lock (_mutex);
+
+		_notEmpty.wait (lock, [this] { return !_batches.empty ( ) || _running == 0 || _error != RETCODE::COMPLETE; });
+
+		if ( _error != RETCODE::COMPLETE ) {
+			_state = End;
+			return _error;
+		}
+
+		if ( _batches.empty ( ) ) {			// all workers have finished
+			_state = End;
+			return RETCODE::EOFSCAN;
+		}
+
+		_current = std::move (_batches.front ( ));
+		_batches.pop_front ( );
+		_currentPos = 0;
+		_notFull.notify_one ( );
+	}
+
+	rec = _current[_currentPos++];
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ParallelRecordFileScan::CloseScan ( ) {
+	{
+		std::lock_guard<std::mutex> guard (_mutex);
+		_stop = true;
+		_notFull.notify_all ( );
+	}
+
+	for ( auto & worker : _workers )
+		worker.join ( );
+
+	_workers.clear ( );
+	_batches.clear ( );
+	_current.clear ( );
+	_state = ScanState::Close;
+
+	return RETCODE::COMPLETE;
+}
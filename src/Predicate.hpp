@@ -81,6 +81,9 @@ bool Predicate::eval (const char *buf, const char* rhs, CompOp c) const {
 		if ( attrType == STRING ) {
 			return strncmp (attr, ( char * ) value_, attrLength) < 0;
 		}
+		if ( attrType == VARCHAR ) {
+			return CompMethod::compare_varchar (( void * ) attr, ( void * ) value_, attrLength) < 0;
+		}
 	}
 	if ( c == GT_OP ) {
 		if ( attrType == INT ) {
@@ -92,6 +95,9 @@ bool Predicate::eval (const char *buf, const char* rhs, CompOp c) const {
 		if ( attrType == STRING ) {
 			return strncmp (attr, ( char * ) value_, attrLength) > 0;
 		}
+		if ( attrType == VARCHAR ) {
+			return CompMethod::compare_varchar (( void * ) attr, ( void * ) value_, attrLength) > 0;
+		}
 	}
 	if ( c == EQ_OP ) {
 		if ( attrType == INT ) {
@@ -104,6 +110,9 @@ bool Predicate::eval (const char *buf, const char* rhs, CompOp c) const {
 		if ( attrType == STRING ) {
 			return strncmp (attr, ( char * ) value_, attrLength) == 0;
 		}
+		if ( attrType == VARCHAR ) {
+			return CompMethod::compare_varchar (( void * ) attr, ( void * ) value_, attrLength) == 0;
+		}
 	}
 	if ( c == LE_OP ) {
 		return this->eval (buf, rhs, LT_OP) || this->eval (buf, rhs, EQ_OP);
@@ -13,6 +13,17 @@
 #include "Bitmap.hpp"
 #include "Record.hpp"
 #include "BufferManager.hpp"
+#include "FreeSpaceMap.hpp"
+#include "ZoneMap.hpp"
+#include "BloomFilter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 struct RecordFileHeader {								// stored in the first page (PageNum = 0) of every data file
 	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL RecordFile", 32 bytes
@@ -81,6 +92,10 @@ struct RecordPageHeader {
 
 class RecordFile {
 
+	friend class RecordFileScan;
+
+	friend class ParallelRecordFileScan;
+
 public:
 
 	
@@ -90,13 +105,20 @@ public:
 	/*
 	The file must be opened before any other operation
 	*/
-	RETCODE Open (const BufferManagerPtr & ptr );
+	RETCODE Open (const BufferManagerPtr & ptr, const FreeSpaceMapPtr & fsmPtr = nullptr,		// without a FreeSpaceMap the free page list is used
+				  const ZoneMapPtr & zoneMapPtr = nullptr, const BloomFilterPtr & bloomFilterPtr = nullptr);
 
 	RETCODE InsertRec (const char *pData, RecordIdentifier &rid);       // Insert a new record, and return record id
+	RETCODE InsertRecs (const char *rows, size_t n, RecordIdentifier *rids);	// Insert n records stored one after another, rids may be nullptr
 	RETCODE DeleteRec (const RecordIdentifier&rid);                    // Delete a record
 	RETCODE UpdateRec (const Record &rec);              // Update a record
 	RETCODE GetRec (const RecordIdentifier &rid, Record &rec) const;
 
+	using RecordCallback = std::function<RETCODE (size_t, const Record &)>;		// index into rids, the record
+
+	// Get n records, the pages are visited in order and each page once, callback stops the fetch by not returning COMPLETE
+	RETCODE GetRecs (const RecordIdentifier *rids, size_t n, const RecordCallback &callback, bool prefetch = false) const;
+
 	RETCODE ForcePages (PageNum pageNum) const; // Write dirty page(s) to disk
 
 	RETCODE GetPageHeader (PagePtr & page, RecordPageHeader & pHdr);
@@ -107,6 +129,9 @@ public:
 
 	RETCODE GetHeader (RecordFileHeader & header) const;			// to write into the first page
 	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+	RETCODE GetFreeSpaceMap (FreeSpaceMapPtr & ptr) const;
+	RETCODE GetZoneMap (ZoneMapPtr & ptr) const;
+	RETCODE GetBloomFilter (BloomFilterPtr & ptr) const;
 
 	bool isValidRecordFile ( ) const;
 
@@ -115,7 +140,9 @@ public:
 	*/
 	static RETCODE GetRecordPageAndSlot (const RecordIdentifier & id, PageNum & page, SlotNum & slot);		// call id.GetSlotNum() and id.GetPageNum()
 
-	RETCODE GetNextFreeSlot (PagePtr & pagePtr, PageNum & page, SlotNum & slot) ;
+	static SlotNum SlotsPerPage (size_t recordSize);
+
+	RETCODE GetNextFreeSlot (PagePtr & pagePtr, PageNum & page, SlotNum & slot, std::unique_lock<std::mutex> & latch) ;		// returns with the page latched
 
 	RETCODE GetNextFreePage (PageNum & page) ;
 
@@ -133,8 +160,16 @@ private:
 
 	SlotNum numSlots ( ) const;
 
+	RETCODE rebuildBloomFilter (PageNum page);		// rebuild the stale Bloom filters of the group of page
+
+	std::mutex & pageLatch (PageNum page) const;
+
 	static const PageNum HEADERPAGE = 1;
 
+	static const size_t NUMPAGELATCHES = 64;
+
+	static const size_t PREFETCHPAGES = 8;		// pages GetRecs reads ahead of the callback
+
 	bool headerModified;
 
 	bool isFileOpen;
@@ -143,6 +178,16 @@ private:
 
 	BufferManagerPtr bufMgr;
 
+	FreeSpaceMapPtr fsm;
+
+	ZoneMapPtr zoneMap;
+
+	BloomFilterPtr bloomFilter;
+
+	std::mutex _headerMutex;			// protects header while concurrent inserters allocate pages
+
+	mutable std::mutex _pageLatches[NUMPAGELATCHES];		// held while a data page is modified, shared by page number
+
 };
 
 using RecordFilePtr = shared_ptr<RecordFile>;
@@ -162,7 +207,7 @@ RecordFile::~RecordFile ( ) {
 
 }
 
-inline RETCODE RecordFile::Open (const BufferManagerPtr & ptr) {
+inline RETCODE RecordFile::Open (const BufferManagerPtr & ptr, const FreeSpaceMapPtr & fsmPtr, const ZoneMapPtr & zoneMapPtr, const BloomFilterPtr & bloomFilterPtr) {
 
 	RETCODE result = RETCODE::COMPLETE;
 
@@ -176,6 +221,9 @@ inline RETCODE RecordFile::Open (const BufferManagerPtr & ptr) {
 
 	isFileOpen = true;
 	bufMgr = ptr;
+	fsm = fsmPtr;
+	zoneMap = zoneMapPtr;
+	bloomFilter = bloomFilterPtr;
 	headerModified = true;
 
 	if ( result = ReadHeader ( ) ) {
@@ -197,7 +245,7 @@ inline RETCODE RecordFile::GetRec (const RecordIdentifier & rid, Record & rec) c
 		return result;
 	}
 
-	if ( pageNum > numPages() || slotNum > recordSize() )			// if the request file page is larger than amount
+	if ( pageNum > numPages() || slotNum >= numSlots() )			// if the request file page is larger than amount
 		return RETCODE::EOFFILE;
 
 	// request the page from buffer
@@ -223,18 +271,136 @@ inline RETCODE RecordFile::GetRec (const RecordIdentifier & rid, Record & rec) c
 	return result;
 }
 
+/*
+	The rids are sorted by page and slot, a requested slot that is free gives RECORDNOTFOUND.
+	With prefetch a reader thread brings up to PREFETCHPAGES of the following pages into the buffer while the callback runs,
+	it stops at the next page when the fetch ends early
+*/
+inline RETCODE RecordFile::GetRecs (const RecordIdentifier * rids, size_t n, const RecordCallback & callback, bool prefetch) const {
+	RETCODE result = RETCODE::COMPLETE;
+	std::vector<size_t> order (n);
+	std::vector<PageNum> pages;
+
+	if ( rids == nullptr && n > 0 ) {
+		return RETCODE::BADRECORD;
+	}
+
+	for ( size_t i = 0; i < n; i++ )
+		order[i] = i;
+
+	std::sort (order.begin ( ), order.end ( ), [rids] (size_t a, size_t b) {
+		PageNum pa, pb;
+		SlotNum sa, sb;
+		rids[a].GetPageNum (pa);
+		rids[b].GetPageNum (pb);
+		if ( pa != pb )
+			return pa < pb;
+		rids[a].GetSlotNum (sa);
+		rids[b].GetSlotNum (sb);
+		return sa != sb ? sa < sb : a < b;
+	});
+
+	for ( size_t i : order ) {
+		PageNum page;
+		rids[i].GetPageNum (page);
+		if ( pages.empty ( ) || pages.back ( ) != page )
+			pages.push_back (page);
+	}
+
+	for ( PageNum page : pages ) {
+		if ( page < 2 || page > numPages ( ) )		// pages 0 and 1 hold the file headers
+			return RETCODE::EOFFILE;
+	}
+
+	std::thread reader;
+	std::mutex readerMutex;
+	std::condition_variable readerCond;
+	std::atomic<bool> stop (false);
+	std::atomic<size_t> visited (0);			// pages handed to the callback so far
+
+	if ( prefetch && pages.size ( ) > 1 ) {
+		reader = std::thread ([&] ( ) {
+			for ( size_t i = 1; i < pages.size ( ) && !stop; i++ ) {
+				{
+					std::unique_lock<std::mutex> lock (readerMutex);
+					readerCond.wait (lock, [&] { return stop || i <= visited + PREFETCHPAGES; });
+				}
+
+				if ( !stop )
+					bufMgr->PrefetchPage (pages[i]);
+			}
+		});
+	}
+
+	size_t next = 0;
+
+	for ( PageNum page : pages ) {
+		if ( reader.joinable ( ) ) {
+			std::lock_guard<std::mutex> lock (readerMutex);
+			visited++;
+			readerCond.notify_one ( );
+		}
+
+		PagePtr pagePtr;
+		char * pData;
+		RecordPageHeader pHdr (numSlots ( ));
+
+		if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) )
+			 || ( result = pagePtr->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			break;
+		}
+
+		pHdr.from_buf (pData);
+		Bitmap bm (pHdr.getFreeSlotMap ( ), numSlots ( ));
+
+		for ( ; next < n; next++ ) {
+			PageNum p;
+			SlotNum slot;
+			rids[order[next]].GetPageNum (p);
+			rids[order[next]].GetSlotNum (slot);
+
+			if ( p != page )
+				break;
+
+			if ( slot >= numSlots ( ) || bm.test (slot) ) {
+				result = RETCODE::RECORDNOTFOUND;
+				break;
+			}
+
+			if ( result = callback (order[next], Record (rids[order[next]], pData + getOffsetBySlot (slot), recordSize ( ))) )
+				break;
+		}
+
+		if ( result )
+			break;
+	}
+
+	if ( reader.joinable ( ) ) {
+		{
+			std::lock_guard<std::mutex> lock (readerMutex);
+			stop = true;
+			readerCond.notify_one ( );
+		}
+		reader.join ( );
+	}
+
+	return result;
+}
+
 inline RETCODE RecordFile::InsertRec (const char * pData, RecordIdentifier & rid) {
 	RETCODE result = RETCODE::COMPLETE;
 	SlotNum slot;
 	PageNum page;
 	PagePtr pagePtr;
 	RecordPageHeader pHdr (this->numSlots());
+	std::unique_lock<std::mutex> latch;
 
 	if ( pData == nullptr ) {
 		return RETCODE::BADRECORD;
 	}
 
-	if ( result = GetNextFreeSlot (pagePtr, page, slot) ) {
+	if ( result = GetNextFreeSlot (pagePtr, page, slot, latch) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
@@ -252,10 +418,26 @@ inline RETCODE RecordFile::InsertRec (const char * pData, RecordIdentifier & rid
 
 	memcpy_s (pSlot, recordSize ( ), pData, recordSize ( ));
 
+	if ( zoneMap != nullptr && ( result = zoneMap->Update (page, pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( bloomFilter != nullptr && ( result = bloomFilter->Add (page, pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	bm.reset (slot);
 	pHdr.numFreeSlots--;
 
-	if ( pHdr.numFreeSlots == 0 ) {
+	if ( fsm != nullptr ) {
+		if ( result = fsm->Set (page, FreeSpaceMap::Category (pHdr.numFreeSlots, numSlots ( ))) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	} else if ( pHdr.numFreeSlots == 0 ) {
+		std::lock_guard<std::mutex> guard (_headerMutex);
 		header.firstFreePage = pHdr.nextFree;
 		pHdr.nextFree = Utils::UNKNOWNPAGENUM;
 	}
@@ -270,6 +452,102 @@ inline RETCODE RecordFile::InsertRec (const char * pData, RecordIdentifier & rid
 	return result;
 }
 
+/*
+	Fill every page with as many rows as it takes, the page header, FreeSpaceMap entry and free list are updated
+	once per page and the pages are written together by one FlushPages at the end
+*/
+inline RETCODE RecordFile::InsertRecs (const char * rows, size_t n, RecordIdentifier * rids) {
+	RETCODE result = RETCODE::COMPLETE;
+	size_t done = 0;
+
+	if ( rows == nullptr && n > 0 ) {
+		return RETCODE::BADRECORD;
+	}
+
+	while ( done < n ) {
+		PageNum page;
+		PagePtr pagePtr;
+		char * pData;
+		RecordPageHeader pHdr (this->numSlots ( ));
+
+		if ( result = GetNextFreePage (page) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		std::lock_guard<std::mutex> latch (pageLatch (page));
+
+		if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) ) || ( result = pagePtr->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		pHdr.from_buf (pData);
+
+		if ( pHdr.numFreeSlots == 0 ) {			// filled by another inserter after the map was read
+			if ( fsm != nullptr && ( result = fsm->Set (page, FreeSpaceMap::FULL) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+			continue;
+		}
+
+		Bitmap bm (pHdr.getFreeSlotMap ( ), numSlots ( ));
+
+		for ( SlotNum slot = 0; slot < numSlots ( ) && done < n && pHdr.numFreeSlots > 0; slot++ ) {
+			if ( !bm.test (slot) )
+				continue;
+
+			const char * row = rows + done * recordSize ( );
+
+			memcpy_s (pData + getOffsetBySlot (slot), recordSize ( ), row, recordSize ( ));
+
+			if ( zoneMap != nullptr && ( result = zoneMap->Update (page, row) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			if ( bloomFilter != nullptr && ( result = bloomFilter->Add (page, row) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			bm.reset (slot);
+			pHdr.numFreeSlots--;
+
+			if ( rids != nullptr )
+				rids[done] = RecordIdentifier{ page, slot };
+			done++;
+		}
+
+		if ( fsm != nullptr ) {
+			if ( result = fsm->Set (page, FreeSpaceMap::Category (pHdr.numFreeSlots, numSlots ( ))) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+		} else if ( pHdr.numFreeSlots == 0 ) {
+			std::lock_guard<std::mutex> guard (_headerMutex);
+			header.firstFreePage = pHdr.nextFree;
+			pHdr.nextFree = Utils::UNKNOWNPAGENUM;
+		}
+
+		bm.to_char_buf (pHdr.getFreeSlotMap ( ), bm.numChars ( ));
+		pHdr.to_buf (pData);
+
+		if ( result = bufMgr->MarkDirty (page) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	if ( ( result = bufMgr->FlushPages ( ) ) || ( result = SaveHeader ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
 inline RETCODE RecordFile::DeleteRec (const RecordIdentifier & rid) {
 	RETCODE result;
 	PageNum p;
@@ -282,6 +560,7 @@ inline RETCODE RecordFile::DeleteRec (const RecordIdentifier & rid) {
 
 	PagePtr ph;
 	RecordPageHeader pHdr (this->numSlots ( ));
+	std::lock_guard<std::mutex> latch (pageLatch (p));
 	if ( ( result = bufMgr->GetPage (p, ph) ) ||
 			( result = bufMgr->MarkDirty (p) ) ||
 			( result = bufMgr->UnlockPage (p) ) ||		// Needs to be called every time GetThisPage is called.
@@ -296,9 +575,15 @@ inline RETCODE RecordFile::DeleteRec (const RecordIdentifier & rid) {
 
 	// TODO considering zero-ing record - IOs though
 	b.set (s); // s is now free
-	if ( pHdr.numFreeSlots == 0 ) {
+	if ( bloomFilter != nullptr && ( result = bloomFilter->MarkStale (p) ) )	// the value stays in the filters until they are rebuilt
+		return result;
+	if ( fsm != nullptr ) {
+		if ( result = fsm->Set (p, FreeSpaceMap::Category (pHdr.numFreeSlots + 1, numSlots ( ))) )
+			return result;
+	} else if ( pHdr.numFreeSlots == 0 ) {
 		// this page used to be full and used to not be on the free list
 		// add it to the free list now.
+		std::lock_guard<std::mutex> guard (_headerMutex);
 		pHdr.nextFree = header.firstFreePage;
 		header.firstFreePage = p;
 	}
@@ -324,6 +609,7 @@ inline RETCODE RecordFile::UpdateRec (const Record & rec) {
 	RETCODE result;
 
 	RecordPageHeader pHdr (this->numSlots ( ));
+	std::lock_guard<std::mutex> latch (pageLatch (p));
 	if ( ( result = bufMgr->GetPage (p, ph) ) ||
 		( result = bufMgr->MarkDirty (p) ) ||
 		( result = bufMgr->UnlockPage (p) ) ||
@@ -337,14 +623,24 @@ inline RETCODE RecordFile::UpdateRec (const Record & rec) {
 		return RETCODE::RECORDNOTFOUND;
 
 	char * pData;
+	char * pPage;
 
 	rec.GetData (pData);
 
-	char * pSlot = pData + getOffsetBySlot(s);
+	if ( result = ph->GetData (pPage) )
+		return result;
+
+	char * pSlot = pPage + getOffsetBySlot(s);
 	
 	memcpy (pSlot, pData, this->recordSize ( ));
 
-	return result;
+	if ( zoneMap != nullptr && ( result = zoneMap->Update (p, pData) ) )
+		return result;
+
+	if ( bloomFilter != nullptr && ( ( result = bloomFilter->Add (p, pData) ) || ( result = bloomFilter->MarkStale (p) ) ) )
+		return result;
+
+	return bufMgr->ForcePage (p);
 }
 
 inline RETCODE RecordFile::ForcePages (PageNum pageNum) const {
@@ -430,7 +726,22 @@ inline RETCODE RecordFile::SaveHeader ( ) const {
 }
 
 inline RETCODE RecordFile::GetHeader (RecordFileHeader & header) const {
-	header = header;
+	header = this->header;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE RecordFile::GetFreeSpaceMap (FreeSpaceMapPtr & ptr) const {
+	ptr = fsm;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE RecordFile::GetZoneMap (ZoneMapPtr & ptr) const {
+	ptr = zoneMap;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE RecordFile::GetBloomFilter (BloomFilterPtr & ptr) const {
+	ptr = bloomFilter;
 	return RETCODE::COMPLETE;
 }
 
@@ -458,16 +769,39 @@ inline RETCODE RecordFile::GetRecordPageAndSlot (const RecordIdentifier & id, Pa
 
 }
 
-inline RETCODE RecordFile::GetNextFreeSlot (PagePtr & pagePtr, PageNum & page, SlotNum & slot) {
+/*
+	The free space map is only a hint, another inserter may fill the page before it is latched,
+	such a page is marked full in the map and the next page is tried
+*/
+inline RETCODE RecordFile::GetNextFreeSlot (PagePtr & pagePtr, PageNum & page, SlotNum & slot, std::unique_lock<std::mutex> & latch) {
 
 	RETCODE result;
 
 	RecordPageHeader pHdr (this->numSlots());
 
-	if ( ( result = GetNextFreePage (page) ) || ( result = bufMgr->GetPage (page, pagePtr) )
-		 || (result = bufMgr->UnlockPage(page) ) || ( result = this->GetPageHeader(pagePtr, pHdr)) ) {
-		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
-		return result;
+	for ( ;; ) {
+		if ( result = GetNextFreePage (page) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		latch = std::unique_lock<std::mutex> (pageLatch (page));
+
+		if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) )
+			 || ( result = this->GetPageHeader (pagePtr, pHdr) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( pHdr.numFreeSlots > 0 || fsm == nullptr )
+			break;
+
+		if ( result = fsm->Set (page, FreeSpaceMap::FULL) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		latch.unlock ( );
 	}
 
 	Bitmap bm (pHdr.getFreeSlotMap(), numSlots());
@@ -487,8 +821,13 @@ inline RETCODE RecordFile::GetNextFreePage (PageNum & pageNum) {
 	PagePtr ph;
 	RecordPageHeader pHdr (this->numSlots ( ));
 	PageNum p = Utils::UNKNOWNPAGENUM;
+	std::lock_guard<std::mutex> guard (_headerMutex);
 
-	if ( header.firstFreePage != Utils::UNKNOWNPAGENUM ) {
+	// any page with a free slot will do, the map spreads the inserting threads
+	if ( fsm != nullptr && fsm->FindPage (FreeSpaceMap::Category (1, numSlots ( )), pageNum) == RETCODE::COMPLETE )
+		return RETCODE::COMPLETE;
+
+	if ( fsm == nullptr && header.firstFreePage != Utils::UNKNOWNPAGENUM ) {
 		// this last page on the free list might actually be full
 		if ( ( result = bufMgr->GetPage (header.firstFreePage, ph) )
 			|| ( result = ph->GetPageNum (p) )
@@ -502,6 +841,7 @@ inline RETCODE RecordFile::GetNextFreePage (PageNum & pageNum) {
 
 	if ( //we need to allocate a new page
 		 // because this is the firs time
+		fsm != nullptr ||
 		header.numPages == 0 ||
 		header.firstFreePage == Utils::UNKNOWNPAGENUM ||
 		// or due to a full page
@@ -531,7 +871,14 @@ inline RETCODE RecordFile::GetNextFreePage (PageNum & pageNum) {
 		}
 
 		// add page to the free list
-		header.firstFreePage = pageNum;
+		if ( fsm != nullptr ) {
+			if ( result = fsm->Set (pageNum, FreeSpaceMap::Category (numSlots ( ), numSlots ( )), true) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+		} else {
+			header.firstFreePage = pageNum;
+		}
 		header.numPages++;
 		assert (header.numPages > 1); // page num 1 would be header page
 								   // std::cerr << "RM_FileHandle::GetNextFreePage hdr.numPages is " 
@@ -557,6 +904,10 @@ inline bool RecordFile::IsValidRid (const RecordIdentifier & rid) const{
 }
 
 
+inline std::mutex & RecordFile::pageLatch (PageNum page) const {
+	return _pageLatches[page % NUMPAGELATCHES];
+}
+
 inline size_t RecordFile::recordsPerPage ( ) const {
 	return header.recordsPerPage;
 }
@@ -566,7 +917,9 @@ inline size_t RecordFile::recordSize ( ) const {
 }
 
 inline size_t RecordFile::getOffsetBySlot (SlotNum slot) const {
-	return sizeof (RecordFileHeader) + static_cast<size_t>( header.recordSize * slot) ;
+	// records follow the serialized RecordPageHeader (see RecordPageHeader::size)
+	SlotNum n = numSlots ( );
+	return sizeof (PageNum) + 2 * sizeof (SlotNum) + ( n + 7 ) / 8 + static_cast<size_t>( header.recordSize * slot) ;
 }
 
 inline PageNum RecordFile::numPages ( ) const {
@@ -576,6 +929,51 @@ inline PageNum RecordFile::numPages ( ) const {
 inline SlotNum RecordFile::numSlots ( ) const {
 	assert (recordSize ( ) != 0);
 
-	return (Utils::PAGESIZE - sizeof (RecordPageHeader)) / recordSize();
+	return SlotsPerPage (recordSize ( ));
+}
+
+inline SlotNum RecordFile::SlotsPerPage (size_t recordSize) {
+	// every slot takes recordSize bytes and one bit of the free slot map, the extra byte covers the rounding of the map
+	return ( ( Utils::PAGESIZE - sizeof (PageNum) - 2 * sizeof (SlotNum) - 1 ) * 8 ) / ( recordSize * 8 + 1 );
+}
+
+/*
+	Add the records of every page of the group to the emptied filters
+*/
+inline RETCODE RecordFile::rebuildBloomFilter (PageNum page) {
+	RETCODE result;
+	PageNum first = BloomFilter::FirstPageOfGroup (page);
+
+	if ( bloomFilter == nullptr || !bloomFilter->IsStale (page) )
+		return RETCODE::COMPLETE;
+
+	if ( result = bloomFilter->Clear (page) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	for ( PageNum p = first; p < first + BloomFilter::GROUPPAGES && p <= numPages ( ); p++ ) {
+		PagePtr pagePtr;
+		RecordPageHeader pHdr (numSlots ( ));
+		char * pData;
+
+		if ( ( result = bufMgr->GetPage (p, pagePtr) ) || ( result = bufMgr->UnlockPage (p) )
+			 || ( result = pagePtr->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		pHdr.from_buf (pData);
+		Bitmap bm (pHdr.getFreeSlotMap ( ), numSlots ( ));
+
+		for ( SlotNum slot = 0; slot < numSlots ( ); slot++ ) {
+			if ( !bm.test (slot) && ( result = bloomFilter->Add (p, pData + getOffsetBySlot (slot)) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+		}
+	}
+
+	return RETCODE::COMPLETE;
 }
 
@@ -9,8 +9,14 @@
 #include "Record.hpp"
 #include "RecordFile.hpp"
 #include "RecordFileScan.hpp"
+#include "VarRecordFile.hpp"
+#include "VarRecordFileScan.hpp"
+#include "ClusteredFile.hpp"
+#include "ClusteredFileScan.hpp"
 #include "PageFileManager.hpp"
 
+#include <algorithm>
+
 
 class RecordFileManager {
 
@@ -19,11 +25,23 @@ public:
 	~RecordFileManager ( );
 
 	RETCODE CreateFile (const char *fileName, size_t recordSize);
+	RETCODE CreateFile (const char *fileName, size_t recordSize, int attrCount, const DataAttrInfo *attributes);	// with a ZoneMap and the BloomFilter of the attributes
 	RETCODE DestroyFile (const char *fileName);
 	RETCODE OpenFile (const char *fileName, RecordFilePtr &fileHandle);
 
 	RETCODE CloseFile (RecordFilePtr &fileHandle);
 
+	RETCODE CreateVarFile (const char *fileName);		// slotted pages for variable length records
+	RETCODE OpenFile (const char *fileName, VarRecordFilePtr &fileHandle);
+
+	RETCODE CloseFile (VarRecordFilePtr &fileHandle);
+
+	RETCODE CreateClusteredFile (const char *fileName, size_t recordSize,		// rows ordered by the key attribute
+								 int keyOffset, AttrType keyType, int keyLength);
+	RETCODE OpenFile (const char *fileName, ClusteredFilePtr &fileHandle);
+
+	RETCODE CloseFile (ClusteredFilePtr &fileHandle);
+
 private:
 
 	PageFileManagerPtr _pfMgr;
@@ -107,6 +125,17 @@ inline RETCODE RecordFileManager::CreateFile (const char * fileName, size_t reco
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
+
+	// the free space map of the file, it grows when data pages are allocated
+	std::string fsmName = FreeSpaceMap::FileName (fileName);
+	FreeSpaceMapPtr fsm = make_shared<FreeSpaceMap> ( );
+
+	if ( ( result = _pfMgr->CreateFile (fsmName.c_str ( )) ) || ( result = _pfMgr->OpenFile (fsmName.c_str ( ), pageFile) )
+		 || ( result = fsm->Create (make_shared<BufferManager> (pageFile)) ) || ( result = fsm->Flush ( ) )
+		 || ( result = _pfMgr->CloseFile (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
 	
 	return RETCODE::COMPLETE;
 }
@@ -119,9 +148,69 @@ inline RETCODE RecordFileManager::DestroyFile (const char * fileName) {
 		return result;
 	}
 
+	std::string fsmName = FreeSpaceMap::FileName (fileName);
+
+	if ( Utils::IsFileExist (fsmName.c_str ( )) && ( result = _pfMgr->DestroyFile (fsmName.c_str ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	std::string zmName = ZoneMap::FileName (fileName);
+
+	if ( Utils::IsFileExist (zmName.c_str ( )) && ( result = _pfMgr->DestroyFile (zmName.c_str ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	std::string bfName = BloomFilter::FileName (fileName);
+
+	if ( Utils::IsFileExist (bfName.c_str ( )) && ( result = _pfMgr->DestroyFile (bfName.c_str ( )) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	return result;
 }
 
+inline RETCODE RecordFileManager::CreateFile (const char * fileName, size_t recordSize, int attrCount, const DataAttrInfo * attributes) {
+	RETCODE result;
+
+	if ( result = CreateFile (fileName, recordSize) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( attrCount <= 0 || attributes == nullptr )
+		return RETCODE::COMPLETE;
+
+	std::string zmName = ZoneMap::FileName (fileName);
+	ZoneMapPtr zoneMap = make_shared<ZoneMap> ( );
+	PageFilePtr pageFile;
+
+	if ( ( result = _pfMgr->CreateFile (zmName.c_str ( )) ) || ( result = _pfMgr->OpenFile (zmName.c_str ( ), pageFile) )
+		 || ( result = zoneMap->Create (make_shared<BufferManager> (pageFile), attrCount, attributes) ) || ( result = zoneMap->Flush ( ) )
+		 || ( result = _pfMgr->CloseFile (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	// Bloom filters only for the attributes given a false positive rate
+	if ( std::none_of (attributes, attributes + attrCount, BloomFilter::IsTracked) )
+		return RETCODE::COMPLETE;
+
+	std::string bfName = BloomFilter::FileName (fileName);
+	BloomFilterPtr bloomFilter = make_shared<BloomFilter> ( );
+
+	if ( ( result = _pfMgr->CreateFile (bfName.c_str ( )) ) || ( result = _pfMgr->OpenFile (bfName.c_str ( ), pageFile) )
+		 || ( result = bloomFilter->Create (make_shared<BufferManager> (pageFile), attrCount, attributes, RecordFile::SlotsPerPage (recordSize)) )
+		 || ( result = bloomFilter->Flush ( ) ) || ( result = _pfMgr->CloseFile (pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
 inline RETCODE RecordFileManager::OpenFile (const char * fileName, RecordFilePtr & fileHandle) {
 	RETCODE result;
 	PageFilePtr ptr;
@@ -134,8 +223,45 @@ inline RETCODE RecordFileManager::OpenFile (const char * fileName, RecordFilePtr
 
 	bufMgr = make_shared<BufferManager> (ptr);
 
+	// files created before the free space map was added use the free page list
+	FreeSpaceMapPtr fsm = nullptr;
+	std::string fsmName = FreeSpaceMap::FileName (fileName);
+
+	if ( Utils::IsFileExist (fsmName.c_str ( )) ) {
+		fsm = make_shared<FreeSpaceMap> ( );
+
+		if ( ( result = _pfMgr->OpenFile (fsmName.c_str ( ), ptr) ) || ( result = fsm->Open (make_shared<BufferManager> (ptr)) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	ZoneMapPtr zoneMap = nullptr;
+	std::string zmName = ZoneMap::FileName (fileName);
+
+	if ( Utils::IsFileExist (zmName.c_str ( )) ) {
+		zoneMap = make_shared<ZoneMap> ( );
+
+		if ( ( result = _pfMgr->OpenFile (zmName.c_str ( ), ptr) ) || ( result = zoneMap->Open (make_shared<BufferManager> (ptr)) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	BloomFilterPtr bloomFilter = nullptr;
+	std::string bfName = BloomFilter::FileName (fileName);
+
+	if ( Utils::IsFileExist (bfName.c_str ( )) ) {
+		bloomFilter = make_shared<BloomFilter> ( );
+
+		if ( ( result = _pfMgr->OpenFile (bfName.c_str ( ), ptr) ) || ( result = bloomFilter->Open (make_shared<BufferManager> (ptr)) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
 	fileHandle = make_shared<RecordFile> ();
-	fileHandle->Open (bufMgr);
+	fileHandle->Open (bufMgr, fsm, zoneMap, bloomFilter);
 
 	return result;
 }
@@ -143,6 +269,34 @@ inline RETCODE RecordFileManager::OpenFile (const char * fileName, RecordFilePtr
 inline RETCODE RecordFileManager::CloseFile (RecordFilePtr & fileHandle) {
 	RETCODE result;
 	PageFilePtr ptr;
+	FreeSpaceMapPtr fsm;
+
+	if ( ( result = fileHandle->GetFreeSpaceMap (fsm) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( fsm != nullptr && ( ( result = fsm->Flush ( ) ) || ( result = fsm->GetPageFilePtr (ptr) ) || ( result = _pfMgr->CloseFile (ptr) ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	ZoneMapPtr zoneMap;
+	fileHandle->GetZoneMap (zoneMap);
+
+	if ( zoneMap != nullptr && ( ( result = zoneMap->Flush ( ) ) || ( result = zoneMap->GetPageFilePtr (ptr) ) || ( result = _pfMgr->CloseFile (ptr) ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	BloomFilterPtr bloomFilter;
+	fileHandle->GetBloomFilter (bloomFilter);
+
+	if ( bloomFilter != nullptr && ( ( result = bloomFilter->Flush ( ) ) || ( result = bloomFilter->GetPageFilePtr (ptr) ) || ( result = _pfMgr->CloseFile (ptr) ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	if ( ( result = fileHandle->GetPageFilePtr (ptr) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
@@ -156,3 +310,174 @@ inline RETCODE RecordFileManager::CloseFile (RecordFilePtr & fileHandle) {
 }
 
 
+
+inline RETCODE RecordFileManager::CreateVarFile (const char * fileName) {
+
+	if ( fileName == nullptr )
+		return RETCODE::INVALIDNAME;
+
+	RETCODE result;
+
+	if ( result = _pfMgr->CreateFile (fileName) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	PageFilePtr pageFile;
+	BufferManagerPtr bufMgr;
+
+	if ( result = _pfMgr->OpenFile (fileName, pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	bufMgr = make_shared<BufferManager> (pageFile);
+
+	PagePtr headerPage;		// header page of VarRecordFile
+	PageNum headerPageNum;
+	char * pData;
+
+	if ( ( result = bufMgr->AllocatePage (headerPage) ) || ( result = headerPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	VarRecordFileHeader header;
+
+	memcpy_s (pData, sizeof (VarRecordFileHeader),
+			  reinterpret_cast< const void * >( &header ), sizeof (VarRecordFileHeader));
+
+	headerPage->GetPageNum (headerPageNum);
+
+	if ( ( result = bufMgr->ForcePage (headerPageNum) ) || ( result = bufMgr->UnlockPage (headerPageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = _pfMgr->CloseFile (pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE RecordFileManager::OpenFile (const char * fileName, VarRecordFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( ( result = _pfMgr->OpenFile (fileName, ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	fileHandle = make_shared<VarRecordFile> ( );
+
+	if ( result = fileHandle->Open (make_shared<BufferManager> (ptr)) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE RecordFileManager::CloseFile (VarRecordFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( fileHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( ( result = fileHandle->SaveHeader ( ) ) || ( result = fileHandle->GetPageFilePtr (ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = _pfMgr->CloseFile (ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE RecordFileManager::CreateClusteredFile (const char * fileName, size_t recordSize, int keyOffset, AttrType keyType, int keyLength) {
+
+	if ( fileName == nullptr )
+		return RETCODE::INVALIDNAME;
+
+	if ( ( keyType != INT && keyType != FLOAT && keyType != STRING ) || ( keyType != STRING && keyLength != 4 ) )
+		return RETCODE::CREATEFAILED;
+
+	RETCODE result;
+	PageFilePtr pageFile;
+
+	if ( ( result = _pfMgr->CreateFile (fileName) ) || ( result = _pfMgr->OpenFile (fileName, pageFile) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	BufferManagerPtr bufMgr = make_shared<BufferManager> (pageFile);
+
+	PagePtr headerPage;		// header page of ClusteredFile
+	PageNum headerPageNum;
+	char * pData;
+
+	if ( ( result = bufMgr->AllocatePage (headerPage) ) || ( result = headerPage->GetData (pData) )
+		 || ( result = headerPage->GetPageNum (headerPageNum) )
+		 || ( result = ClusteredFile::InitHeader (pData, recordSize, keyOffset, keyType, keyLength) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = bufMgr->ForcePage (headerPageNum) ) || ( result = bufMgr->UnlockPage (headerPageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = _pfMgr->CloseFile (pageFile) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE RecordFileManager::OpenFile (const char * fileName, ClusteredFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( ( result = _pfMgr->OpenFile (fileName, ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	fileHandle = make_shared<ClusteredFile> ( );
+
+	if ( result = fileHandle->Open (make_shared<BufferManager> (ptr)) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
+
+inline RETCODE RecordFileManager::CloseFile (ClusteredFilePtr & fileHandle) {
+	RETCODE result;
+	PageFilePtr ptr;
+
+	if ( fileHandle == nullptr )
+		return RETCODE::CLOSEDFILE;
+
+	if ( ( result = fileHandle->ForcePages ( ) ) || ( result = fileHandle->GetPageFilePtr (ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = _pfMgr->CloseFile (ptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return result;
+}
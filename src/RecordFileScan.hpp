@@ -7,11 +7,12 @@
 
 #include "Utils.hpp"
 #include "RecordFile.hpp"
+#include "StringDictionary.hpp"
 
 class RecordFileScan {
 public:
 
-	const static PageNum BeginPage = 1;
+	const static PageNum BeginPage = 2;		// page 1 is the RecordFileHeader
 
 	enum ScanState {
 		Close, Open, End
@@ -41,6 +42,12 @@ public:
 											  CompOp        compOp,
 											  void          *value);
 
+	RETCODE OpenScan (const RecordFilePtr &fileHandle,  // Initialize file scan on a dictionary encoded attribute
+											  const StringDictionaryPtr &dict,
+											  size_t				attrOffset,
+											  CompOp        compOp,
+											  void          *value);		// the STRING value, not the code
+
 	RETCODE GetNextRec (Record &rec);                  // Get next matching record
 
 	RETCODE CloseScan ( );                                // Terminate file scan
@@ -48,9 +55,29 @@ public:
 private:
 	
 	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	bool satisfies (char * recData) const;
+
+	RETCODE isFreeSlot (PageNum page, SlotNum slot, bool & isFree);
 	
 	Comparator _comp;
 
+	bool _useCodeSet;
+
+	std::vector<bool> _codeSet;			// codes of a dictionary encoded attribute that satisfy the condition
+
+	std::vector<bool> _freeSlots;		// free slot map of _curPage
+
+	ZoneMapPtr _zoneMap;
+
+	size_t _zoneAttr;					// the attribute of the condition in _zoneMap, UNKNOWNPOS if not tracked
+
+	BloomFilterPtr _bloomFilter;
+
+	size_t _bloomAttr;					// the attribute of an EQ_OP condition in _bloomFilter, UNKNOWNPOS if not tracked
+
+	CompOp _compOp;
+
 	RecordFilePtr _recFile;
 
 	PagePtr _curPage;
@@ -75,6 +102,12 @@ RecordFileScan::RecordFileScan ( ) {
 	
 	_recFile = nullptr;
 	_curPage = nullptr;
+	_comp = nullptr;
+	_useCodeSet = false;
+	_zoneMap = nullptr;
+	_zoneAttr = Utils::UNKNOWNPOS;
+	_bloomFilter = nullptr;
+	_bloomAttr = Utils::UNKNOWNPOS;
 
 }
 
@@ -88,6 +121,13 @@ inline RETCODE RecordFileScan::OpenScan (const RecordFilePtr & fileHandle, AttrT
 		return RETCODE::INVALIDSCAN;
 
 	_recFile = fileHandle;
+	_comp = nullptr;
+	_useCodeSet = false;
+	_codeSet.clear ( );
+	_zoneMap = nullptr;
+	_zoneAttr = Utils::UNKNOWNPOS;
+	_bloomFilter = nullptr;
+	_bloomAttr = Utils::UNKNOWNPOS;
 
 	if ( fileHandle == nullptr || !fileHandle->isValidRecordFile ( ) )
 		return RETCODE::INVALIDPAGEFILE;
@@ -144,11 +184,20 @@ inline RETCODE RecordFileScan::OpenScan (const RecordFilePtr & fileHandle, AttrT
 
 		memcpy_s (_attrValue, attrLength, value, attrLength);
 
+		_compOp = compOp;
+
+		if ( _comp != nullptr && _recFile->GetZoneMap (_zoneMap) == RETCODE::COMPLETE && _zoneMap != nullptr )
+			_zoneAttr = _zoneMap->FindAttr (attrOffset, attrType, attrLength);
+
+		if ( compOp == EQ_OP && _recFile->GetBloomFilter (_bloomFilter) == RETCODE::COMPLETE && _bloomFilter != nullptr )
+			_bloomAttr = _bloomFilter->FindAttr (attrOffset, attrType, attrLength);
+
 	} 
 
 	// initialize the status
 	_scanInfo.state = Open;
 	_scanInfo.recordsCount = header.recordSize;
+	_scanInfo.recordsPerPage = _recFile->numSlots ( );
 	_scanInfo.scanedPage = BeginPage;
 	_scanInfo.scanedSlot = 0;
 	
@@ -157,20 +206,124 @@ inline RETCODE RecordFileScan::OpenScan (const RecordFilePtr & fileHandle, AttrT
 	return RETCODE::COMPLETE;
 }
 
-inline RETCODE RecordFileScan::GetNextRec (Record & rec) {
+/*
+	1. EQ_OP and NE_OP compare the int codes directly, the value is looked up in the dictionary once
+	2. The codes do not follow the order of the values, so the other operators are evaluated on every entry
+	   of the dictionary first, and a record is selected by testing its code in the result
+*/
+inline RETCODE RecordFileScan::OpenScan (const RecordFilePtr & fileHandle, const StringDictionaryPtr & dict, size_t attrOffset, CompOp compOp, void * value) {
+	RETCODE result;
+	int code;
 
-	if ( _scanInfo.state != ScanState::Open )
+	if ( dict == nullptr )
 		return RETCODE::INVALIDSCAN;
-	else if ( _scanInfo.state == End )
+
+	if ( value == nullptr || compOp == NO_OP )
+		return OpenScan (fileHandle, INT, sizeof (int), attrOffset, NO_OP, nullptr);
+
+	if ( compOp == EQ_OP || compOp == NE_OP ) {
+		if ( dict->Lookup (reinterpret_cast< const char* >( value ), code) == RETCODE::COMPLETE )
+			return OpenScan (fileHandle, INT, sizeof (int), attrOffset, compOp, &code);
+
+		// the value does not appear in the table
+		if ( result = OpenScan (fileHandle, INT, sizeof (int), attrOffset, NO_OP, nullptr) )
+			return result;
+
+		if ( compOp == EQ_OP )
+			_scanInfo.state = End;
+
+		return RETCODE::COMPLETE;
+	}
+
+	std::vector<bool> codes;
+
+	if ( ( result = dict->Match (compOp, value, codes) )
+		 || ( result = OpenScan (fileHandle, INT, sizeof (int), attrOffset, NO_OP, nullptr) ) )
+		return result;
+
+	_attrOffset = attrOffset;
+	_codeSet.swap (codes);
+	_useCodeSet = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The free slot map of the current page is kept until the scan moves to the next page
+*/
+inline RETCODE RecordFileScan::isFreeSlot (PageNum page, SlotNum slot, bool & isFree) {
+	RETCODE result;
+	PageNum curPage = Utils::UNKNOWNPAGENUM;
+
+	if ( _curPage != nullptr )
+		_curPage->GetPageNum (curPage);
+
+	if ( curPage != page ) {
+		RecordPageHeader pHdr (_scanInfo.recordsPerPage);
+
+		if ( ( result = _recFile->bufMgr->GetPage (page, _curPage) ) || ( result = _recFile->bufMgr->UnlockPage (page) )
+			 || ( result = _recFile->GetPageHeader (_curPage, pHdr) ) ) {
+			_curPage = nullptr;
+			return result;
+		}
+
+		Bitmap bm (pHdr.getFreeSlotMap ( ), _scanInfo.recordsPerPage);
+
+		_freeSlots.resize (_scanInfo.recordsPerPage);
+		for ( size_t i = 0; i < _scanInfo.recordsPerPage; i++ )
+			_freeSlots[i] = bm.test (i);
+	}
+
+	isFree = _freeSlots[slot];
+
+	return RETCODE::COMPLETE;
+}
+
+inline bool RecordFileScan::satisfies (char * recData) const {
+	if ( _useCodeSet ) {
+		int code = *reinterpret_cast< int* >( recData + _attrOffset );
+		return code >= 0 && static_cast< size_t >( code ) < _codeSet.size ( ) && _codeSet[code];
+	}
+
+	return _comp == nullptr || _comp (recData + _attrOffset, _attrValue, _attrType, _attrLength);
+}
+
+inline RETCODE RecordFileScan::GetNextRec (Record & rec) {
+
+	if ( _scanInfo.state == ScanState::End )
 		return RETCODE::EOFSCAN;
+	else if ( _scanInfo.state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
 	
 	Record tmpRec;
 	RETCODE result;
 	char * recData;
 
 	for ( ;; ) {
+		PageNum page = _scanInfo.scanedPage;
+		SlotNum slot = _scanInfo.scanedSlot;
+		bool isFree;
+
+		if ( slot == 0 && _bloomAttr != Utils::UNKNOWNPOS && page <= _recFile->numPages ( ) ) {
+			if ( _bloomFilter->IsStale (page) && ( result = _recFile->rebuildBloomFilter (page) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
 
-		if ( result = _recFile->GetRec (RecordIdentifier{ _scanInfo.scanedPage, _scanInfo.scanedSlot }, tmpRec) ) {
+			if ( !_bloomFilter->MayContain (page, _bloomAttr, _attrValue) ) {
+				// no record of the page group has the value
+				_scanInfo.scanedPage = BloomFilter::FirstPageOfGroup (page) + BloomFilter::GROUPPAGES;
+				continue;
+			}
+		}
+
+		if ( slot == 0 && _zoneAttr != Utils::UNKNOWNPOS && page <= _recFile->numPages ( )
+			 && !_zoneMap->MayMatch (page, _zoneAttr, _compOp, _attrValue) ) {
+			_scanInfo.scanedPage++;			// no record of the page satisfies the condition
+			continue;
+		}
+
+		if ( result = _recFile->GetRec (RecordIdentifier{ page, slot }, tmpRec) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 
 			if ( result == RETCODE::EOFFILE ) {
@@ -185,12 +338,20 @@ inline RETCODE RecordFileScan::GetNextRec (Record & rec) {
 			_scanInfo.scanedSlot = 0;
 		}
 
+		if ( result = isFreeSlot (page, slot, isFree) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( isFree )			// deleted or never used
+			continue;
+
 		if ( result = tmpRec.GetData (recData) ) {
 			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 			return result;
 		}
 
-		if ( _comp == nullptr || _comp (recData , _attrValue, _attrType, _attrLength) ) {	// if satisfies the condition
+		if ( satisfies (recData) ) {	// if satisfies the condition
 			rec = tmpRec;
 			break;
 		}
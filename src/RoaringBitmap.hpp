@@ -0,0 +1,453 @@
+#pragma once
+
+/*
+	1. RoaringBitmap is a compressed set of 32 bit numbers, the high 16 bits of a number pick a container that holds the low 16 bits
+	2. A container with at most ARRAYMAX numbers keeps them as a sorted array, a fuller one as a Bitmap of 65536 bits,
+	   so a sparse container takes 2 bytes a number and a dense one never more than 8KB
+	3. And, Or and AndNot combine two bitmaps container by container, a Bitmap container is shared between copies
+	   until one of them changes it
+	4. Serialize writes the number of containers and then every container: key, kind, cardinality and the numbers or the bits
+*/
+
+#include "Utils.hpp"
+#include "Bitmap.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+class RoaringBitmap {
+public:
+
+	static constexpr size_t ARRAYMAX = 4096;		// a container with more numbers is a Bitmap
+
+	static constexpr size_t CONTAINERBITS = 65536;
+
+	RoaringBitmap ( );
+	~RoaringBitmap ( );
+
+	void Add (uint32_t value);
+
+	void Remove (uint32_t value);
+
+	bool Contains (uint32_t value) const;
+
+	size_t Cardinality ( ) const;
+
+	bool IsEmpty ( ) const;
+
+	RoaringBitmap And (const RoaringBitmap & other) const;
+
+	RoaringBitmap Or (const RoaringBitmap & other) const;
+
+	RoaringBitmap AndNot (const RoaringBitmap & other) const;		// the numbers not in other
+
+	void ToArray (std::vector<uint32_t> & values) const;		// in ascending order
+
+	size_t SerializedSize ( ) const;
+
+	void Serialize (char * buf) const;
+
+	RETCODE Deserialize (const char * buf, size_t length);		// BADENTRY if buf does not hold a bitmap of length bytes
+
+private:
+
+	struct Container {
+		uint16_t key;						// the high 16 bits
+
+		std::vector<uint16_t> values;		// sorted, when bits is nullptr
+
+		std::shared_ptr<Bitmap> bits;
+
+		size_t cardinality;
+	};
+
+	size_t find (uint16_t key) const;		// the first container whose key is not less than key
+
+	static void ownBits (Container & container);		// a Bitmap of its own before it is changed
+
+	static void toBits (Container & container);
+
+	static void toArray (Container & container);
+
+	static void fit (Container & container);		// the kind that fits the cardinality
+
+	static Container andOf (const Container & a, const Container & b);
+
+	static Container orOf (const Container & a, const Container & b);
+
+	static Container andNotOf (const Container & a, const Container & b);
+
+	std::vector<Container> _containers;		// sorted by key, none is empty
+
+};
+
+RoaringBitmap::RoaringBitmap ( ) {
+}
+
+RoaringBitmap::~RoaringBitmap ( ) {
+}
+
+inline void RoaringBitmap::Add (uint32_t value) {
+	uint16_t key = static_cast< uint16_t >( value >> 16 ), low = static_cast< uint16_t >( value & 0xFFFF );
+	size_t pos = find (key);
+
+	if ( pos == _containers.size ( ) || _containers[pos].key != key )
+		_containers.insert (_containers.begin ( ) + pos, Container { key, { }, nullptr, 0 });
+
+	Container & container = _containers[pos];
+
+	if ( container.bits == nullptr ) {
+		auto it = std::lower_bound (container.values.begin ( ), container.values.end ( ), low);
+
+		if ( it != container.values.end ( ) && *it == low )
+			return;
+
+		container.values.insert (it, low);
+	} else {
+		if ( container.bits->test (low) )
+			return;
+
+		ownBits (container);
+		container.bits->set (low);
+	}
+
+	container.cardinality++;
+	fit (container);
+}
+
+inline void RoaringBitmap::Remove (uint32_t value) {
+	uint16_t key = static_cast< uint16_t >( value >> 16 ), low = static_cast< uint16_t >( value & 0xFFFF );
+	size_t pos = find (key);
+
+	if ( pos == _containers.size ( ) || _containers[pos].key != key )
+		return;
+
+	Container & container = _containers[pos];
+
+	if ( container.bits == nullptr ) {
+		auto it = std::lower_bound (container.values.begin ( ), container.values.end ( ), low);
+
+		if ( it == container.values.end ( ) || *it != low )
+			return;
+
+		container.values.erase (it);
+	} else {
+		if ( !container.bits->test (low) )
+			return;
+
+		ownBits (container);
+		container.bits->reset (low);
+	}
+
+	if ( --container.cardinality == 0 )
+		_containers.erase (_containers.begin ( ) + pos);
+	else
+		fit (container);
+}
+
+inline bool RoaringBitmap::Contains (uint32_t value) const {
+	uint16_t key = static_cast< uint16_t >( value >> 16 ), low = static_cast< uint16_t >( value & 0xFFFF );
+	size_t pos = find (key);
+
+	if ( pos == _containers.size ( ) || _containers[pos].key != key )
+		return false;
+
+	const Container & container = _containers[pos];
+
+	if ( container.bits != nullptr )
+		return container.bits->test (low);
+
+	return std::binary_search (container.values.begin ( ), container.values.end ( ), low);
+}
+
+inline size_t RoaringBitmap::Cardinality ( ) const {
+	size_t n = 0;
+
+	for ( const Container & container : _containers )
+		n += container.cardinality;
+
+	return n;
+}
+
+inline bool RoaringBitmap::IsEmpty ( ) const {
+	return _containers.empty ( );
+}
+
+inline RoaringBitmap RoaringBitmap::And (const RoaringBitmap & other) const {
+	RoaringBitmap result;
+	size_t i = 0, j = 0;
+
+	while ( i < _containers.size ( ) && j < other._containers.size ( ) ) {
+		if ( _containers[i].key < other._containers[j].key )
+			i++;
+		else if ( _containers[i].key > other._containers[j].key )
+			j++;
+		else {
+			Container container = andOf (_containers[i++], other._containers[j++]);
+
+			if ( container.cardinality > 0 )
+				result._containers.push_back (std::move (container));
+		}
+	}
+
+	return result;
+}
+
+inline RoaringBitmap RoaringBitmap::Or (const RoaringBitmap & other) const {
+	RoaringBitmap result;
+	size_t i = 0, j = 0;
+
+	while ( i < _containers.size ( ) || j < other._containers.size ( ) ) {
+		if ( j == other._containers.size ( ) || ( i < _containers.size ( ) && _containers[i].key < other._containers[j].key ) )
+			result._containers.push_back (_containers[i++]);
+		else if ( i == _containers.size ( ) || _containers[i].key > other._containers[j].key )
+			result._containers.push_back (other._containers[j++]);
+		else
+			result._containers.push_back (orOf (_containers[i++], other._containers[j++]));
+	}
+
+	return result;
+}
+
+inline RoaringBitmap RoaringBitmap::AndNot (const RoaringBitmap & other) const {
+	RoaringBitmap result;
+	size_t j = 0;
+
+	for ( const Container & container : _containers ) {
+		while ( j < other._containers.size ( ) && other._containers[j].key < container.key )
+			j++;
+
+		if ( j == other._containers.size ( ) || other._containers[j].key != container.key ) {
+			result._containers.push_back (container);
+			continue;
+		}
+
+		Container rest = andNotOf (container, other._containers[j]);
+
+		if ( rest.cardinality > 0 )
+			result._containers.push_back (std::move (rest));
+	}
+
+	return result;
+}
+
+inline void RoaringBitmap::ToArray (std::vector<uint32_t> & values) const {
+	values.clear ( );
+	values.reserve (Cardinality ( ));
+
+	for ( const Container & container : _containers ) {
+		uint32_t high = static_cast< uint32_t >( container.key ) << 16;
+
+		if ( container.bits == nullptr ) {
+			for ( uint16_t low : container.values )
+				values.push_back (high | low);
+		} else {
+			for ( unsigned int low = container.bits->next (0); low < CONTAINERBITS; low = container.bits->next (low + 1) )
+				values.push_back (high | low);
+		}
+	}
+}
+
+inline size_t RoaringBitmap::SerializedSize ( ) const {
+	size_t length = sizeof (uint32_t);
+
+	for ( const Container & container : _containers )
+		length += sizeof (uint16_t) * 2 + sizeof (uint32_t)
+		+ ( container.bits == nullptr ? container.cardinality * sizeof (uint16_t) : CONTAINERBITS / 8 );
+
+	return length;
+}
+
+inline void RoaringBitmap::Serialize (char * buf) const {
+	uint32_t count = static_cast< uint32_t >( _containers.size ( ) );
+
+	memcpy (buf, &count, sizeof (count));
+	buf += sizeof (count);
+
+	for ( const Container & container : _containers ) {
+		uint16_t kind = container.bits == nullptr ? 0 : 1;
+		uint32_t cardinality = static_cast< uint32_t >( container.cardinality );
+
+		memcpy (buf, &container.key, sizeof (uint16_t));
+		memcpy (buf + sizeof (uint16_t), &kind, sizeof (uint16_t));
+		memcpy (buf + sizeof (uint16_t) * 2, &cardinality, sizeof (uint32_t));
+		buf += sizeof (uint16_t) * 2 + sizeof (uint32_t);
+
+		if ( kind == 0 ) {
+			memcpy (buf, container.values.data ( ), container.cardinality * sizeof (uint16_t));
+			buf += container.cardinality * sizeof (uint16_t);
+		} else {
+			container.bits->to_char_buf (buf, CONTAINERBITS / 8);
+			buf += CONTAINERBITS / 8;
+		}
+	}
+}
+
+inline RETCODE RoaringBitmap::Deserialize (const char * buf, size_t length) {
+	const char * end = buf + length;
+	uint32_t count;
+
+	_containers.clear ( );
+
+	if ( length < sizeof (count) )
+		return RETCODE::BADENTRY;
+
+	memcpy (&count, buf, sizeof (count));
+	buf += sizeof (count);
+
+	for ( uint32_t i = 0; i < count; i++ ) {
+		Container container;
+		uint16_t kind;
+		uint32_t cardinality;
+
+		if ( static_cast< size_t >( end - buf ) < sizeof (uint16_t) * 2 + sizeof (uint32_t) )
+			return RETCODE::BADENTRY;
+
+		memcpy (&container.key, buf, sizeof (uint16_t));
+		memcpy (&kind, buf + sizeof (uint16_t), sizeof (uint16_t));
+		memcpy (&cardinality, buf + sizeof (uint16_t) * 2, sizeof (uint32_t));
+		buf += sizeof (uint16_t) * 2 + sizeof (uint32_t);
+		container.cardinality = cardinality;
+
+		size_t bytes = kind == 0 ? cardinality * sizeof (uint16_t) : CONTAINERBITS / 8;
+
+		if ( static_cast< size_t >( end - buf ) < bytes || cardinality == 0 || cardinality > CONTAINERBITS )
+			return RETCODE::BADENTRY;
+
+		if ( kind == 0 ) {
+			container.values.resize (cardinality);
+			memcpy (container.values.data ( ), buf, bytes);
+		} else
+			container.bits = std::make_shared<Bitmap> (const_cast< char* >( buf ), CONTAINERBITS);
+
+		buf += bytes;
+		_containers.push_back (std::move (container));
+	}
+
+	return buf == end ? RETCODE::COMPLETE : RETCODE::BADENTRY;
+}
+
+inline size_t RoaringBitmap::find (uint16_t key) const {
+	auto it = std::lower_bound (_containers.begin ( ), _containers.end ( ), key,
+								[] (const Container & container, uint16_t k) { return container.key < k; });
+
+	return it - _containers.begin ( );
+}
+
+inline void RoaringBitmap::ownBits (Container & container) {
+	if ( container.bits.use_count ( ) > 1 )
+		container.bits = std::make_shared<Bitmap> (*container.bits);
+}
+
+inline void RoaringBitmap::toBits (Container & container) {
+	container.bits = std::make_shared<Bitmap> (CONTAINERBITS);
+
+	for ( uint16_t low : container.values )
+		container.bits->set (low);
+
+	container.values.clear ( );
+	container.values.shrink_to_fit ( );
+}
+
+inline void RoaringBitmap::toArray (Container & container) {
+	container.values.clear ( );
+	container.values.reserve (container.cardinality);
+
+	for ( unsigned int low = container.bits->next (0); low < CONTAINERBITS; low = container.bits->next (low + 1) )
+		container.values.push_back (static_cast< uint16_t >( low ));
+
+	container.bits = nullptr;
+}
+
+inline void RoaringBitmap::fit (Container & container) {
+	if ( container.bits == nullptr && container.cardinality > ARRAYMAX )
+		toBits (container);
+	else if ( container.bits != nullptr && container.cardinality <= ARRAYMAX )
+		toArray (container);
+}
+
+inline RoaringBitmap::Container RoaringBitmap::andOf (const Container & a, const Container & b) {
+	Container result { a.key, { }, nullptr, 0 };
+
+	if ( a.bits != nullptr && b.bits != nullptr ) {
+		result.bits = std::make_shared<Bitmap> (*a.bits);
+		result.bits->and_with (*b.bits);
+		result.cardinality = result.bits->count ( );
+		fit (result);
+	} else if ( a.bits == nullptr && b.bits == nullptr ) {
+		std::set_intersection (a.values.begin ( ), a.values.end ( ), b.values.begin ( ), b.values.end ( ), std::back_inserter (result.values));
+		result.cardinality = result.values.size ( );
+	} else {
+		const Container & array = a.bits == nullptr ? a : b;
+		const Container & bits = a.bits == nullptr ? b : a;
+
+		for ( uint16_t low : array.values )
+			if ( bits.bits->test (low) )
+				result.values.push_back (low);
+
+		result.cardinality = result.values.size ( );
+	}
+
+	return result;
+}
+
+inline RoaringBitmap::Container RoaringBitmap::orOf (const Container & a, const Container & b) {
+	Container result { a.key, { }, nullptr, 0 };
+
+	if ( a.bits == nullptr && b.bits == nullptr ) {
+		std::set_union (a.values.begin ( ), a.values.end ( ), b.values.begin ( ), b.values.end ( ), std::back_inserter (result.values));
+		result.cardinality = result.values.size ( );
+		fit (result);
+		return result;
+	}
+
+	if ( a.bits != nullptr && b.bits != nullptr ) {
+		result.bits = std::make_shared<Bitmap> (*a.bits);
+		result.bits->or_with (*b.bits);
+	} else {
+		const Container & array = a.bits == nullptr ? a : b;
+
+		result.bits = std::make_shared<Bitmap> (a.bits == nullptr ? *b.bits : *a.bits);
+
+		for ( uint16_t low : array.values )
+			result.bits->set (low);
+	}
+
+	result.cardinality = result.bits->count ( );
+
+	return result;
+}
+
+inline RoaringBitmap::Container RoaringBitmap::andNotOf (const Container & a, const Container & b) {
+	Container result { a.key, { }, nullptr, 0 };
+
+	if ( a.bits == nullptr ) {
+		if ( b.bits == nullptr )
+			std::set_difference (a.values.begin ( ), a.values.end ( ), b.values.begin ( ), b.values.end ( ), std::back_inserter (result.values));
+		else {
+			for ( uint16_t low : a.values )
+				if ( !b.bits->test (low) )
+					result.values.push_back (low);
+		}
+
+		result.cardinality = result.values.size ( );
+		return result;
+	}
+
+	result.bits = std::make_shared<Bitmap> (*a.bits);
+
+	if ( b.bits != nullptr )
+		result.bits->and_not (*b.bits);
+	else {
+		for ( uint16_t low : b.values )
+			result.bits->reset (low);
+	}
+
+	result.cardinality = result.bits->count ( );
+	fit (result);
+
+	return result;
+}
@@ -1,15 +1,373 @@
 #include "Utils.hpp"
 #include "Server.hpp"
 #include "IndexManager.hpp"
+#include "ParallelRecordFileScan.hpp"
+#include "KeyPolicy.hpp"
 
 
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 
 using namespace std;
 
-int main ( ) {
+/*
+	Timed runs, started with the name of the run as the first argument
+*/
+
+static double ElapsedMs (chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli> (chrono::steady_clock::now ( ) - start).count ( );
+}
+
+/*
+	Full scan of a cold RecordFile by 1, 2, 4 and 8 workers of a ParallelRecordFileScan
+	The file is reopened before every run so that all pages come from the disk file
+*/
+static int BenchParallelScan (size_t numRecs) {
+	const char * filename = "bench.scan";
+	const size_t recordSize = 64;
+
+	RecordFileManagerPtr recMgr = make_shared<RecordFileManager> ( );
+	RecordFilePtr file;
+	RETCODE result;
+	vector<char> row (recordSize);
+	RecordIdentifier rid;
+
+	if ( Utils::IsFileExist (filename) )
+		recMgr->DestroyFile (filename);
+
+	if ( ( result = recMgr->CreateFile (filename, recordSize) ) || ( result = recMgr->OpenFile (filename, file) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for ( size_t i = 0; i < numRecs; i++ ) {
+		int key = static_cast< int >( i % 1000 );
+		memcpy (row.data ( ), &key, sizeof (key));
+		if ( result = file->InsertRec (row.data ( ), rid) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return 1;
+		}
+	}
+
+	recMgr->CloseFile (file);
+	file = nullptr;			// the page count is written when the PageFile is released
+
+	for ( size_t workers : { 1, 2, 4, 8 } ) {
+		RecordFilePtr coldFile;
+		ParallelRecordFileScan scan (workers);
+		Record rec;
+		size_t count = 0;
+		int value = 7;
+
+		if ( result = recMgr->OpenFile (filename, coldFile) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		auto start = chrono::steady_clock::now ( );
+
+		scan.OpenScan (coldFile, AttrType::INT, 4, 0, EQ_OP, &value);
+		while ( scan.GetNextRec (rec) == RETCODE::COMPLETE )
+			count++;
+		scan.CloseScan ( );
+
+		cout << "scan " << workers << " workers: " << ElapsedMs (start) << " ms, " << count << " records" << endl;
+
+		recMgr->CloseFile (coldFile);
+		coldFile = nullptr;
+	}
+
+	recMgr->DestroyFile (filename);
+
+	return 0;
+}
+
+/*
+	IntKeyPolicy without the SIMD count, the baseline of BenchKeySearch
+*/
+struct ScalarIntKeyPolicy {
+	static const size_t WINDOW = KeySearch::SIMDWINDOW;
+
+	static bool Less (const void * a, const void * b, size_t length) {
+		return IntKeyPolicy::Less (a, b, length);
+	}
+
+	template <bool Upper>
+	static size_t Count (const char * keys, size_t n, size_t length, const void * key) {
+		return KeySearch::CountScalar<ScalarIntKeyPolicy, Upper> (keys, n, length, key);
+	}
+};
+
+/*
+	LowerBound in a node of INT keys: the SIMD policy, the same search counting one key at a time,
+	std::lower_bound and a linear search
+*/
+static int BenchKeySearch (size_t numSearches) {
+	mt19937 gen (1);
+
+	for ( size_t numKeys : { 16, 64, 256, 1000 } ) {
+		vector<int> keys (numKeys);
+		vector<int> probes (numSearches);
+
+		for ( size_t i = 0; i < numKeys; i++ )
+			keys[i] = static_cast< int >( i * 3 );
+		for ( auto & probe : probes )
+			probe = static_cast< int >( gen ( ) % ( numKeys * 3 + 3 ) );
+
+		const char * data = reinterpret_cast< const char* >( keys.data ( ) );
+		size_t check = 0;
+
+		auto run = [&] (const char * name, auto search) {
+			size_t sum = 0;
+			auto start = chrono::steady_clock::now ( );
+
+			for ( int probe : probes )
+				sum += search (probe);
+
+			cout << "keys " << numKeys << " " << name << ": " << ElapsedMs (start) * 1e6 / numSearches << " ns" << endl;
+
+			if ( check == 0 )
+				check = sum;
+			else if ( sum != check )
+				cout << "  result differs" << endl;
+		};
+
+		run ("simd", [&] (int probe) { return KeySearch::LowerBound<IntKeyPolicy> (data, numKeys, sizeof (int), &probe); });
+		run ("scalar", [&] (int probe) { return KeySearch::LowerBound<ScalarIntKeyPolicy> (data, numKeys, sizeof (int), &probe); });
+		run ("binary", [&] (int probe) { return static_cast< size_t >( lower_bound (keys.begin ( ), keys.end ( ), probe) - keys.begin ( ) ); });
+		run ("linear", [&] (int probe) {
+			size_t i = 0;
+			while ( i < numKeys && keys[i] < probe )
+				i++;
+			return i;
+		});
+	}
+
+	return 0;
+}
+
+/*
+	Inserts and EQ lookups of distinct INT keys in a B+ tree by 1, 2, 4 and 8 threads,
+	the keys of every run go to a new index. Every thread inserts and then looks up its own share of the keys
+*/
+static int BenchIndexThreads (size_t numKeys) {
+	const char * filename = "bench.index";
+
+	IndexManagerPtr ixMgr = make_shared<IndexManager> ( );
+	RETCODE result;
+	vector<int> keys (numKeys);
+	mt19937 gen (1);
+
+	for ( size_t i = 0; i < numKeys; i++ )
+		keys[i] = static_cast< int >( i );
+	shuffle (keys.begin ( ), keys.end ( ), gen);
+
+	for ( size_t threads : { 1, 2, 4, 8 } ) {
+		IndexHandlePtr index;
+		vector<thread> workers;
+		atomic<size_t> failed (0);
+
+		if ( Utils::IsFileExist (filename) )
+			ixMgr->DestroyIndex (filename);
+
+		if ( ( result = ixMgr->CreateIndex (filename, AttrType::INT, sizeof (int)) ) || ( result = ixMgr->OpenIndex (filename, index) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return 1;
+		}
+
+		auto run = [&] (const char * name, auto work) {
+			auto start = chrono::steady_clock::now ( );
+
+			for ( size_t t = 0; t < threads; t++ )
+				workers.emplace_back ([&, t] ( ) {
+					for ( size_t i = t; i < numKeys; i += threads )
+						if ( !work (i) )
+							failed++;
+				});
+			for ( auto & worker : workers )
+				worker.join ( );
+			workers.clear ( );
+
+			double ms = ElapsedMs (start);
+			cout << name << " " << threads << " threads: " << ms << " ms, " << numKeys / ms << " K/s" << endl;
+		};
+
+		run ("insert", [&] (size_t i) {
+			RecordIdentifier rid (static_cast< PageNum >( i / 100 + 2 ), static_cast< SlotNum >( i % 100 ));
+			return index->InsertEntry (&keys[i], rid) == RETCODE::COMPLETE;
+		});
+
+		run ("lookup", [&] (size_t i) {
+			IndexScan scan;
+			RecordIdentifier rid;
+			bool found = scan.OpenScan (index, EQ_OP, &keys[i]) == RETCODE::COMPLETE && scan.GetNextEntry (rid) == RETCODE::COMPLETE;
+			scan.CloseScan ( );
+			return found;
+		});
+
+		if ( failed )
+			cout << "  " << failed << " operations failed" << endl;
+
+		ixMgr->CloseIndex (index);
+		index = nullptr;
+	}
+
+	ixMgr->DestroyIndex (filename);
+
+	return 0;
+}
+
+/*
+	Insert 1..numKeys, delete the upper part and reopen the index so that its last leaf is empty,
+	then every key inserted again must be found next to the entry it already had
+*/
+static int CheckReopenAfterDelete (size_t numKeys) {
+	const char * filename = "check.index";
+
+	IndexManagerPtr ixMgr = make_shared<IndexManager> ( );
+	IndexHandlePtr index;
+	RETCODE result;
+	int kept = static_cast< int >( numKeys / 5 );
+	size_t failed = 0;
+
+	if ( Utils::IsFileExist (filename) )
+		ixMgr->DestroyIndex (filename);
+
+	if ( ( result = ixMgr->CreateIndex (filename, AttrType::INT, sizeof (int)) ) || ( result = ixMgr->OpenIndex (filename, index) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for ( int key = 1; key <= static_cast< int >( numKeys ); key++ )
+		if ( index->InsertEntry (&key, RecordIdentifier (static_cast< PageNum >( key + 2 ), 0)) )
+			failed++;
+
+	for ( int key = kept + 1; key <= static_cast< int >( numKeys ); key++ )
+		if ( index->DeleteEntry (&key, RecordIdentifier (static_cast< PageNum >( key + 2 ), 0)) )
+			failed++;
+
+	ixMgr->CloseIndex (index);
+	index = nullptr;
+
+	if ( result = ixMgr->OpenIndex (filename, index) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for ( int key : { 1, kept / 2, kept, kept + 1, static_cast< int >( numKeys ) } ) {
+		size_t found = 0;
+		IndexScan scan;
+		RecordIdentifier rid;
+
+		if ( index->InsertEntry (&key, RecordIdentifier (static_cast< PageNum >( key + 2 ), 1)) )
+			failed++;
+
+		if ( scan.OpenScan (index, EQ_OP, &key) == RETCODE::COMPLETE )
+			while ( scan.GetNextEntry (rid) == RETCODE::COMPLETE )
+				found++;
+		scan.CloseScan ( );
+
+		if ( found != ( key <= kept ? 2 : 1 ) ) {
+			cout << "key " << key << ": " << found << " entries" << endl;
+			failed++;
+		}
+	}
+
+	ixMgr->CloseIndex (index);
+	index = nullptr;
+	ixMgr->DestroyIndex (filename);
+
+	cout << "reopen after delete: " << ( failed ? "failed" : "ok" ) << endl;
+
+	return failed ? 1 : 0;
+}
+
+/*
+	A long STRING key in the middle of short ones spreads a full leaf over three or more nodes,
+	the insert must return and every key must still be found
+*/
+static int CheckWideKeySplit (size_t numKeys) {
+	const char * filename = "check.index";
+	const size_t keyLen = 200;
+
+	IndexManagerPtr ixMgr = make_shared<IndexManager> ( );
+	IndexHandlePtr index;
+	RETCODE result;
+	vector<char> key (keyLen);
+	size_t failed = 0;
+
+	if ( Utils::IsFileExist (filename) )
+		ixMgr->DestroyIndex (filename);
+
+	if ( ( result = ixMgr->CreateIndex (filename, AttrType::STRING, keyLen) ) || ( result = ixMgr->OpenIndex (filename, index) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return 1;
+	}
+
+	for ( size_t i = 0; i < numKeys; i++ ) {
+		fill (key.begin ( ), key.end ( ), 0);
+		snprintf (key.data ( ), keyLen, "%05zu", i);
+
+		if ( index->InsertEntry (key.data ( ), RecordIdentifier (static_cast< PageNum >( i + 2 ), 0)) )
+			failed++;
+	}
+
+	// sorts right after the key numKeys / 3, and no node has room for it next to the short keys of its leaf
+	vector<char> wide (keyLen, 0);
+	snprintf (wide.data ( ), keyLen, "%05zu", numKeys / 3);
+	fill (wide.begin ( ) + 5, wide.end ( ) - 1, 'z');
+
+	if ( index->InsertEntry (wide.data ( ), RecordIdentifier (static_cast< PageNum >( numKeys + 2 ), 0)) )
+		failed++;
+
+	for ( size_t i = 0; i <= numKeys; i++ ) {
+		size_t found = 0;
+		IndexScan scan;
+		RecordIdentifier rid;
+
+		fill (key.begin ( ), key.end ( ), 0);
+		snprintf (key.data ( ), keyLen, "%05zu", i);
+
+		if ( scan.OpenScan (index, EQ_OP, i < numKeys ? key.data ( ) : wide.data ( )) == RETCODE::COMPLETE )
+			while ( scan.GetNextEntry (rid) == RETCODE::COMPLETE )
+				found++;
+		scan.CloseScan ( );
+
+		if ( found != 1 )
+			failed++;
+	}
+
+	ixMgr->CloseIndex (index);
+	index = nullptr;
+	ixMgr->DestroyIndex (filename);
+
+	cout << "wide key split: " << ( failed ? "failed" : "ok" ) << endl;
+
+	return failed ? 1 : 0;
+}
+
+int main (int argc, char * argv[]) {
+
+	if ( argc > 1 && strcmp (argv[1], "scan") == 0 )
+		return BenchParallelScan (argc > 2 ? strtoul (argv[2], nullptr, 10) : 200000);
+
+	if ( argc > 1 && strcmp (argv[1], "keysearch") == 0 )
+		return BenchKeySearch (argc > 2 ? strtoul (argv[2], nullptr, 10) : 1000000);
+
+	if ( argc > 1 && strcmp (argv[1], "index") == 0 )
+		return BenchIndexThreads (argc > 2 ? strtoul (argv[2], nullptr, 10) : 200000);
+
+	if ( argc > 1 && strcmp (argv[1], "reopen") == 0 )
+		return CheckReopenAfterDelete (argc > 2 ? strtoul (argv[2], nullptr, 10) : 5000);
+
+	if ( argc > 1 && strcmp (argv[1], "split") == 0 )
+		return CheckWideKeySplit (argc > 2 ? strtoul (argv[2], nullptr, 10) : 3000);
 
 	IndexManagerPtr ixMgr = make_shared<IndexManager> ( );
 
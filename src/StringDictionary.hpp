@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+	1. StringDictionary is the in-memory copy of the dictionary of one dictionary encoded STRING attribute
+	2. The entries are stored in dictcat, codes are given in the order the values are first seen and never change
+	3. A record stores the int code at the offset of the attribute, so predicates are evaluated on the codes
+*/
+
+#include "Utils.hpp"
+
+#include <map>
+#include <vector>
+
+class StringDictionary {
+
+public:
+
+	StringDictionary (size_t attrLength);
+	~StringDictionary ( );
+
+	RETCODE Lookup (const char * value, int & code) const;			// ENTRYNOTFOUND if the value is not in the dictionary
+
+	RETCODE Insert (const char * value, int & code, bool & added);	// return the code of value, add it if not found
+
+	RETCODE Load (int code, const char * value);					// add an entry read from dictcat
+
+	RETCODE GetValue (int code, char * value) const;				// value must hold attrLength bytes
+
+	RETCODE Match (CompOp compOp, void * value, std::vector<bool> & codes) const;	// codes[i] is true if the value of code i satisfies the condition
+
+	size_t Size ( ) const;
+
+	size_t AttrLength ( ) const;
+
+private:
+
+	std::string key (const char * value) const;
+
+	size_t _attrLength;
+
+	std::map<std::string, int> _codes;
+
+	std::vector<std::string> _values;
+
+};
+
+using StringDictionaryPtr = shared_ptr<StringDictionary>;
+
+StringDictionary::StringDictionary (size_t attrLength) {
+	_attrLength = attrLength;
+}
+
+StringDictionary::~StringDictionary ( ) {
+}
+
+inline RETCODE StringDictionary::Lookup (const char * value, int & code) const {
+	if ( value == nullptr )
+		return RETCODE::BADENTRY;
+
+	auto it = _codes.find (key (value));
+
+	if ( it == _codes.end ( ) )
+		return RETCODE::ENTRYNOTFOUND;
+
+	code = it->second;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE StringDictionary::Insert (const char * value, int & code, bool & added) {
+	added = false;
+
+	if ( Lookup (value, code) == RETCODE::COMPLETE )
+		return RETCODE::COMPLETE;
+
+	if ( value == nullptr )
+		return RETCODE::BADENTRY;
+
+	code = static_cast< int >( _values.size ( ) );
+	added = true;
+
+	return Load (code, value);
+}
+
+inline RETCODE StringDictionary::Load (int code, const char * value) {
+	if ( value == nullptr || code < 0 )
+		return RETCODE::BADENTRY;
+
+	if ( static_cast< size_t >( code ) >= _values.size ( ) )
+		_values.resize (code + 1);
+
+	_values[code] = key (value);
+	_codes[_values[code]] = code;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE StringDictionary::GetValue (int code, char * value) const {
+	if ( code < 0 || static_cast< size_t >( code ) >= _values.size ( ) )
+		return RETCODE::OUTOFRANGE;
+
+	memset (value, 0, _attrLength);
+	memcpy (value, _values[code].data ( ), _values[code].size ( ));
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE StringDictionary::Match (CompOp compOp, void * value, std::vector<bool> & codes) const {
+	bool (*comp) ( void*, void*, AttrType, size_t );
+
+	switch ( compOp ) {
+	case EQ_OP:
+		comp = CompMethod::equal;
+		break;
+	case LT_OP:
+		comp = CompMethod::less_than;
+		break;
+	case GT_OP:
+		comp = CompMethod::greater_than;
+		break;
+	case LE_OP:
+		comp = CompMethod::less_than_or_eq_to;
+		break;
+	case GE_OP:
+		comp = CompMethod::greater_than_or_eq_to;
+		break;
+	case NE_OP:
+		comp = CompMethod::not_equal;
+		break;
+	default:
+		return RETCODE::BADOP;
+	}
+
+	std::vector<char> buf (_attrLength);
+	codes.assign (_values.size ( ), false);
+
+	for ( size_t i = 0; i < _values.size ( ); i++ ) {		// evaluate the condition once per distinct value
+		GetValue (static_cast< int >( i ), buf.data ( ));
+		codes[i] = comp (buf.data ( ), value, STRING, _attrLength);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline size_t StringDictionary::Size ( ) const {
+	return _values.size ( );
+}
+
+inline size_t StringDictionary::AttrLength ( ) const {
+	return _attrLength;
+}
+
+inline std::string StringDictionary::key (const char * value) const {
+	return std::string (value, strnlen (value, _attrLength));
+}
@@ -3,12 +3,16 @@
 	.1 DataAttrInfo¼ݿһϵһԵϢ, Ĺϵ(), ƫ, , Գ
 	2. DataRelInfo¼ݿĳϵϢ, һ¼ĴС, ()ĸ, ҳ, ܼ¼
 	3. ÿDBʱȴűrelcatattrcat¼ԷֱݿıÿϢ
+	4. dictcat stores the dictionaries of the dictionary encoded STRING attributes, one row per distinct value
 
 */
 #include "Utils.hpp"
 #include "IndexManager.hpp"
 #include "RecordFileManager.hpp"
+#include "ColumnFileManager.hpp"
+#include "MemoryTableScan.hpp"
 #include "PageFileManager.hpp"
+#include "EntrySorter.hpp"
 
 #include <set>
 
@@ -24,10 +28,20 @@ public:
 	RETCODE CloseDb ( );                                  // Close database
 	RETCODE CreateTable (const char *relName,                // Create relation
 											int        attrCount,
-											AttrInfo   *attributes);
+											AttrInfo   *attributes,
+											StorageEngine engine = ROW_ENGINE,
+											const char *primaryKey = nullptr);		// a table with a primary key is CLUSTERED_ENGINE
 	RETCODE DropTable (const char *relName);               // Destroy relation
 	RETCODE CreateIndex (const char *relName,                // Create index
-											const char *attrName);
+											const char *attrName,
+											double fillFactor = 0.9,		// the share of every index node the bulk load fills
+											IndexType indexType = BTREE_INDEX);
+	RETCODE CreateIndex (const char *relName,                // Create a composite index over the attributes in their order
+											int        attrCount,
+											const char * const *attrNames,
+											double fillFactor = 0.9,
+											int        includeCount = 0,		// INCLUDE attributes stored in the leaves for index-only scans
+											const char * const *includeNames = nullptr);
 	RETCODE DropIndex (const char *relName,                // Destroy index
 											const char *attrName);
 	RETCODE Load (const char *relName,                // Load utility
@@ -38,6 +52,21 @@ public:
 	RETCODE Set (const char *paramName,              // Set system parameter
 			const char *value);
 
+	// Get the dictionary of a dictionary encoded attribute, loaded from dictcat on first use
+	RETCODE GetDictionary (const char *relName,
+						   const char *attrName,
+						   StringDictionaryPtr &dict);
+
+	// Get the code to store for value, a new value is added to the dictionary and dictcat
+	RETCODE EncodeValue (const char *relName,
+						 const char *attrName,
+						 const char *value,
+						 int &code);
+
+	// Get the rows of a MEMORY_ENGINE table, the table is empty after the database is opened
+	RETCODE GetMemoryTable (const char *relName,
+							MemoryTablePtr &table);
+
 private:
 	RETCODE IsValid ( ) const;
 
@@ -64,6 +93,10 @@ private:
 					   DataAttrInfo& attr,
 					   RecordIdentifier& rid) const;
 
+	// Remove the file of an index whose build failed so that the index can be created again,
+	// the handles of the index must be released before, result is returned
+	RETCODE AbortIndex (const char* indexName, RETCODE result);
+
 	RETCODE GetNumPages (const char* relName) const;
 	RETCODE GetNumRecords (const char* relName) const;
 
@@ -99,12 +132,20 @@ private:
 
 	RecordFilePtr attrFile;
 
+	RecordFilePtr dictFile;
+
+	std::map<std::string, StringDictionaryPtr> dicts;		// "relName.attrName" -> dictionary
+
+	std::map<std::string, MemoryTablePtr> memTables;		// relName -> rows of a MEMORY_ENGINE table
+
 	bool IsDBOpen;
 
 	IndexManagerPtr indexMgr;
 
 	RecordFileManagerPtr recMgr;
 
+	ColumnFileManagerPtr colMgr;
+
 	std::map<std::string, std::string> config;
 
 };
@@ -117,17 +158,23 @@ SystemManager::SystemManager (const IndexManagerPtr & ixm, const RecordFileManag
 
 	recMgr = rm;
 
+	colMgr = make_shared<ColumnFileManager> ( );
+
 	relFile = nullptr;
 
 	attrFile = nullptr;
 
+	dictFile = nullptr;
+
 }
 
 SystemManager::~SystemManager ( ) {
 	relFile = nullptr;
 	attrFile = nullptr;
+	dictFile = nullptr;
 	indexMgr = nullptr;
 	recMgr = nullptr;
+	colMgr = nullptr;
 }
 
 
@@ -151,6 +198,8 @@ inline RETCODE SystemManager::CreateDb (const char * dbName, PageFileManagerPtr
 	relcat_name += "\\relcat";
 	std::string attrcat_name = dbName;
 	attrcat_name += "\\attrcat";
+	std::string dictcat_name = dbName;
+	dictcat_name += "\\dictcat";
 
 	if ( ( result = recMgr->CreateFile (relcat_name.c_str(), DataRelInfo::size()) ) 
 			|| (result = recMgr->OpenFile (relcat_name.c_str ( ), relFile)) ) {
@@ -164,26 +213,42 @@ inline RETCODE SystemManager::CreateDb (const char * dbName, PageFileManagerPtr
 		return result;
 	}
 
+	if ( result = recMgr->CreateFile (dictcat_name.c_str ( ), DataDictEntry::size ( )) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	// initialize two tables (relations info) 
 	DataRelInfo relcat_rel;
 	strcpy_s  (relcat_rel.relName, "relcat");
 	relcat_rel.attrCount = DataRelInfo::members ( );
 	relcat_rel.recordSize = DataRelInfo::size ( );
 	relcat_rel.numPages = 1;		// initially
-	relcat_rel.numRecords = 2;		// initially only two tables: relcat & attrcat
+	relcat_rel.numRecords = 3;		// initially only three tables: relcat & attrcat & dictcat
+	relcat_rel.engine = ROW_ENGINE;
 
 	DataRelInfo attrcat_rel;
 	strcpy_s  (attrcat_rel.relName, "attrcat");
 	attrcat_rel.attrCount = DataAttrInfo::members ( );
 	attrcat_rel.recordSize = DataAttrInfo::size ( );
 	attrcat_rel.numPages = 1; // initially
-	attrcat_rel.numRecords = DataAttrInfo::members ( ) + DataRelInfo::members ( );	 // initially only these attributes in total
+	attrcat_rel.numRecords = DataAttrInfo::members ( ) + DataRelInfo::members ( ) + DataDictEntry::members ( );	 // initially only these attributes in total
+	attrcat_rel.engine = ROW_ENGINE;
+
+	DataRelInfo dictcat_rel;
+	strcpy_s  (dictcat_rel.relName, "dictcat");
+	dictcat_rel.attrCount = DataDictEntry::members ( );
+	dictcat_rel.recordSize = DataDictEntry::size ( );
+	dictcat_rel.numPages = 1; // initially
+	dictcat_rel.numRecords = 0;
+	dictcat_rel.engine = ROW_ENGINE;
 
 	// store the two tables into relation file
 	RecordIdentifier rid;		// not use in this function
 	
 	if ( ( result = relFile->InsertRec (reinterpret_cast< const char * >( &relcat_rel ), rid) ) || 
-			(result = relFile->InsertRec(reinterpret_cast<const char *>(&attrcat_rel), rid) ) ) {
+			(result = relFile->InsertRec(reinterpret_cast<const char *>(&attrcat_rel), rid) ) ||
+			(result = relFile->InsertRec(reinterpret_cast<const char *>(&dictcat_rel), rid) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
@@ -242,6 +307,26 @@ inline RETCODE SystemManager::CreateDb (const char * dbName, PageFileManagerPtr
 		return result;
 	}
 
+	strcpy_s  (a.relName, "relcat");
+	strcpy_s  (a.attrName, "engine");
+	a.offset = offsetof (DataRelInfo, engine);
+	a.attrType = INT;
+	a.attrLength = sizeof (int);
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	strcpy_s  (a.relName, "relcat");
+	strcpy_s  (a.attrName, "keyAttr");
+	a.offset = offsetof (DataRelInfo, keyAttr);
+	a.attrType = INT;
+	a.attrLength = sizeof (int);
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 
 	// attrcat attrs
 	strcpy_s  (a.relName, "attrcat");
@@ -294,6 +379,67 @@ inline RETCODE SystemManager::CreateDb (const char * dbName, PageFileManagerPtr
 		return result;
 	}
 
+	strcpy_s  (a.relName, "attrcat");
+	strcpy_s  (a.attrName, "dictionary");
+	a.offset = offsetof (DataAttrInfo, dictionary);
+	a.attrType = INT;
+	a.attrLength = sizeof (int);
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	strcpy_s  (a.relName, "attrcat");
+	strcpy_s  (a.attrName, "bloomFilter");
+	a.offset = offsetof (DataAttrInfo, bloomFilter);
+	a.attrType = FLOAT;
+	a.attrLength = sizeof (float);
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	// dictcat attrs
+	strcpy_s  (a.relName, "dictcat");
+	strcpy_s  (a.attrName, "relName");
+	a.offset = offsetof (DataDictEntry, relName);
+	a.attrType = STRING;
+	a.attrLength = Utils::MAXNAMELEN;
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	strcpy_s  (a.relName, "dictcat");
+	strcpy_s  (a.attrName, "attrName");
+	a.offset = offsetof (DataDictEntry, attrName);
+	a.attrType = STRING;
+	a.attrLength = Utils::MAXNAMELEN;
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	strcpy_s  (a.relName, "dictcat");
+	strcpy_s  (a.attrName, "code");
+	a.offset = offsetof (DataDictEntry, code);
+	a.attrType = INT;
+	a.attrLength = sizeof (int);
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	strcpy_s  (a.relName, "dictcat");
+	strcpy_s  (a.attrName, "value");
+	a.offset = offsetof (DataDictEntry, value);
+	a.attrType = STRING;
+	a.attrLength = Utils::MAXDICTVALUELEN;
+	if ( ( result = attrFile->InsertRec (( char* ) &a, rid) ) < 0 ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
 	if ( ( result = recMgr->CloseFile (relFile) ) || ( result = recMgr->CloseFile (attrFile) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
@@ -311,11 +457,14 @@ inline RETCODE SystemManager::OpenDb (const char * dbName) {
 	relcat_name += "\\relcat";
 	std::string attrcat_name = dbName;
 	attrcat_name += "\\attrcat";
+	std::string dictcat_name = dbName;
+	dictcat_name += "\\dictcat";
 
 	RETCODE result;
 	
 	if ( ( result = recMgr->OpenFile (relcat_name.c_str ( ), relFile) )
-		|| ( result = recMgr->OpenFile (attrcat_name.c_str ( ), attrFile) ) ) {
+		|| ( result = recMgr->OpenFile (attrcat_name.c_str ( ), attrFile) )
+		|| ( result = recMgr->OpenFile (dictcat_name.c_str ( ), dictFile) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
@@ -328,17 +477,20 @@ inline RETCODE SystemManager::OpenDb (const char * dbName) {
 inline RETCODE SystemManager::CloseDb ( ) {
 	RETCODE result;
 
-	if ( ( result = recMgr->CloseFile (relFile) ) || ( result = recMgr->CloseFile (attrFile) ) ) {
+	if ( ( result = recMgr->CloseFile (relFile) ) || ( result = recMgr->CloseFile (attrFile) )
+		 || ( result = recMgr->CloseFile (dictFile) ) ) {
 		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
 		return result;
 	}
 
+	dicts.clear ( );
+	memTables.clear ( );
 	IsDBOpen = false;
 
 	return RETCODE::COMPLETE;
 }
 
-inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount, AttrInfo * attributes) {
+inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount, AttrInfo * attributes, StorageEngine engine, const char * primaryKey) {
 
 	RETCODE result = RETCODE::COMPLETE;
 
@@ -346,10 +498,48 @@ inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount,
 		return RETCODE::CREATEFAILED;
 	}
 
-	if ( strcmp (relName, "relcat") == 0 || strcmp (relName, "attrcat") == 0 ) {
+	if ( strcmp (relName, "relcat") == 0 || strcmp (relName, "attrcat") == 0 || strcmp (relName, "dictcat") == 0 ) {
 		return RETCODE::CREATEFAILED;
 	}
 
+	// the rows of a table with a primary key are stored in the B+ tree on the key,
+	// a MEMORY_ENGINE table keeps a hash index on its primary key instead
+	if ( primaryKey != nullptr && engine == ROW_ENGINE )
+		engine = CLUSTERED_ENGINE;
+	else if ( ( primaryKey != nullptr ) != ( engine == CLUSTERED_ENGINE ) && engine != MEMORY_ENGINE )
+		return RETCODE::CREATEFAILED;
+
+	int keyAttr = -1;
+
+	for ( int i = 0; i < attrCount; i++ ) {
+		// the key is compared by value, so it cannot be a dictionary code or a VARCHAR
+		if ( primaryKey != nullptr && strcmp (attributes[i].attrName, primaryKey) == 0 ) {
+			if ( attributes[i].dictionary || attributes[i].attrType == VARCHAR )
+				return RETCODE::CREATEFAILED;
+			keyAttr = i;
+		}
+
+		// only the codes are stored, so the dictionary must fit in dictcat
+		if ( attributes[i].dictionary && ( attributes[i].attrType != STRING || attributes[i].attrLength <= 0
+										   || static_cast< size_t >( attributes[i].attrLength ) > Utils::MAXDICTVALUELEN ) )
+			return RETCODE::CREATEFAILED;
+
+		if ( attributes[i].bloomFilter < 0 || attributes[i].bloomFilter >= 1 )
+			return RETCODE::CREATEFAILED;
+
+		if ( attributes[i].attrType != VARCHAR )
+			continue;
+
+		// VARCHAR needs slotted pages, tables with variable length attributes go to SLOTTED_ENGINE
+		if ( engine == ROW_ENGINE )
+			engine = SLOTTED_ENGINE;
+		else if ( engine != SLOTTED_ENGINE )
+			return RETCODE::CREATEFAILED;
+	}
+
+	if ( primaryKey != nullptr && keyAttr < 0 )
+		return RETCODE::CREATEFAILED;
+
 	RecordIdentifier rid;
 	std::set<std::string> uniq;
 
@@ -357,8 +547,13 @@ inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount,
 	int size = 0;
 	for ( int i = 0; i < attrCount; i++ ) {
 		d[i] = DataAttrInfo (attributes[i]);
+		if ( engine == COLUMN_ENGINE )
+			d[i].dictionary = 0;			// column chunks choose DICT_ENCODING by themselves
+		if ( engine != ROW_ENGINE )
+			d[i].bloomFilter = 0;			// only a RecordFile keeps Bloom filters
 		d[i].offset = size;
-		size += attributes[i].attrLength;
+		// the fixed part of a VARCHAR is the VarField pointing to the bytes after the fixed part
+		size += d[i].storedLength ( );
 		strcpy_s (d[i].relName, relName);
 
 		if ( uniq.find (string (d[i].attrName)) == uniq.end ( ) )
@@ -374,15 +569,38 @@ inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount,
 
 
 
-	if ( ( result = recMgr->CreateFile (relName, size) ) )
+	switch ( engine ) {
+	case ROW_ENGINE:
+		result = recMgr->CreateFile (relName, size, attrCount, d);
+		break;
+	case COLUMN_ENGINE:
+		result = colMgr->CreateFile (relName, attrCount, d);
+		break;
+	case SLOTTED_ENGINE:
+		result = recMgr->CreateVarFile (relName);
+		break;
+	case CLUSTERED_ENGINE:
+		result = recMgr->CreateClusteredFile (relName, size, d[keyAttr].offset, d[keyAttr].attrType, d[keyAttr].attrLength);
+		break;
+	case MEMORY_ENGINE:
+		memTables.erase (relName);			// no file, GetMemoryTable makes the table on first use
+		break;
+	default:
+		result = RETCODE::CREATEFAILED;
+		break;
+	}
+
+	if ( result )
 		return( result );
 
 	DataRelInfo rel;
 	strcpy_s (rel.relName, relName);
 	rel.attrCount = attrCount;
 	rel.recordSize = size;
-	rel.numPages = 1; // initially
+	rel.numPages = engine == MEMORY_ENGINE ? 0 : 1; // initially
 	rel.numRecords = 0;
+	rel.engine = engine;
+	rel.keyAttr = keyAttr;
 
 	if ( ( result = relFile->InsertRec (( char* ) &rel, rid) ) < 0 )
 		return result;
@@ -395,6 +613,250 @@ inline RETCODE SystemManager::CreateTable (const char * relName, int attrCount,
 }
 
 
+/*
+	The index of relName.attrName is stored in the file relName.attrName, the entries of the table are sorted
+	(in runs on disk if they do not fit in memory) and the tree is built bottom up instead of inserting the rows one by one.
+	A hash or bitmap index takes the entries in the order of the rows
+*/
+inline RETCODE SystemManager::CreateIndex (const char * relName, const char * attrName, double fillFactor, IndexType indexType) {
+	RETCODE result;
+	DataRelInfo rel;
+	DataAttrInfo attr;
+	RecordIdentifier rid;
+
+	if ( ( result = IsValid ( ) ) || ( result = GetRelFromCat (relName, rel, rid) ) || ( result = GetAttrFromCat (relName, attrName, attr, rid) ) )
+		return result;
+
+	// only the rows of a RecordFile keep their rids
+	if ( rel.engine != ROW_ENGINE )
+		return RETCODE::INVALIDTABLE;
+
+	// the codes of a dictionary are not in the order of the values
+	if ( attr.dictionary || attr.attrType == VARCHAR )
+		return RETCODE::BADATTR;
+
+	std::string indexName = std::string (relName) + "." + attrName;
+	EntrySorter sorter (attr.attrType, attr.attrLength, indexName);
+	RecordFilePtr file;
+	RecordFileScan scan;
+	Record rec;
+	char * pData;
+	HashIndexHandlePtr hashIndex;
+	BitmapIndexHandlePtr bitmapIndex;
+	bool created = false;		// the index file exists and has to be removed on an error
+
+	if ( indexType == HASH_INDEX ) {
+		if ( result = indexMgr->CreateIndex (indexName.c_str ( ), attr.attrType, attr.attrLength, HASH_INDEX) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		created = true;
+
+		if ( result = indexMgr->OpenIndex (indexName.c_str ( ), hashIndex) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return AbortIndex (indexName.c_str ( ), result);
+		}
+	}
+
+	if ( indexType == BITMAP_INDEX ) {
+		if ( result = indexMgr->CreateIndex (indexName.c_str ( ), attr.attrType, attr.attrLength, BITMAP_INDEX,
+											 RecordFile::SlotsPerPage (rel.recordSize)) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		created = true;
+
+		if ( result = indexMgr->OpenIndex (indexName.c_str ( ), bitmapIndex) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return AbortIndex (indexName.c_str ( ), result);
+		}
+	}
+
+	if ( ( result = recMgr->OpenFile (relName, file) )
+		 || ( result = scan.OpenScan (file, attr.attrType, attr.attrLength, attr.offset, NO_OP, nullptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		hashIndex = nullptr;
+		bitmapIndex = nullptr;
+		return created ? AbortIndex (indexName.c_str ( ), result) : result;
+	}
+
+	while ( ( result = scan.GetNextRec (rec) ) == RETCODE::COMPLETE ) {
+		if ( ( result = rec.GetData (pData) ) || ( result = rec.GetIdentifier (rid) ) )
+			break;
+
+		if ( hashIndex != nullptr )
+			result = hashIndex->InsertEntry (pData + attr.offset, rid);
+		else if ( bitmapIndex != nullptr )
+			result = bitmapIndex->InsertEntry (pData + attr.offset, rid);
+		else
+			result = sorter.Add (pData + attr.offset, rid);
+
+		if ( result )
+			break;
+	}
+
+	if ( result != RETCODE::EOFSCAN && result != RETCODE::EOFFILE ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		hashIndex = nullptr;
+		bitmapIndex = nullptr;
+		return created ? AbortIndex (indexName.c_str ( ), result) : result;
+	}
+
+	if ( ( result = scan.CloseScan ( ) ) || ( result = recMgr->CloseFile (file) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		hashIndex = nullptr;
+		bitmapIndex = nullptr;
+		return created ? AbortIndex (indexName.c_str ( ), result) : result;
+	}
+
+	if ( hashIndex != nullptr ) {
+		if ( result = indexMgr->CloseIndex (hashIndex) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			hashIndex = nullptr;
+			return AbortIndex (indexName.c_str ( ), result);
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+	if ( bitmapIndex != nullptr ) {
+		if ( result = indexMgr->CloseIndex (bitmapIndex) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			bitmapIndex = nullptr;
+			return AbortIndex (indexName.c_str ( ), result);
+		}
+
+		return RETCODE::COMPLETE;
+	}
+
+	if ( result = sorter.Sort ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	IndexHandlePtr index;
+
+	if ( result = indexMgr->CreateIndex (indexName.c_str ( ), attr.attrType, attr.attrLength) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = indexMgr->OpenIndex (indexName.c_str ( ), index) ) || ( result = index->BulkLoad (sorter, fillFactor) )
+		 || ( result = indexMgr->CloseIndex (index) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		index = nullptr;
+		return AbortIndex (indexName.c_str ( ), result);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The index of the attributes a, b, ... of relName is stored in the file relName.a.b..., its keys are COMPOSITE
+	and it is built like the index of one attribute. The INCLUDE attributes follow the others in the encoded key,
+	they are sorted and stored as the payload of the leaf entries and are not part of the name
+*/
+inline RETCODE SystemManager::CreateIndex (const char * relName, int attrCount, const char * const * attrNames, double fillFactor,
+										   int includeCount, const char * const * includeNames) {
+	RETCODE result;
+	DataRelInfo rel;
+	DataAttrInfo attr;
+	RecordIdentifier rid;
+
+	if ( ( result = IsValid ( ) ) || ( result = GetRelFromCat (relName, rel, rid) ) )
+		return result;
+
+	if ( rel.engine != ROW_ENGINE )
+		return RETCODE::INVALIDTABLE;
+
+	if ( attrCount <= 0 || includeCount < 0 || attrCount + includeCount > static_cast< int >( CompositeKey::MAXCOLUMNS )
+		 || attrNames == nullptr || ( includeCount > 0 && includeNames == nullptr ) )
+		return RETCODE::BADATTR;
+
+	std::string indexName = relName;
+	std::vector<KeyColumn> columns;
+
+	for ( int i = 0; i < attrCount + includeCount; i++ ) {
+		const char * name = i < attrCount ? attrNames[i] : includeNames[i - attrCount];
+
+		if ( result = GetAttrFromCat (relName, name, attr, rid) )
+			return result;
+
+		if ( attr.dictionary || attr.attrType == VARCHAR )
+			return RETCODE::BADATTR;
+
+		if ( i < attrCount )
+			indexName = indexName + "." + name;
+
+		columns.push_back (KeyColumn { attr.attrType, static_cast< size_t >( attr.attrLength ), static_cast< size_t >( attr.offset ) });
+	}
+
+	CompositeKey key (columns, includeCount);
+
+	if ( result = key.Validate ( ) )
+		return result;
+
+	EntrySorter sorter (COMPOSITE, key.KeyLength ( ), indexName, EntrySorter::MEMORYSIZE, key.Length ( ) - key.KeyLength ( ));
+	std::vector<char> entry (key.Length ( ));
+	RecordFilePtr file;
+	RecordFileScan scan;
+	Record rec;
+	char * pData;
+
+	if ( ( result = recMgr->OpenFile (relName, file) )
+		 || ( result = scan.OpenScan (file, attr.attrType, attr.attrLength, attr.offset, NO_OP, nullptr) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	while ( ( result = scan.GetNextRec (rec) ) == RETCODE::COMPLETE ) {
+		if ( ( result = rec.GetData (pData) ) || ( result = rec.GetIdentifier (rid) ) )
+			break;
+
+		key.EncodeRecord (pData, entry.data ( ));
+
+		if ( result = sorter.Add (entry.data ( ), rid) )
+			break;
+	}
+
+	if ( result != RETCODE::EOFSCAN && result != RETCODE::EOFFILE ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = scan.CloseScan ( ) ) || ( result = recMgr->CloseFile (file) ) || ( result = sorter.Sort ( ) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	IndexHandlePtr index;
+
+	if ( result = indexMgr->CreateIndex (indexName.c_str ( ), key) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( ( result = indexMgr->OpenIndex (indexName.c_str ( ), index) ) || ( result = index->BulkLoad (sorter, fillFactor) )
+		 || ( result = indexMgr->CloseIndex (index) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		index = nullptr;
+		return AbortIndex (indexName.c_str ( ), result);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE SystemManager::AbortIndex (const char * indexName, RETCODE result) {
+	RETCODE rc;
+
+	if ( rc = indexMgr->DestroyIndex (indexName) )
+		Utils::PrintRetcode (rc, __FUNCTION__, __LINE__);
+
+	return result;
+}
+
 inline RETCODE SystemManager::GetFromTable (const char *relName,           // create relation relName
 					  int&        attrCount,         // number of attributes
 					  DataAttrInfo   *&attributes) {
@@ -410,7 +872,7 @@ inline RETCODE SystemManager::GetFromTable (const char *relName,           // cr
 
 	Record rec;
 	rc = rfs.GetNextRec (rec);
-	if ( rc == RETCODE::EOFFILE )
+	if ( rc == RETCODE::EOFFILE || rc == RETCODE::EOFSCAN )
 		return RETCODE::TABLENOTFOUND; // no such table
 
 	DataRelInfo * prel;
@@ -430,7 +892,7 @@ inline RETCODE SystemManager::GetFromTable (const char *relName,           // cr
 	while ( 1 ) {
 		Record rec;
 		rc = afs.GetNextRec (rec);
-		if ( rc == RETCODE::EOFFILE || numRecs > attrCount )
+		if ( rc == RETCODE::EOFFILE || rc == RETCODE::EOFSCAN || numRecs > attrCount )
 			break;
 		DataAttrInfo * pattr;
 		rec.GetData (( char*& ) pattr);
@@ -461,7 +923,7 @@ inline RETCODE SystemManager::GetRelFromCat (const char * relName, DataRelInfo &
 
 	Record rec;
 	rc = rfs.GetNextRec (rec);
-	if ( rc == RETCODE::EOFFILE )
+	if ( rc == RETCODE::EOFFILE || rc == RETCODE::EOFSCAN )
 		return RETCODE::TABLENOTFOUND; // no such table
 
 	rc = rfs.CloseScan ( );
@@ -521,6 +983,131 @@ inline RETCODE SystemManager::GetAttrFromCat (const char* relName, const char* a
 }
 
 
+inline RETCODE SystemManager::GetDictionary (const char * relName, const char * attrName, StringDictionaryPtr & dict) {
+	if ( relName == NULL || attrName == NULL ) {
+		return RETCODE::INVALIDTABLE;
+	}
+
+	std::string name = std::string (relName) + "." + attrName;
+	auto it = dicts.find (name);
+
+	if ( it != dicts.end ( ) ) {
+		dict = it->second;
+		return RETCODE::COMPLETE;
+	}
+
+	RETCODE rc;
+	DataAttrInfo attr;
+	RecordIdentifier rid;
+
+	if ( ( rc = GetAttrFromCat (relName, attrName, attr, rid) ) )
+		return rc;
+
+	if ( !attr.dictionary )
+		return RETCODE::BADATTR;
+
+	dict = make_shared<StringDictionary> (attr.attrLength);
+
+	RecordFileScan rfs;
+	Record rec;
+	DataDictEntry * entry = nullptr;
+
+	if ( ( rc = rfs.OpenScan (dictFile,
+							  STRING,
+							  Utils::MAXNAMELEN,
+							  offsetof (DataDictEntry, relName),
+							  EQ_OP,
+							  ( void* ) relName) ) )
+		return ( rc );
+
+	while ( ( rc = rfs.GetNextRec (rec) ) == RETCODE::COMPLETE ) {
+		rec.GetData (( char*& ) entry);
+		if ( strcmp (entry->attrName, attrName) == 0 && ( rc = dict->Load (entry->code, entry->value) ) )
+			return rc;
+	}
+
+	if ( rc != RETCODE::EOFSCAN && rc != RETCODE::EOFFILE )
+		return rc;
+
+	if ( ( rc = rfs.CloseScan ( ) ) )
+		return ( rc );
+
+	dicts[name] = dict;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE SystemManager::EncodeValue (const char * relName, const char * attrName, const char * value, int & code) {
+	RETCODE rc;
+	StringDictionaryPtr dict;
+	bool added;
+
+	if ( ( rc = GetDictionary (relName, attrName, dict) ) || ( rc = dict->Insert (value, code, added) ) )
+		return rc;
+
+	if ( !added )
+		return RETCODE::COMPLETE;
+
+	DataDictEntry entry;
+	RecordIdentifier rid;
+
+	strcpy_s (entry.relName, relName);
+	strcpy_s (entry.attrName, attrName);
+	entry.code = code;
+	dict->GetValue (code, entry.value);
+
+	return dictFile->InsertRec (( char* ) &entry, rid);
+}
+
+inline RETCODE SystemManager::GetMemoryTable (const char * relName, MemoryTablePtr & table) {
+	if ( relName == NULL ) {
+		return RETCODE::INVALIDTABLE;
+	}
+
+	auto it = memTables.find (relName);
+
+	if ( it != memTables.end ( ) ) {
+		table = it->second;
+		return RETCODE::COMPLETE;
+	}
+
+	RETCODE rc;
+	DataRelInfo rel;
+	RecordIdentifier rid;
+
+	if ( ( rc = GetRelFromCat (relName, rel, rid) ) )
+		return rc;
+
+	if ( rel.engine != MEMORY_ENGINE )
+		return RETCODE::INVALIDTABLE;
+
+	table = make_shared<MemoryTable> ( );
+
+	if ( rel.keyAttr < 0 ) {
+		rc = table->Open (rel.recordSize);
+	} else {
+		int attrCount;
+		DataAttrInfo * attributes;
+
+		if ( ( rc = GetFromTable (relName, attrCount, attributes) ) )
+			return rc;
+
+		rc = rel.keyAttr < attrCount ? table->Open (rel.recordSize, attributes[rel.keyAttr].offset,
+													 attributes[rel.keyAttr].attrType, attributes[rel.keyAttr].attrLength)
+			: RETCODE::INVALIDTABLE;
+
+		delete[] attributes;
+	}
+
+	if ( rc )
+		return rc;
+
+	memTables[relName] = table;
+
+	return RETCODE::COMPLETE;
+}
+
+
 RETCODE SystemManager::IsValid ( ) const {
 	bool ret = true;
 	ret = ret && IsDBOpen;
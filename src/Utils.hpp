@@ -102,7 +102,23 @@ enum RETCODE {
 enum AttrType {
 	INT = 0x10,
 	FLOAT,
-	STRING
+	STRING,
+	VARCHAR,		// variable length string, stored as a VarField in the record
+	COMPOSITE		// the memcmp comparable key of a composite index, see CompositeKey
+};
+
+enum StorageEngine {
+	ROW_ENGINE = 0,		// RecordFile, rows stored in fixed size slots
+	COLUMN_ENGINE,		// ColumnFile, every attribute stored in its own segment
+	SLOTTED_ENGINE,		// VarRecordFile, variable length rows in slotted pages
+	CLUSTERED_ENGINE,	// ClusteredFile, rows stored in the leaves of a B+ tree on the primary key
+	MEMORY_ENGINE,		// MemoryTable, rows kept in memory only and rebuilt by the application
+};
+
+enum IndexType {
+	BTREE_INDEX = 0,	// IndexHandle, B+ tree for ranges and equality
+	HASH_INDEX,			// HashIndexHandle, linear hashing for equality only
+	BITMAP_INDEX,		// BitmapIndexHandle, a compressed bitmap of the rows of every value of a low cardinality attribute
 };
 
 enum CompOp {
@@ -120,6 +136,8 @@ struct AttrInfo {
 	char     *attrName;   /* attribute name       */
 	AttrType attrType;    /* type of attribute    */
 	int      attrLength;  /* length of attribute  */
+	bool     dictionary;  /* STRING only, store the dictionary code instead of the value */
+	float    bloomFilter; /* false positive rate of the Bloom filters on the attribute, 0 for none */
 };
 
 struct RelAttr {
@@ -168,6 +186,8 @@ namespace Utils{
 
 	const size_t MAXNAMELEN = 32;
 
+	const size_t MAXDICTVALUELEN = 256;		// the longest STRING attribute that can be dictionary encoded
+
 	const PageNum MAXPAGECOUNT = 2 << 31;
 
 	const char PAGEFILEIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL PageFile";
@@ -178,8 +198,26 @@ namespace Utils{
 
 	const char INDEXIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL IndexHandle";
 
+	const char HASHINDEXIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL HashIndex";
+
+	const char BITMAPINDEXIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL BitmapIndex";
+
 	const char RECORDPAGEIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL RecordPage";
 
+	const char COLUMNFILEIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL ColumnFile";
+
+	const char COLUMNSEGMENTIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL ColumnSegment";
+
+	const char VARRECORDFILEIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL VarRecordFile";
+
+	const char FREESPACEMAPIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL FreeSpaceMap";
+
+	const char ZONEMAPIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL ZoneMap";
+
+	const char BLOOMFILTERIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL BloomFilter";
+
+	const char CLUSTEREDFILEIDENTIFYSTRING[IDENTIFYSTRINGLEN] = "MicroSQL ClusteredFile";
+
 
 	/*
 		Server Settings
@@ -197,6 +235,8 @@ namespace Utils{
 
 	const size_t BUFFERSIZE = 40;			// number of pages in buffer
 
+	const size_t CACHELINESIZE = 64;		// MemoryTable rows do not cross a cache line boundary
+
 	/*
 		Utility Functions
 	*/
@@ -259,12 +299,38 @@ namespace Utils{
 
 
 
+/*
+	A VARCHAR attribute keeps a VarField at its offset in the fixed part of a record,
+	the characters are stored behind the fixed part and VarField::offset is relative to the VarField itself
+*/
+struct VarField {
+	unsigned short offset;
+	unsigned short length;
+};
+
 namespace CompMethod {
 
 	int compare_string (void *value1, void* value2, size_t attrLength) {
 		return strncmp (reinterpret_cast< char* >( value1 ) , reinterpret_cast< char* >( value2 ) , attrLength);
 	}
 
+	/*
+		value1 points to a VarField, value2 is a string of at most attrLength chars
+		the chars must be inside the record, VarRecordFile::GetVarField checks the VarField before it is compared
+	*/
+	int compare_varchar (void *value1, void* value2, size_t attrLength) {
+		const VarField * field = reinterpret_cast< const VarField* >( value1 );
+		const char * chars = reinterpret_cast< const char* >( value1 ) + field->offset;
+		size_t length = strnlen (reinterpret_cast< const char* >( value2 ), attrLength);
+		int result = memcmp (chars, value2, field->length < length ? field->length : length);
+
+		if ( result != 0 )
+			return result;
+		if ( field->length == length )
+			return 0;
+		return field->length < length ? -1 : 1;
+	}
+
 	static int compare_int (void *value1, void* value2, size_t attrLength) {
 		if ( ( *reinterpret_cast< int* >( value1 )  < *reinterpret_cast< int* >( value2 )  ) )
 			return -1;
@@ -274,6 +340,10 @@ namespace CompMethod {
 			return 0;
 	}
 
+	int compare_bytes (void *value1, void* value2, size_t attrLength) {
+		return memcmp (value1, value2, attrLength);
+	}
+
 	int compare_float (void *value1, void* value2, size_t attrLength) {
 		if ( ( *reinterpret_cast< float* >( value1 )  < *reinterpret_cast< float* >( value2 )  ) )
 			return -1;
@@ -287,6 +357,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) == *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) == *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) == 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) == 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) == 0 );
 		}
@@ -296,6 +368,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) < *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) < *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) < 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) < 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) < 0 );
 		}
@@ -305,6 +379,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) > *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) > *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) > 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) > 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) > 0 );
 		}
@@ -314,6 +390,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) <= *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) <= *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) <= 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) <= 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) <= 0 );
 		}
@@ -323,6 +401,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) >= *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) >= *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) >= 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) >= 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) >= 0 );
 		}
@@ -332,6 +412,8 @@ namespace CompMethod {
 		switch ( attrtype ) {
 		case FLOAT: return ( *reinterpret_cast< float* >( value1 ) != *reinterpret_cast< float* >( value2 ) );
 		case INT: return ( *reinterpret_cast< int* >( value1 ) != *reinterpret_cast< int* >( value2 ) );
+		case VARCHAR: return ( compare_varchar (value1, value2, attrLength) != 0 );
+		case COMPOSITE: return ( compare_bytes (value1, value2, attrLength) != 0 );
 		default:
 			return ( strncmp (reinterpret_cast< char* >( value1 ), reinterpret_cast< char* >( value2 ), attrLength) != 0 );
 		}
@@ -347,10 +429,14 @@ struct DataAttrInfo {
 	int      offset;              // Offset of attribute 
 	AttrType attrType;            // Type of attribute 
 	int      attrLength;          // Length of attribute
+	int      dictionary;          // 1 if the record stores an int code of the dictionary in dictcat
+	float    bloomFilter;         // false positive rate of the Bloom filters, 0 for none
 
 	DataAttrInfo ( ) {
 		memset (relName, 0, sizeof (relName));
 		memset (attrName, 0, sizeof (attrName));
+		dictionary = 0;
+		bloomFilter = 0;
 	}
 
 	DataAttrInfo (AttrInfo attr) {
@@ -358,6 +444,8 @@ struct DataAttrInfo {
 		memcpy_s (attrName, sizeof (attrName), attr.attrName, sizeof (attrName));
 		attrType = attr.attrType;
 		attrLength = attr.attrLength;
+		dictionary = attr.dictionary ? 1 : 0;
+		bloomFilter = attr.bloomFilter;
 	}
 
 	DataAttrInfo (char * buf) {
@@ -365,11 +453,16 @@ struct DataAttrInfo {
 	}
 
 	static size_t size ( ) {
-		return sizeof (relName) + sizeof (attrName) + sizeof (attrType) + 2 * sizeof (int);
+		return sizeof (relName) + sizeof (attrName) + sizeof (attrType) + 3 * sizeof (int) + sizeof (float);
 	}
 
 	static size_t members ( ) {
-		return 5;
+		return 7;
+	}
+
+	// bytes of the attribute in a record
+	int storedLength ( ) const {
+		return dictionary ? sizeof (int) : attrType == VARCHAR ? sizeof (VarField) : attrLength;
 	}
 
 };
@@ -378,6 +471,8 @@ struct DataRelInfo {
 	// Default constructor
 	DataRelInfo ( ) {
 		memset (relName, 0, Utils::MAXNAMELEN);
+		engine = ROW_ENGINE;
+		keyAttr = -1;
 	}
 
 	DataRelInfo (char * buf) {
@@ -391,6 +486,8 @@ struct DataRelInfo {
 		attrCount = d.attrCount;
 		numPages = d.numPages;
 		numRecords = d.numRecords;
+		engine = d.engine;
+		keyAttr = d.keyAttr;
 	};
 
 	DataRelInfo& operator=(const DataRelInfo &d) {
@@ -400,21 +497,48 @@ struct DataRelInfo {
 			attrCount = d.attrCount;
 			numPages = d.numPages;
 			numRecords = d.numRecords;
+			engine = d.engine;
+			keyAttr = d.keyAttr;
 		}
 		return ( *this );
 	}
 
 	static unsigned int size ( ) {
-		return ( Utils::MAXNAMELEN ) + 4 * sizeof (int);
+		return ( Utils::MAXNAMELEN ) + 6 * sizeof (int);
 	}
 
 	static unsigned int members ( ) {
-		return 5;
+		return 7;
 	}
 
 	int      recordSize;            // Size per row
 	int      attrCount;             // # of attributes
 	int      numPages;              // # of pages used by relation
 	int      numRecords;            // # of records in relation
+	int      engine;                // StorageEngine of relation
+	int      keyAttr;               // index of the primary key attribute, -1 if none
+	char     relName[Utils::MAXNAMELEN];    // Relation name
+};
+
+// One row of dictcat, maps a code of a dictionary encoded attribute to its value
+struct DataDictEntry {
 	char     relName[Utils::MAXNAMELEN];    // Relation name
+	char     attrName[Utils::MAXNAMELEN];   // Attribute name
+	int      code;                          // Code stored in the records
+	char     value[Utils::MAXDICTVALUELEN]; // Value of the attribute
+
+	DataDictEntry ( ) {
+		memset (relName, 0, sizeof (relName));
+		memset (attrName, 0, sizeof (attrName));
+		memset (value, 0, sizeof (value));
+		code = 0;
+	}
+
+	static size_t size ( ) {
+		return sizeof (relName) + sizeof (attrName) + sizeof (int) + sizeof (value);
+	}
+
+	static size_t members ( ) {
+		return 4;
+	}
 };
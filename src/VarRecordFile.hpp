@@ -0,0 +1,690 @@
+#pragma once
+
+/*
+	1. VarRecordFile is the heap file of SLOTTED_ENGINE tables, records have variable length
+	2. Page 0 is PageFileHeader, page 1 is VarRecordFileHeader, data pages start from FIRSTDATAPAGE
+	3. Layout of a data page:
+		[SlottedPageHeader][Slot 0][Slot 1]...[Slot n-1] -> free space <- [records, growing from the page end]
+	4. A record is never stored in less than MINRECORDSIZE bytes, so its space can always hold a forwarding pointer
+	5. When an updated record outgrows its page, it is moved to another page (SLOTMOVED), the home slot keeps
+	   a forwarding pointer (SLOTFORWARD) to it, so the RecordIdentifier of a record never changes
+	6. BuildRec lays a record out as the attributes of SystemManager expect it: the fixed part with a VarField for
+	   every VARCHAR, then the characters of the VARCHARs. GetVarField finds the characters and checks they are in the record
+*/
+
+#include "Utils.hpp"
+#include "Record.hpp"
+#include "BufferManager.hpp"
+
+#include <algorithm>
+#include <vector>
+
+struct VarRecordFileHeader {				// stored in page 1 of every var record file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL VarRecordFile"
+	PageNum numPages;			// number of data pages
+	PageNum lastPage;			// the page where new records are inserted
+	PageNum numRecords;
+
+	VarRecordFileHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::VARRECORDFILEIDENTIFYSTRING);
+		numPages = numRecords = 0;
+		lastPage = Utils::UNKNOWNPAGENUM;
+	}
+};
+
+struct SlottedPageHeader {
+	unsigned short numSlots;		// size of the slot directory
+	unsigned short freeStart;		// end of the slot directory
+	unsigned short freeEnd;			// start of the record area
+	unsigned short fragmented;		// bytes of dead records inside the record area
+};
+
+struct Slot {
+	unsigned short offset;
+	unsigned short length;
+	unsigned short flags;
+};
+
+class VarRecordFile {
+
+	friend class VarRecordFileScan;
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static PageNum FIRSTDATAPAGE = 2;
+
+	enum SlotFlags {
+		SLOTFREE = 0,
+		SLOTUSED = 1,			// the record is stored in the slot
+		SLOTFORWARD = 2,		// the slot stores the RecordIdentifier of the moved record
+		SLOTMOVED = 4,			// the slot stores a record whose home slot is in another place
+	};
+
+	const static size_t MINRECORDSIZE = sizeof (RecordIdentifier);
+
+	const static size_t MAXRECORDSIZE = Utils::PAGESIZE - sizeof (SlottedPageHeader) - sizeof (Slot);
+
+	VarRecordFile ( );
+	~VarRecordFile ( );
+
+	/*
+	The file must be opened before any other operation
+	*/
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE InsertRec (const char *pData, size_t length, RecordIdentifier &rid);	// Insert a new record, and return record id
+	RETCODE DeleteRec (const RecordIdentifier &rid);			// Delete a record
+	RETCODE UpdateRec (const Record &rec);						// Update a record, the size may change
+	RETCODE GetRec (const RecordIdentifier &rid, Record &rec);
+
+	RETCODE ForcePages (PageNum pageNum) const;
+
+	RETCODE ReadHeader ( );
+	RETCODE SaveHeader ( ) const;
+
+	RETCODE GetHeader (VarRecordFileHeader & hdr) const;
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	bool isValidRecordFile ( ) const;
+
+	PageNum numPages ( ) const;
+
+	/*
+		Static Functions
+	*/
+	static size_t FreeSpace (const char * pData);		// contiguous free bytes of a page
+
+	static RETCODE Compact (char * pData);				// move the live records to the page end
+
+	// values[i] is the value of attrs[i], a VARCHAR is a string of at most attrLength chars
+	static RETCODE BuildRec (const std::vector<DataAttrInfo> & attrs, const void * const * values, std::vector<char> & record);
+
+	// BADRECORD if the VarField at attrOffset or its chars are not inside the length bytes of pData
+	static RETCODE GetVarField (const char * pData, size_t length, size_t attrOffset, const char * & chars, size_t & charsLength);
+
+private:
+
+	RETCODE getPage (PageNum page, PagePtr & pagePtr, char * & pData);
+
+	RETCODE writePage (PageNum page);
+
+	RETCODE allocatePage (PageNum & page, PagePtr & pagePtr, char * & pData);
+
+	RETCODE placeRecord (const char * pData, size_t length, unsigned short flags, RecordIdentifier & rid);
+
+	RETCODE removeSlot (char * pData, SlotNum slot);
+
+	RETCODE readSlot (const RecordIdentifier & rid, PagePtr & pagePtr, char * & pData, Slot * & slot);
+
+	static SlottedPageHeader * pageHeader (char * pData);
+
+	static Slot * slotAt (char * pData, SlotNum slot);
+
+	static size_t storedSize (size_t length);
+
+	static RETCODE allocateInPage (char * pData, size_t length, SlotNum & slot);
+
+	mutable bool headerModified;
+
+	bool isFileOpen;
+
+	VarRecordFileHeader header;
+
+	BufferManagerPtr bufMgr;
+
+};
+
+using VarRecordFilePtr = shared_ptr<VarRecordFile>;
+
+VarRecordFile::VarRecordFile ( ) {
+	bufMgr = nullptr;
+	headerModified = false;
+	isFileOpen = false;
+}
+
+VarRecordFile::~VarRecordFile ( ) {
+	if ( headerModified ) {
+		SaveHeader ( );
+	}
+}
+
+inline RETCODE VarRecordFile::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+
+	if ( isFileOpen || bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( result = ReadHeader ( ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	isFileOpen = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::InsertRec (const char * pData, size_t length, RecordIdentifier & rid) {
+	RETCODE result;
+
+	if ( pData == nullptr || length == 0 || length > MAXRECORDSIZE )
+		return RETCODE::BADRECORD;
+
+	if ( result = placeRecord (pData, length, SLOTUSED, rid) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.numRecords++;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::GetRec (const RecordIdentifier & rid, Record & rec) {
+	RETCODE result;
+	PagePtr pagePtr;
+	char * pData;
+	Slot * slot;
+
+	if ( result = readSlot (rid, pagePtr, pData, slot) )
+		return result;
+
+	if ( slot->flags == SLOTFORWARD ) {		// follow the forwarding pointer
+		RecordIdentifier target;
+		memcpy (reinterpret_cast< void* >( &target ), pData + slot->offset, sizeof (RecordIdentifier));
+
+		if ( result = readSlot (target, pagePtr, pData, slot) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	} else if ( slot->flags != SLOTUSED ) {		// moved records are only reachable through their home slot
+		return RETCODE::RECORDNOTFOUND;
+	}
+
+	rec = Record (rid, pData + slot->offset, slot->length);
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::DeleteRec (const RecordIdentifier & rid) {
+	RETCODE result;
+	PagePtr pagePtr;
+	char * pData;
+	Slot * slot;
+	PageNum page;
+	SlotNum slotNum;
+
+	if ( result = readSlot (rid, pagePtr, pData, slot) )
+		return result;
+
+	if ( slot->flags == SLOTMOVED )
+		return RETCODE::RECORDNOTFOUND;
+
+	if ( slot->flags == SLOTFORWARD ) {			// remove the moved record first
+		RecordIdentifier target;
+		PagePtr targetPtr;
+		char * targetData;
+		PageNum targetPage;
+		SlotNum targetSlot;
+
+		memcpy (reinterpret_cast< void* >( &target ), pData + slot->offset, sizeof (RecordIdentifier));
+		target.GetPageNum (targetPage);
+		target.GetSlotNum (targetSlot);
+
+		if ( ( result = getPage (targetPage, targetPtr, targetData) ) || ( result = removeSlot (targetData, targetSlot) )
+			 || ( result = writePage (targetPage) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	rid.GetPageNum (page);
+	rid.GetSlotNum (slotNum);
+
+	if ( ( result = removeSlot (pData, slotNum) ) || ( result = writePage (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	header.numRecords--;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	1. the new record fits in its current space: overwrite in place
+	2. the page has enough space after compaction: compact the page and store it again
+	3. otherwise move the record to another page and keep a forwarding pointer in the home slot
+*/
+inline RETCODE VarRecordFile::UpdateRec (const Record & rec) {
+	RETCODE result;
+	RecordIdentifier rid;
+	PagePtr pagePtr;
+	char * pData;
+	char * newData;
+	size_t length;
+	Slot * slot;
+	PageNum page;
+	SlotNum slotNum;
+
+	rec.GetIdentifier (rid);
+	rec.GetData (newData);
+	rec.GetSize (length);
+
+	if ( newData == nullptr || length == 0 || length > MAXRECORDSIZE )
+		return RETCODE::BADRECORD;
+
+	if ( result = readSlot (rid, pagePtr, pData, slot) )
+		return result;
+
+	if ( slot->flags == SLOTMOVED )
+		return RETCODE::RECORDNOTFOUND;
+
+	rid.GetPageNum (page);
+	rid.GetSlotNum (slotNum);
+
+	if ( slot->flags == SLOTFORWARD ) {			// drop the moved copy, the record is placed again below
+		RecordIdentifier target;
+		PagePtr targetPtr;
+		char * targetData;
+		PageNum targetPage;
+		SlotNum targetSlot;
+
+		memcpy (reinterpret_cast< void* >( &target ), pData + slot->offset, sizeof (RecordIdentifier));
+		target.GetPageNum (targetPage);
+		target.GetSlotNum (targetSlot);
+
+		if ( ( result = getPage (targetPage, targetPtr, targetData) ) || ( result = removeSlot (targetData, targetSlot) )
+			 || ( result = writePage (targetPage) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		slot->flags = SLOTUSED;
+		slot->length = MINRECORDSIZE;
+	}
+
+	size_t oldSize = storedSize (slot->length);
+	size_t newSize = storedSize (length);
+
+	if ( newSize <= oldSize ) {					// in place
+		memcpy (pData + slot->offset, newData, length);
+		pageHeader (pData)->fragmented += static_cast< unsigned short >( oldSize - newSize );
+		slot->length = static_cast< unsigned short >( length );
+		return writePage (page);
+	}
+
+	SlottedPageHeader * pHdr = pageHeader (pData);
+
+	if ( FreeSpace (pData) + pHdr->fragmented + oldSize >= newSize ) {		// fits after compaction
+		pHdr->fragmented += static_cast< unsigned short >( oldSize );
+		slot->flags = SLOTFREE;
+
+		if ( FreeSpace (pData) < newSize && ( result = Compact (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		pHdr->freeEnd -= static_cast< unsigned short >( newSize );
+		slot->offset = pHdr->freeEnd;
+		slot->length = static_cast< unsigned short >( length );
+		slot->flags = SLOTUSED;
+		memcpy (pData + slot->offset, newData, length);
+
+		return writePage (page);
+	}
+
+	// move the record to another page
+	RecordIdentifier target;
+
+	if ( result = placeRecord (newData, length, SLOTMOVED, target) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	if ( result = getPage (page, pagePtr, pData) ) {		// the home page is still in buffer
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	slot = slotAt (pData, slotNum);
+	pageHeader (pData)->fragmented += static_cast< unsigned short >( oldSize - MINRECORDSIZE );
+	slot->length = MINRECORDSIZE;
+	slot->flags = SLOTFORWARD;
+	memcpy (pData + slot->offset, &target, sizeof (RecordIdentifier));
+
+	return writePage (page);
+}
+
+inline RETCODE VarRecordFile::ForcePages (PageNum pageNum) const {
+	return bufMgr->ForcePage (pageNum);
+}
+
+inline RETCODE VarRecordFile::ReadHeader ( ) {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (VarRecordFileHeader), pData, sizeof (VarRecordFileHeader));
+
+	if ( strcmp (header.identifyString, Utils::VARRECORDFILEIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDRECORDFILE;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::SaveHeader ( ) const {
+	PagePtr page;
+	char * pData;
+	RETCODE result;
+
+	if ( bufMgr == nullptr ) {
+		Utils::PrintRetcode (RETCODE::HDRWRITE, __FUNCTION__, __LINE__);
+		return RETCODE::HDRWRITE;
+	}
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, sizeof (VarRecordFileHeader), reinterpret_cast< const void* >( &header ), sizeof (VarRecordFileHeader));
+
+	if ( result = bufMgr->ForcePage (HEADERPAGE) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	headerModified = false;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::GetHeader (VarRecordFileHeader & hdr) const {
+	hdr = header;
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline bool VarRecordFile::isValidRecordFile ( ) const {
+	return strcmp (header.identifyString, Utils::VARRECORDFILEIDENTIFYSTRING) == 0;
+}
+
+inline PageNum VarRecordFile::numPages ( ) const {
+	return header.numPages;
+}
+
+inline size_t VarRecordFile::FreeSpace (const char * pData) {
+	const SlottedPageHeader * pHdr = reinterpret_cast< const SlottedPageHeader* >( pData );
+	return pHdr->freeEnd - pHdr->freeStart;
+}
+
+/*
+	Slide all records to the end of the page, the slot numbers are not changed
+*/
+inline RETCODE VarRecordFile::Compact (char * pData) {
+	SlottedPageHeader * pHdr = pageHeader (pData);
+	std::vector<SlotNum> live;
+
+	for ( SlotNum i = 0; i < pHdr->numSlots; i++ ) {
+		if ( slotAt (pData, i)->flags != SLOTFREE )
+			live.push_back (i);
+	}
+
+	// move the records nearest to the page end first, so no record is overwritten before it is moved
+	std::sort (live.begin ( ), live.end ( ), [pData] (SlotNum a, SlotNum b) {
+		return slotAt (pData, a)->offset > slotAt (pData, b)->offset;
+	});
+
+	unsigned short end = static_cast< unsigned short >( Utils::PAGESIZE );
+
+	for ( auto i : live ) {
+		Slot * slot = slotAt (pData, i);
+		size_t size = storedSize (slot->length);
+		end -= static_cast< unsigned short >( size );
+		memmove (pData + end, pData + slot->offset, size);
+		slot->offset = end;
+	}
+
+	pHdr->freeEnd = end;
+	pHdr->fragmented = 0;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	The fixed part ends with the last attribute, the chars of the VARCHARs follow in the order of the attributes
+*/
+inline RETCODE VarRecordFile::BuildRec (const std::vector<DataAttrInfo> & attrs, const void * const * values, std::vector<char> & record) {
+	size_t fixedLength = 0;
+
+	for ( const DataAttrInfo & attr : attrs )
+		fixedLength = std::max (fixedLength, static_cast< size_t >( attr.offset + attr.storedLength ( ) ));
+
+	record.assign (fixedLength, 0);
+
+	for ( size_t i = 0; i < attrs.size ( ); i++ ) {
+		const DataAttrInfo & attr = attrs[i];
+
+		if ( values[i] == nullptr )
+			return RETCODE::BADRECORD;
+
+		if ( attr.attrType != VARCHAR || attr.dictionary ) {
+			memcpy (record.data ( ) + attr.offset, values[i], attr.storedLength ( ));
+			continue;
+		}
+
+		const char * chars = reinterpret_cast< const char* >( values[i] );
+		VarField field;
+
+		field.offset = static_cast< unsigned short >( record.size ( ) - attr.offset );
+		field.length = static_cast< unsigned short >( strnlen (chars, attr.attrLength) );
+
+		if ( record.size ( ) + field.length > MAXRECORDSIZE )
+			return RETCODE::BADRECORD;
+
+		memcpy (record.data ( ) + attr.offset, &field, sizeof (VarField));
+		record.insert (record.end ( ), chars, chars + field.length);
+	}
+
+	return record.size ( ) > MAXRECORDSIZE ? RETCODE::BADRECORD : RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::GetVarField (const char * pData, size_t length, size_t attrOffset, const char * & chars, size_t & charsLength) {
+	VarField field;
+
+	if ( attrOffset + sizeof (VarField) > length )
+		return RETCODE::BADRECORD;
+
+	memcpy (&field, pData + attrOffset, sizeof (VarField));
+
+	if ( attrOffset + field.offset + field.length > length )
+		return RETCODE::BADRECORD;
+
+	chars = pData + attrOffset + field.offset;
+	charsLength = field.length;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::getPage (PageNum page, PagePtr & pagePtr, char * & pData) {
+	RETCODE result;
+
+	if ( page < FIRSTDATAPAGE || page >= FIRSTDATAPAGE + header.numPages )
+		return RETCODE::INVALIDPAGE;
+
+	if ( ( result = bufMgr->GetPage (page, pagePtr) ) || ( result = bufMgr->UnlockPage (page) )
+		 || ( result = pagePtr->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::writePage (PageNum page) {
+	return bufMgr->ForcePage (page);
+}
+
+inline RETCODE VarRecordFile::allocatePage (PageNum & page, PagePtr & pagePtr, char * & pData) {
+	RETCODE result;
+
+	if ( ( result = bufMgr->AllocatePage (pagePtr) ) || ( result = pagePtr->GetData (pData) )
+		 || ( result = pagePtr->GetPageNum (page) ) || ( result = bufMgr->UnlockPage (page) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	SlottedPageHeader * pHdr = pageHeader (pData);
+	pHdr->numSlots = 0;
+	pHdr->freeStart = sizeof (SlottedPageHeader);
+	pHdr->freeEnd = static_cast< unsigned short >( Utils::PAGESIZE );
+	pHdr->fragmented = 0;
+
+	header.numPages++;
+	header.lastPage = page;
+	headerModified = true;
+
+	return RETCODE::COMPLETE;
+}
+
+/*
+	Store the record in the last page, or in a new page if the last page is too full
+*/
+inline RETCODE VarRecordFile::placeRecord (const char * pData, size_t length, unsigned short flags, RecordIdentifier & rid) {
+	RETCODE result;
+	PagePtr pagePtr;
+	PageNum page = header.lastPage;
+	char * pPage = nullptr;
+	SlotNum slot;
+
+	if ( page != Utils::UNKNOWNPAGENUM ) {
+		if ( result = getPage (page, pagePtr, pPage) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		if ( allocateInPage (pPage, length, slot) != RETCODE::COMPLETE )
+			pPage = nullptr;
+	}
+
+	if ( pPage == nullptr ) {
+		if ( ( result = allocatePage (page, pagePtr, pPage) ) || ( result = allocateInPage (pPage, length, slot) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	Slot * s = slotAt (pPage, slot);
+	s->flags = flags;
+	memcpy (pPage + s->offset, pData, length);
+
+	rid = RecordIdentifier{ page, slot };
+
+	return writePage (page);
+}
+
+/*
+	Reserve space and a slot for a record of length bytes, compact the page if necessary
+*/
+inline RETCODE VarRecordFile::allocateInPage (char * pData, size_t length, SlotNum & slot) {
+	SlottedPageHeader * pHdr = pageHeader (pData);
+	size_t size = storedSize (length);
+
+	slot = pHdr->numSlots;
+	for ( SlotNum i = 0; i < pHdr->numSlots; i++ ) {		// reuse a free slot if possible
+		if ( slotAt (pData, i)->flags == SLOTFREE ) {
+			slot = i;
+			break;
+		}
+	}
+
+	size_t need = size + ( slot == pHdr->numSlots ? sizeof (Slot) : 0 );
+
+	if ( FreeSpace (pData) + pHdr->fragmented < need )
+		return RETCODE::NODEKEYSFULL;
+
+	if ( FreeSpace (pData) < need )
+		Compact (pData);
+
+	if ( slot == pHdr->numSlots ) {
+		pHdr->numSlots++;
+		pHdr->freeStart += sizeof (Slot);
+	}
+
+	pHdr->freeEnd -= static_cast< unsigned short >( size );
+
+	Slot * s = slotAt (pData, slot);
+	s->offset = pHdr->freeEnd;
+	s->length = static_cast< unsigned short >( length );
+	s->flags = SLOTUSED;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::removeSlot (char * pData, SlotNum slotNum) {
+	SlottedPageHeader * pHdr = pageHeader (pData);
+
+	if ( slotNum >= pHdr->numSlots || slotAt (pData, slotNum)->flags == SLOTFREE )
+		return RETCODE::RECORDNOTFOUND;
+
+	Slot * slot = slotAt (pData, slotNum);
+	pHdr->fragmented += static_cast< unsigned short >( storedSize (slot->length) );
+	slot->flags = SLOTFREE;
+
+	while ( pHdr->numSlots > 0 && slotAt (pData, pHdr->numSlots - 1)->flags == SLOTFREE ) {		// shrink the directory
+		pHdr->numSlots--;
+		pHdr->freeStart -= sizeof (Slot);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFile::readSlot (const RecordIdentifier & rid, PagePtr & pagePtr, char * & pData, Slot * & slot) {
+	RETCODE result;
+	PageNum page;
+	SlotNum slotNum;
+
+	rid.GetPageNum (page);
+	rid.GetSlotNum (slotNum);
+
+	if ( result = getPage (page, pagePtr, pData) )
+		return result;
+
+	if ( slotNum >= pageHeader (pData)->numSlots || slotAt (pData, slotNum)->flags == SLOTFREE )
+		return RETCODE::RECORDNOTFOUND;
+
+	slot = slotAt (pData, slotNum);
+
+	return RETCODE::COMPLETE;
+}
+
+inline SlottedPageHeader * VarRecordFile::pageHeader (char * pData) {
+	return reinterpret_cast< SlottedPageHeader* >( pData );
+}
+
+inline Slot * VarRecordFile::slotAt (char * pData, SlotNum slot) {
+	return reinterpret_cast< Slot* >( pData + sizeof (SlottedPageHeader) ) + slot;
+}
+
+inline size_t VarRecordFile::storedSize (size_t length) {
+	return length < MINRECORDSIZE ? MINRECORDSIZE : length;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+/*
+	1. VarRecordFileScan scans a VarRecordFile with the same interface as RecordFileScan
+	2. Records are visited through their home slots, so a moved record is returned once with its original RecordIdentifier
+*/
+
+#include "Utils.hpp"
+#include "VarRecordFile.hpp"
+
+class VarRecordFileScan {
+public:
+
+	enum ScanState {
+		Close, Open, End
+	};
+
+	VarRecordFileScan ( );
+	~VarRecordFileScan ( );
+
+	RETCODE OpenScan (const VarRecordFilePtr &fileHandle,  // Initialize file scan
+					  AttrType			attrType,
+					  size_t			attrLength,
+					  size_t			attrOffset,
+					  CompOp			compOp,
+					  void				*value);
+
+	RETCODE GetNextRec (Record &rec);                  // Get next matching record
+
+	RETCODE CloseScan ( );                                // Terminate file scan
+
+private:
+
+	using Comparator = bool (*)( void*, void*, AttrType, size_t );
+
+	Comparator _comp;
+
+	VarRecordFilePtr _varFile;
+
+	AttrType _attrType;
+
+	size_t _attrLength;
+
+	size_t _attrOffset;
+
+	std::vector<char> _attrValue;
+
+	PageNum _currentPage;
+
+	SlotNum _currentSlot;
+
+	ScanState _state;
+
+};
+
+VarRecordFileScan::VarRecordFileScan ( ) {
+	_state = ScanState::Close;
+	_comp = nullptr;
+	_varFile = nullptr;
+}
+
+VarRecordFileScan::~VarRecordFileScan ( ) {
+
+}
+
+inline RETCODE VarRecordFileScan::OpenScan (const VarRecordFilePtr & fileHandle, AttrType attrType, size_t attrLength, size_t attrOffset, CompOp compOp, void * value) {
+
+	if ( _state == Open )
+		return RETCODE::INVALIDSCAN;
+
+	if ( fileHandle == nullptr || !fileHandle->isValidRecordFile ( ) )
+		return RETCODE::INVALIDRECORDFILE;
+
+	_varFile = fileHandle;
+	_comp = nullptr;
+
+	if ( value != nullptr && compOp != NO_OP ) {			// has condition
+
+		switch ( compOp ) {
+		case EQ_OP:
+			_comp = CompMethod::equal;
+			break;
+		case LT_OP:
+			_comp = CompMethod::less_than;
+			break;
+		case GT_OP:
+			_comp = CompMethod::greater_than;
+			break;
+		case LE_OP:
+			_comp = CompMethod::less_than_or_eq_to;
+			break;
+		case GE_OP:
+			_comp = CompMethod::greater_than_or_eq_to;
+			break;
+		case NE_OP:
+			_comp = CompMethod::not_equal;
+			break;
+		default:
+			return RETCODE::INVALIDSCAN;
+		}
+
+		_attrType = attrType;
+		_attrLength = attrLength;
+		_attrOffset = attrOffset;
+		_attrValue.assign (reinterpret_cast< char* >( value ), reinterpret_cast< char* >( value ) + attrLength);
+	}
+
+	// initialize the status
+	_currentPage = VarRecordFile::FIRSTDATAPAGE;
+	_currentSlot = 0;
+	_state = Open;
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE VarRecordFileScan::GetNextRec (Record & rec) {
+
+	if ( _state == ScanState::End )
+		return RETCODE::EOFSCAN;
+	else if ( _state != ScanState::Open )
+		return RETCODE::INVALIDSCAN;
+
+	RETCODE result;
+	PagePtr pagePtr;
+	char * pData;
+
+	while ( _currentPage < VarRecordFile::FIRSTDATAPAGE + _varFile->numPages ( ) ) {
+
+		if ( result = _varFile->getPage (_currentPage, pagePtr, pData) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		SlotNum numSlots = VarRecordFile::pageHeader (pData)->numSlots;
+
+		while ( _currentSlot < numSlots ) {
+			SlotNum slot = _currentSlot++;
+			unsigned short flags = VarRecordFile::slotAt (pData, slot)->flags;
+
+			if ( flags != VarRecordFile::SLOTUSED && flags != VarRecordFile::SLOTFORWARD )
+				continue;
+
+			if ( result = _varFile->GetRec (RecordIdentifier{ _currentPage, slot }, rec) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			char * pRec;
+			size_t size;
+			const char * chars;
+			size_t length;
+			rec.GetData (pRec);
+			rec.GetSize (size);
+
+			// the chars of a VARCHAR are compared only when the VarField keeps them inside the record
+			if ( _comp != nullptr && _attrType == VARCHAR && ( result = VarRecordFile::GetVarField (pRec, size, _attrOffset, chars, length) ) ) {
+				Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+				return result;
+			}
+
+			if ( _comp == nullptr || ( _attrOffset + ( _attrType == VARCHAR ? sizeof (VarField) : _attrLength ) <= size
+									   && _comp (pRec + _attrOffset, _attrValue.data ( ), _attrType, _attrLength) ) )
+				return RETCODE::COMPLETE;
+
+			if ( flags == VarRecordFile::SLOTFORWARD ) {	// the moved record was read from another page
+				if ( result = _varFile->getPage (_currentPage, pagePtr, pData) ) {
+					Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+					return result;
+				}
+			}
+		}
+
+		_currentPage++;
+		_currentSlot = 0;
+	}
+
+	_state = End;
+
+	return RETCODE::EOFSCAN;
+}
+
+inline RETCODE VarRecordFileScan::CloseScan ( ) {
+	_state = ScanState::Close;
+	_varFile = nullptr;
+
+	return RETCODE::COMPLETE;
+}
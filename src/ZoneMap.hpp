@@ -0,0 +1,394 @@
+#pragma once
+
+/*
+	1. ZoneMap keeps the min and max value of some attributes for every data page of a RecordFile
+	2. The map is stored in its own page file "<file>.zm", page 1 is ZoneMapHeader, the zones start from page 2
+	3. Inserts and updates only widen a zone, deletes leave it as it is, so a zone always covers the records of its page
+	4. A page without any zone has never held a record
+	5. Records have no NULLs, so no null count is kept
+	6. A STRING attribute longer than MAXVALUELEN keeps only the first MAXVALUELEN bytes of its min and max values,
+	   such a zone can only tell that a page holds no value with a prefix in the range, so strict comparisons
+	   are checked as non-strict ones and NE never prunes
+*/
+
+#include "Utils.hpp"
+#include "BufferManager.hpp"
+
+#include <mutex>
+#include <vector>
+
+struct ZoneAttr {
+	int      offset;
+	AttrType attrType;
+	int      attrLength;
+};
+
+struct ZoneMapHeader {						// stored in page 1 of every zone map file
+	char identifyString[Utils::IDENTIFYSTRINGLEN];			// "MicroSQL ZoneMap"
+	size_t attrCount;
+	size_t zoneSize;						// bytes of the zone of one page
+	PageNum numMapPages;
+	ZoneAttr attrs[1];						// attrCount attributes follow the header
+
+	ZoneMapHeader ( ) {
+		memset (identifyString, 0, sizeof (identifyString));
+		strcpy_s (identifyString, Utils::ZONEMAPIDENTIFYSTRING);
+		attrCount = zoneSize = 0;
+		numMapPages = 0;
+	}
+};
+
+class ZoneMap {
+
+public:
+
+	const static PageNum HEADERPAGE = 1;
+
+	const static PageNum FIRSTMAPPAGE = 2;
+
+	const static size_t MAXVALUELEN = 32;		// longer STRING attributes keep truncated bounds
+
+	ZoneMap ( );
+	~ZoneMap ( );
+
+	RETCODE Open (const BufferManagerPtr & ptr);
+
+	RETCODE Create (const BufferManagerPtr & ptr, int attrCount, const DataAttrInfo * attributes);	// write the header page of a new map file
+
+	RETCODE Update (PageNum page, const char * pData);		// widen the zone of page to cover the record
+
+	size_t FindAttr (size_t attrOffset, AttrType attrType, size_t attrLength) const;	// UNKNOWNPOS if not tracked
+
+	bool MayMatch (PageNum page, size_t attr, CompOp compOp, void * value) const;	// false if no record of page satisfies the condition
+
+	RETCODE Flush ( );
+
+	RETCODE GetPageFilePtr (PageFilePtr & ptr) const;
+
+	/*
+		Static Functions
+	*/
+	static std::string FileName (const char * fileName);
+
+	static bool IsTracked (const DataAttrInfo & attr);
+
+private:
+
+	RETCODE writeZone (PageNum page);
+
+	RETCODE saveHeader ( );
+
+	static size_t boundLength (const ZoneAttr & attr);		// bytes kept of the min and max value
+
+	char * zone (PageNum page);
+
+	const char * zone (PageNum page) const;
+
+	size_t zonesPerPage ( ) const;
+
+	ZoneMapHeader header;
+
+	std::vector<ZoneAttr> _attrs;
+
+	std::vector<size_t> _attrPos;			// position of the min value of every attribute in a zone, the max value follows
+
+	std::vector<char> _zones;				// copy of the map, one zone per data page
+
+	mutable std::mutex _mutex;
+
+	BufferManagerPtr bufMgr;
+
+};
+
+using ZoneMapPtr = shared_ptr<ZoneMap>;
+
+ZoneMap::ZoneMap ( ) {
+	bufMgr = nullptr;
+}
+
+ZoneMap::~ZoneMap ( ) {
+	if ( bufMgr != nullptr )
+		Flush ( );
+}
+
+inline RETCODE ZoneMap::Open (const BufferManagerPtr & ptr) {
+	RETCODE result;
+	PagePtr page;
+	char * pData;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (reinterpret_cast< void* >( &header ), sizeof (ZoneMapHeader), pData, sizeof (ZoneMapHeader));
+
+	if ( strcmp (header.identifyString, Utils::ZONEMAPIDENTIFYSTRING) != 0 )
+		return RETCODE::INVALIDPAGEFILE;
+
+	const ZoneAttr * attrs = reinterpret_cast< const ZoneAttr* >( pData + offsetof (ZoneMapHeader, attrs) );
+	size_t pos = 1;			// the first byte of a zone tells if the zone is valid
+
+	for ( size_t i = 0; i < header.attrCount; i++ ) {
+		_attrs.push_back (attrs[i]);
+		_attrPos.push_back (pos);
+		pos += 2 * boundLength (attrs[i]);
+	}
+
+	for ( PageNum mapPage = FIRSTMAPPAGE; mapPage < FIRSTMAPPAGE + header.numMapPages; mapPage++ ) {
+		if ( ( result = bufMgr->GetPage (mapPage, page) ) || ( result = bufMgr->UnlockPage (mapPage) )
+			 || ( result = page->GetData (pData) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_zones.insert (_zones.end ( ), pData, pData + zonesPerPage ( ) * header.zoneSize);
+	}
+
+	return RETCODE::COMPLETE;
+}
+
+inline RETCODE ZoneMap::Create (const BufferManagerPtr & ptr, int attrCount, const DataAttrInfo * attributes) {
+	RETCODE result;
+	PagePtr page;
+	PageNum pageNum;
+
+	if ( bufMgr != nullptr )
+		return RETCODE::FILEOPEN;
+
+	if ( ptr == nullptr )
+		return RETCODE::INVALIDOPEN;
+
+	bufMgr = ptr;
+	header.zoneSize = 1;
+
+	for ( int i = 0; i < attrCount; i++ ) {
+		if ( !IsTracked (attributes[i]) )
+			continue;
+
+		ZoneAttr attr = { attributes[i].offset, attributes[i].attrType, attributes[i].attrLength };
+
+		if ( offsetof (ZoneMapHeader, attrs) + ( _attrs.size ( ) + 1 ) * sizeof (ZoneAttr) > Utils::PAGESIZE
+			 || header.zoneSize + 2 * boundLength (attr) > Utils::PAGESIZE )
+			break;			// the other attributes are not tracked
+
+		_attrs.push_back (attr);
+		_attrPos.push_back (header.zoneSize);
+		header.zoneSize += 2 * boundLength (attr);
+	}
+
+	header.attrCount = _attrs.size ( );
+
+	if ( ( result = bufMgr->AllocatePage (page) ) || ( result = page->GetPageNum (pageNum) )
+		 || ( result = bufMgr->UnlockPage (pageNum) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	return saveHeader ( );
+}
+
+inline RETCODE ZoneMap::Update (PageNum page, const char * pData) {
+	std::lock_guard<std::mutex> guard (_mutex);
+	RETCODE result;
+
+	if ( _attrs.empty ( ) )
+		return RETCODE::COMPLETE;
+
+	while ( page >= _zones.size ( ) / header.zoneSize ) {		// the map grows with the data file
+		PagePtr mapPage;
+		PageNum mapPageNum;
+
+		if ( ( result = bufMgr->AllocatePage (mapPage) ) || ( result = mapPage->GetPageNum (mapPageNum) )
+			 || ( result = bufMgr->UnlockPage (mapPageNum) ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+
+		_zones.resize (_zones.size ( ) + zonesPerPage ( ) * header.zoneSize, 0);
+		header.numMapPages++;
+
+		if ( result = saveHeader ( ) ) {
+			Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+			return result;
+		}
+	}
+
+	char * z = zone (page);
+	bool modified = false;
+
+	for ( size_t i = 0; i < _attrs.size ( ); i++ ) {
+		void * value = const_cast< char* >( pData + _attrs[i].offset );
+		size_t length = boundLength (_attrs[i]);
+		char * minValue = z + _attrPos[i];
+		char * maxValue = minValue + length;
+
+		if ( !z[0] || CompMethod::less_than (value, minValue, _attrs[i].attrType, length) ) {
+			memcpy (minValue, value, length);
+			modified = true;
+		}
+
+		if ( !z[0] || CompMethod::greater_than (value, maxValue, _attrs[i].attrType, length) ) {
+			memcpy (maxValue, value, length);
+			modified = true;
+		}
+	}
+
+	z[0] = 1;
+
+	return modified ? writeZone (page) : RETCODE::COMPLETE;
+}
+
+inline size_t ZoneMap::FindAttr (size_t attrOffset, AttrType attrType, size_t attrLength) const {
+	for ( size_t i = 0; i < _attrs.size ( ); i++ ) {
+		if ( static_cast< size_t >( _attrs[i].offset ) == attrOffset && _attrs[i].attrType == attrType
+			 && static_cast< size_t >( _attrs[i].attrLength ) == attrLength )
+			return i;
+	}
+
+	return Utils::UNKNOWNPOS;
+}
+
+inline bool ZoneMap::MayMatch (PageNum page, size_t attr, CompOp compOp, void * value) const {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	if ( attr >= _attrs.size ( ) )
+		return true;
+
+	if ( page >= _zones.size ( ) / header.zoneSize || !zone (page)[0] )		// no record has been inserted into the page
+		return false;
+
+	AttrType attrType = _attrs[attr].attrType;
+	size_t attrLength = boundLength (_attrs[attr]);
+	void * minValue = const_cast< char* >( zone (page) + _attrPos[attr] );
+	void * maxValue = reinterpret_cast< char* >( minValue ) + attrLength;
+
+	if ( attrLength < static_cast< size_t >( _attrs[attr].attrLength ) ) {		// truncated bounds, compare the prefixes
+		switch ( compOp ) {
+		case EQ_OP:
+			return CompMethod::less_than_or_eq_to (minValue, value, attrType, attrLength)
+				&& CompMethod::greater_than_or_eq_to (maxValue, value, attrType, attrLength);
+		case LT_OP:
+		case LE_OP:
+			return CompMethod::less_than_or_eq_to (minValue, value, attrType, attrLength);
+		case GT_OP:
+		case GE_OP:
+			return CompMethod::greater_than_or_eq_to (maxValue, value, attrType, attrLength);
+		default:
+			return true;
+		}
+	}
+
+	switch ( compOp ) {
+	case EQ_OP:
+		return CompMethod::less_than_or_eq_to (minValue, value, attrType, attrLength)
+			&& CompMethod::greater_than_or_eq_to (maxValue, value, attrType, attrLength);
+	case LT_OP:
+		return CompMethod::less_than (minValue, value, attrType, attrLength);
+	case GT_OP:
+		return CompMethod::greater_than (maxValue, value, attrType, attrLength);
+	case LE_OP:
+		return CompMethod::less_than_or_eq_to (minValue, value, attrType, attrLength);
+	case GE_OP:
+		return CompMethod::greater_than_or_eq_to (maxValue, value, attrType, attrLength);
+	case NE_OP:
+		return !CompMethod::equal (minValue, value, attrType, attrLength)
+			|| !CompMethod::equal (maxValue, value, attrType, attrLength);
+	default:
+		return true;
+	}
+}
+
+inline RETCODE ZoneMap::Flush ( ) {
+	std::lock_guard<std::mutex> guard (_mutex);
+
+	return bufMgr->FlushPages ( );
+}
+
+inline RETCODE ZoneMap::GetPageFilePtr (PageFilePtr & ptr) const {
+	return bufMgr->GetPageFilePtr (ptr);
+}
+
+inline std::string ZoneMap::FileName (const char * fileName) {
+	return std::string (fileName) + ".zm";
+}
+
+inline bool ZoneMap::IsTracked (const DataAttrInfo & attr) {
+	if ( attr.dictionary )			// the codes do not follow the order of the values
+		return false;
+
+	switch ( attr.attrType ) {
+	case INT:
+	case FLOAT:
+		return true;
+	case STRING:
+		return attr.attrLength > 0;
+	default:
+		return false;
+	}
+}
+
+inline size_t ZoneMap::boundLength (const ZoneAttr & attr) {
+	if ( attr.attrType == STRING && static_cast< size_t >( attr.attrLength ) > MAXVALUELEN )
+		return MAXVALUELEN;
+
+	return attr.attrLength;
+}
+
+/*
+	The map page stays in the buffer and is written when the map is flushed
+*/
+inline RETCODE ZoneMap::writeZone (PageNum page) {
+	RETCODE result;
+	PagePtr mapPage;
+	PageNum mapPageNum = FIRSTMAPPAGE + page / zonesPerPage ( );
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (mapPageNum, mapPage) ) || ( result = bufMgr->UnlockPage (mapPageNum) )
+		 || ( result = mapPage->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy (pData + ( page % zonesPerPage ( ) ) * header.zoneSize, zone (page), header.zoneSize);
+
+	return bufMgr->MarkDirty (mapPageNum);
+}
+
+inline RETCODE ZoneMap::saveHeader ( ) {
+	RETCODE result;
+	PagePtr page;
+	char * pData;
+
+	if ( ( result = bufMgr->GetPage (HEADERPAGE, page) ) || ( result = bufMgr->UnlockPage (HEADERPAGE) )
+		 || ( result = page->GetData (pData) ) ) {
+		Utils::PrintRetcode (result, __FUNCTION__, __LINE__);
+		return result;
+	}
+
+	memcpy_s (pData, Utils::PAGESIZE, reinterpret_cast< const void* >( &header ), offsetof (ZoneMapHeader, attrs));
+	memcpy (pData + offsetof (ZoneMapHeader, attrs), _attrs.data ( ), _attrs.size ( ) * sizeof (ZoneAttr));
+
+	return bufMgr->ForcePage (HEADERPAGE);
+}
+
+inline char * ZoneMap::zone (PageNum page) {
+	return _zones.data ( ) + page * header.zoneSize;
+}
+
+inline const char * ZoneMap::zone (PageNum page) const {
+	return _zones.data ( ) + page * header.zoneSize;
+}
+
+inline size_t ZoneMap::zonesPerPage ( ) const {
+	return Utils::PAGESIZE / header.zoneSize;
+}